@@ -0,0 +1,49 @@
+extends SceneTree
+## Runs the native benchmark suite headless and writes its results as JSON.
+##
+## Needs a library built with `scons benchmark=yes`. Options follow `--` on the command line:
+##   godot --headless --path demo --script res://benchmark/run_benchmark.gd -- --nodes=1000000 --depth=6 --output=results.json
+## Recognized: --nodes, --depth, --fanout, --key_length, --array_ratio, --seed, --samples,
+## --iterations, --lookups and --output (default user://benchmark_results.json).
+## Exits with 1 if the suite reports errors: mismatched values, vector kernels disagreeing with
+## the scalar loops on random input or, in debug builds, warmed get_value/has_path/get_size
+## calls that reached the heap.
+
+func _init() -> void:
+	if not ClassDB.class_exists("PreBuiltIndexJSONBenchmark"):
+		printerr("PreBuiltIndexJSONBenchmark is missing; rebuild the extension with `scons benchmark=yes`.")
+		quit(1)
+		return
+
+	var options := {}
+	var output := "user://benchmark_results.json"
+	for argument in OS.get_cmdline_user_args():
+		if not argument.begins_with("--") or not "=" in argument:
+			continue
+		var name := argument.substr(2, argument.find("=") - 2)
+		var value := argument.substr(argument.find("=") + 1)
+		if name == "output":
+			output = value
+		elif value.is_valid_int():
+			options[name] = value.to_int()
+		elif value.is_valid_float():
+			options[name] = value.to_float()
+		else:
+			options[name] = value
+
+	# Looked up by name, so this script still parses when the class is not compiled in.
+	var suite: RefCounted = ClassDB.instantiate("PreBuiltIndexJSONBenchmark")
+	var results: Dictionary = suite.call("run", options)
+	for benchmark in results["benchmarks"]:
+		print("%-28s %14.2f usec  %12.4f usec/op" % [benchmark["name"], benchmark["mean_usec"], benchmark["usec_per_operation"]])
+	for error in results["errors"]:
+		printerr(error)
+
+	var file := FileAccess.open(output, FileAccess.WRITE)
+	if file == null:
+		printerr("Could not write %s: %s" % [output, error_string(FileAccess.get_open_error())])
+		quit(1)
+		return
+	file.store_string(JSON.stringify(results, "\t", false))
+	print("Results written to ", ProjectSettings.globalize_path(output))
+	quit(0 if results["errors"].is_empty() else 1)
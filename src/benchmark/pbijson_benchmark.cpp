@@ -0,0 +1,342 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_benchmark.hpp"
+#include "pbijson_dataset_generator.hpp"
+
+#include "pbijson.hpp"
+#include "pbijson_decode.hpp"
+#include "pbijson_output.hpp"
+#include "pbijson_scan.hpp"
+
+#include <godot_cpp/classes/json.hpp>
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+DatasetShape _get_shape(const Dictionary &p_options) {
+	DatasetShape shape;
+	shape.node_count = p_options.get("nodes", shape.node_count);
+	shape.depth = p_options.get("depth", shape.depth);
+	shape.fanout = p_options.get("fanout", shape.fanout);
+	shape.key_length = p_options.get("key_length", shape.key_length);
+	shape.array_ratio = p_options.get("array_ratio", shape.array_ratio);
+	shape.seed = (int64_t)p_options.get("seed", (int64_t)shape.seed);
+	shape.samples_per_depth = p_options.get("samples", shape.samples_per_depth);
+	return shape;
+}
+
+Array _to_path_arrays(const std::vector<std::vector<std::string>> &p_paths) {
+	Array result;
+	for (const std::vector<std::string> &depth : p_paths) {
+		PackedStringArray paths;
+		for (const std::string &path : depth) {
+			paths.push_back(String::utf8(path.data(), (int)path.size()));
+		}
+		result.push_back(paths);
+	}
+	return result;
+}
+
+// Generated keys always contain '_', so an all-digit part is an array index.
+Array _to_parts(const String &p_path) {
+	Array parts;
+	PackedStringArray split = p_path.split("/");
+	for (int i = 0; i < split.size(); i++) {
+		if (split[i].is_valid_int()) {
+			parts.push_back(split[i].to_int());
+		} else {
+			parts.push_back(split[i]);
+		}
+	}
+	return parts;
+}
+
+Variant _walk(const Variant &p_root, const Array &p_parts) {
+	Variant current = p_root;
+	for (int i = 0; i < p_parts.size(); i++) {
+		current = current.get(p_parts[i]);
+	}
+	return current;
+}
+
+// Times p_iterations calls of p_body, which performs p_operations operations each. p_reset runs
+// untimed after every call, so teardown such as freeing a dataset stays out of the numbers.
+template <typename F, typename R>
+Dictionary _measure(const String &p_name, int p_iterations, int64_t p_operations, bool p_warm_up, F &&p_body, R &&p_reset) {
+	if (p_warm_up) {
+		p_body();
+		p_reset();
+	}
+	double total = 0.0;
+	double fastest = std::numeric_limits<double>::max();
+	double slowest = 0.0;
+	for (int i = 0; i < p_iterations; i++) {
+		Clock::time_point start = Clock::now();
+		p_body();
+		double usec = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+		p_reset();
+		total += usec;
+		fastest = std::min(fastest, usec);
+		slowest = std::max(slowest, usec);
+	}
+	double mean = total / p_iterations;
+	Dictionary result;
+	result["name"] = p_name;
+	result["iterations"] = p_iterations;
+	result["operations"] = p_operations;
+	result["mean_usec"] = mean;
+	result["min_usec"] = fastest;
+	result["max_usec"] = slowest;
+	result["usec_per_operation"] = mean / std::max<int64_t>(p_operations, 1);
+	return result;
+}
+
+template <typename F>
+Dictionary _measure(const String &p_name, int p_iterations, int64_t p_operations, bool p_warm_up, F &&p_body) {
+	return _measure(p_name, p_iterations, p_operations, p_warm_up, p_body, []() {});
+}
+
+// Checks the vector kernels against the scalar loops on random ranges. Most ranges are shorter
+// than a few vectors, so empty ranges and scalar tails are covered as well as the vector bodies,
+// and the small alphabets make hits frequent.
+void _check_kernels(uint64_t p_seed, PackedStringArray &r_errors) {
+	constexpr int ROUNDS = 20000;
+	constexpr int MAX_LENGTH = 40;
+	// Mostly digits, so eight-digit runs are common, plus code points on both sides of '0'-'9'.
+	static const char32_t ALPHABET[] = { U'0', U'1', U'2', U'3', U'4', U'5', U'6', U'7', U'8', U'9', U'"', U'\\', U'/', U':', U'a', 0, 0xE9, 0x1F600 };
+	constexpr uint64_t ALPHABET_SIZE = sizeof(ALPHABET) / sizeof(ALPHABET[0]);
+	uint64_t state = p_seed;
+	uint32_t depths[MAX_LENGTH];
+	uint32_t keys[MAX_LENGTH];
+	char32_t chars[MAX_LENGTH];
+	int scan_mismatches = 0;
+	int decode_mismatches = 0;
+	for (int round = 0; round < ROUNDS; round++) {
+		const int length = (int)(DatasetGenerator::next_random(state) % (MAX_LENGTH + 1));
+		const int from = (int)(DatasetGenerator::next_random(state) % (length + 1));
+		const int to = from + (int)(DatasetGenerator::next_random(state) % (length - from + 1));
+		for (int i = 0; i < length; i++) {
+			depths[i] = (uint32_t)(DatasetGenerator::next_random(state) % 4);
+			keys[i] = (uint32_t)(DatasetGenerator::next_random(state) % 4);
+			chars[i] = ALPHABET[DatasetGenerator::next_random(state) % ALPHABET_SIZE];
+		}
+		const uint32_t depth = (uint32_t)(DatasetGenerator::next_random(state) % 4);
+		const uint32_t key = (uint32_t)(DatasetGenerator::next_random(state) % 4);
+		scan_mismatches += !LineScanIndex::check_kernels(depths, keys, from, to, depth, key);
+		decode_mismatches += !ValueDecoder::check_kernels(chars, from, to);
+	}
+	if (scan_mismatches > 0) {
+		r_errors.push_back("line scan kernels disagree with the scalar loops on " + String::num_int64(scan_mismatches) + " of " + String::num_int64(ROUNDS) + " random ranges");
+	}
+	if (decode_mismatches > 0) {
+		r_errors.push_back("value decoder kernels disagree with the scalar loops on " + String::num_int64(decode_mismatches) + " of " + String::num_int64(ROUNDS) + " random ranges");
+	}
+}
+
+} // namespace
+
+Dictionary PreBuiltIndexJSONBenchmark::generate_dataset(const Dictionary &p_options) {
+	DatasetGenerator generator(_get_shape(p_options));
+	std::string json = generator.generate();
+	Dictionary result;
+	result["json"] = String::utf8(json.data(), (int)json.size());
+	result["nodes"] = generator.get_node_count();
+	result["paths"] = _to_path_arrays(generator.get_paths());
+	result["container_paths"] = _to_path_arrays(generator.get_container_paths());
+	return result;
+}
+
+Dictionary PreBuiltIndexJSONBenchmark::run(const Dictionary &p_options) {
+	const DatasetShape shape = _get_shape(p_options);
+	const int iterations = std::max((int)p_options.get("iterations", 5), 1);
+	const int64_t lookups = std::max<int64_t>(p_options.get("lookups", 10000), 1);
+
+	Dictionary results;
+	Array benchmarks;
+	PackedStringArray errors;
+	Dictionary config;
+	config["nodes"] = shape.node_count;
+	config["depth"] = shape.depth;
+	config["fanout"] = shape.fanout;
+	config["key_length"] = shape.key_length;
+	config["array_ratio"] = shape.array_ratio;
+	config["seed"] = (int64_t)shape.seed;
+	config["samples"] = shape.samples_per_depth;
+	config["iterations"] = iterations;
+	config["lookups"] = lookups;
+	results["config"] = config;
+	Dictionary environment;
+	environment["line_scan_kernel"] = PreBuiltIndexJSON::get_line_scan_kernel();
+	environment["format"] = PreBuiltIndexJSON::get_pbijson_format();
+#ifdef DEBUG_ENABLED
+	environment["debug"] = true;
+#else
+	environment["debug"] = false;
+#endif
+	environment["started"] = Time::get_singleton()->get_datetime_string_from_system(true);
+	results["environment"] = environment;
+	results["benchmarks"] = benchmarks;
+	_check_kernels(shape.seed, errors);
+	results["errors"] = errors;
+
+	Dictionary dataset;
+	Dictionary generate = _measure("generate", 1, shape.node_count, false, [&]() { dataset = generate_dataset(p_options); });
+	benchmarks.push_back(generate);
+	const String json_text = dataset["json"];
+	const Array paths = dataset["paths"];
+	const Array container_paths = dataset["container_paths"];
+	Dictionary stats;
+	stats["nodes"] = dataset["nodes"];
+	stats["json_length"] = json_text.length();
+	results["dataset"] = stats;
+
+	// Baseline: Godot's own parser, which is also the first stage of every build.
+	Ref<JSON> json = memnew(JSON);
+	benchmarks.push_back(_measure("json_parse", iterations, 1, false, [&]() { json->parse(json_text); }));
+	const Variant parsed = json->get_data();
+
+	Ref<PreBuiltIndexJSONOutput> built;
+	benchmarks.push_back(_measure("build", iterations, 1, false, [&]() {
+		Ref<PreBuiltIndexJSON> builder = memnew(PreBuiltIndexJSON);
+		built = builder->build_from_string(json_text);
+	}));
+	if (built->get_error_type() != PreBuiltIndexJSONOutput::OK) {
+		errors.push_back("build: " + built->get_message());
+		results["errors"] = errors;
+		return results;
+	}
+	const String data = built->get_data();
+	stats["pbijson_length"] = data.length();
+
+	Ref<PreBuiltIndexJSON> opened = memnew(PreBuiltIndexJSON);
+	auto reopen = [&]() { opened = Ref<PreBuiltIndexJSON>(memnew(PreBuiltIndexJSON)); };
+	Dictionary open = _measure("open", iterations, 1, false, [&]() { opened->open_from_string(data, true); }, reopen);
+	Dictionary open_verified = _measure("open_verified", iterations, 1, false, [&]() { opened->open_from_string(data, false); }, reopen);
+	benchmarks.push_back(open);
+	benchmarks.push_back(open_verified);
+	stats["hash_verification_usec"] = double(open_verified["mean_usec"]) - double(open["mean_usec"]);
+
+	Ref<PreBuiltIndexJSON> pbij = memnew(PreBuiltIndexJSON);
+	Ref<PreBuiltIndexJSONOutput> loaded = pbij->open_from_string(data, false);
+	if (loaded->get_error_type() != PreBuiltIndexJSONOutput::OK) {
+		errors.push_back("open: " + loaded->get_message());
+		results["errors"] = errors;
+		return results;
+	}
+
+	for (int depth = 0; depth < paths.size(); depth++) {
+		const PackedStringArray samples = paths[depth];
+		if (samples.is_empty()) {
+			continue;
+		}
+		const String suffix = "/depth_" + String::num_int64(depth + 1);
+		std::vector<Array> parts;
+		for (int i = 0; i < samples.size(); i++) {
+			parts.push_back(_to_parts(samples[i]));
+			if (pbij->get_value(samples[i]) != _walk(parsed, parts.back())) {
+				errors.push_back("get_value mismatch at \"" + samples[i] + "\"");
+			}
+		}
+		const int count = samples.size();
+		pbij->set_cache_flags(PreBuiltIndexJSON::NONE);
+		benchmarks.push_back(_measure("get_value" + suffix, 1, lookups, true, [&]() {
+			for (int64_t i = 0; i < lookups; i++) {
+				pbij->get_value(samples[i % count]);
+			}
+		}));
+		pbij->set_cache_flags(PreBuiltIndexJSON::ALL);
+		benchmarks.push_back(_measure("get_value_cached" + suffix, 1, lookups, true, [&]() {
+			for (int64_t i = 0; i < lookups; i++) {
+				pbij->get_value(samples[i % count]);
+			}
+		}));
+		benchmarks.push_back(_measure("dictionary_lookup" + suffix, 1, lookups, true, [&]() {
+			for (int64_t i = 0; i < lookups; i++) {
+				_walk(parsed, parts[i % count]);
+			}
+		}));
+#ifdef DEBUG_ENABLED
+		// Once warmed, scalar lookups must not reach the heap at all.
+		auto scalar_lookups = [&]() {
+			for (int i = 0; i < count; i++) {
+				pbij->get_value(samples[i]);
+				pbij->has_path(samples[i]);
+				pbij->get_size(samples[i]);
+			}
+		};
+		scalar_lookups();
+		PreBuiltIndexJSON::reset_debug_allocation_count();
+		scalar_lookups();
+		const int64_t allocations = PreBuiltIndexJSON::get_debug_allocation_count();
+		if (allocations != 0) {
+			errors.push_back("warmed get_value/has_path/get_size" + suffix + " allocated " + String::num_int64(allocations) + " times");
+		}
+#endif
+	}
+
+	// Container queries touch whole subtrees, so each sampled container is queried once per run.
+	pbij->set_cache_flags(PreBuiltIndexJSON::NONE);
+	for (int depth = 0; depth < container_paths.size(); depth++) {
+		const PackedStringArray samples = container_paths[depth];
+		if (samples.is_empty()) {
+			continue;
+		}
+		const String suffix = "/depth_" + String::num_int64(depth + 1);
+		benchmarks.push_back(_measure("get_keys" + suffix, iterations, samples.size(), true, [&]() {
+			for (int i = 0; i < samples.size(); i++) {
+				pbij->get_keys(samples[i]);
+			}
+		}));
+		benchmarks.push_back(_measure("get_sub_paths" + suffix, iterations, samples.size(), true, [&]() {
+			for (int i = 0; i < samples.size(); i++) {
+				pbij->get_sub_paths(samples[i]);
+			}
+		}));
+		benchmarks.push_back(_measure("materialize" + suffix, iterations, samples.size(), true, [&]() {
+			for (int i = 0; i < samples.size(); i++) {
+				pbij->get_value(samples[i]);
+			}
+		}));
+	}
+	// Compare with json_parse: both produce the whole document as Variants.
+	benchmarks.push_back(_measure("materialize/root", iterations, 1, false, [&]() { pbij->get_value(""); }));
+
+	results["errors"] = errors;
+	return results;
+}
+
+void PreBuiltIndexJSONBenchmark::_bind_methods() {
+	ClassDB::bind_static_method(get_class_static(), D_METHOD("generate_dataset", "options"), &PreBuiltIndexJSONBenchmark::generate_dataset, DEFVAL(Dictionary()));
+	ClassDB::bind_static_method(get_class_static(), D_METHOD("run", "options"), &PreBuiltIndexJSONBenchmark::run, DEFVAL(Dictionary()));
+}
@@ -0,0 +1,45 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+
+using namespace godot;
+
+// Benchmark suite, compiled in only by `scons benchmark=yes`. It generates a synthetic
+// document, then times building, opening and querying it against Godot's own JSON parser
+// and Dictionary lookups. See benchmark/run_benchmark.gd in the demo project for a runner.
+class PreBuiltIndexJSONBenchmark : public RefCounted {
+	GDCLASS(PreBuiltIndexJSONBenchmark, RefCounted)
+
+protected:
+	static void _bind_methods();
+
+public:
+	// Returns {"json", "nodes", "paths", "container_paths"} for a document of the given shape.
+	static Dictionary generate_dataset(const Dictionary &p_options = Dictionary());
+	// Runs the whole suite on one generated document. The result holds only JSON types.
+	static Dictionary run(const Dictionary &p_options = Dictionary());
+};
@@ -0,0 +1,155 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_dataset_generator.hpp"
+
+#include <algorithm>
+#include <limits>
+
+DatasetGenerator::DatasetGenerator(const DatasetShape &p_shape) :
+		_shape(p_shape) {
+	_shape.node_count = std::max<int64_t>(_shape.node_count, 1);
+	_shape.depth = std::clamp(_shape.depth, 1, 64);
+	_shape.fanout = std::max(_shape.fanout, 1);
+	_shape.key_length = std::clamp(_shape.key_length, 1, 1024);
+	_shape.array_ratio = std::clamp(_shape.array_ratio, 0.0, 1.0);
+	_shape.samples_per_depth = std::max(_shape.samples_per_depth, 1);
+}
+
+// splitmix64: small, fast and identical everywhere, which std::mt19937's distributions are not.
+uint64_t DatasetGenerator::next_random(uint64_t &r_state) {
+	uint64_t z = (r_state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+double DatasetGenerator::_next_unit() {
+	return (next_random(_state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Reservoir sampling, so the kept paths are spread over the whole document instead of
+// all coming from its first top-level entries.
+void DatasetGenerator::_sample(std::vector<std::string> &r_samples, int64_t &r_seen, const std::string &p_path) {
+	r_seen++;
+	if ((int64_t)r_samples.size() < _shape.samples_per_depth) {
+		r_samples.push_back(p_path);
+		return;
+	}
+	uint64_t slot = next_random(_sample_state) % (uint64_t)r_seen;
+	if (slot < (uint64_t)_shape.samples_per_depth) {
+		r_samples[slot] = p_path;
+	}
+}
+
+// Random lowercase padding followed by "_<index>": unique among siblings at any length, and
+// the padding keeps sibling keys from sharing a long common prefix.
+void DatasetGenerator::_write_key(int64_t p_index) {
+	std::string index = std::to_string(p_index);
+	int padding = std::max(0, _shape.key_length - (int)index.size() - 1);
+	for (int i = 0; i < padding; i++) {
+		_out += (char)('a' + next_random(_state) % 26);
+	}
+	_out += '_';
+	_out += index;
+}
+
+void DatasetGenerator::_write_leaf() {
+	double kind = _next_unit();
+	if (kind < 0.4) {
+		_out += std::to_string((int64_t)(next_random(_state) % 2000001) - 1000000);
+	} else if (kind < 0.6) {
+		// Two decimals, so the value survives any float round trip unchanged.
+		uint64_t cents = next_random(_state) % 100000000;
+		uint64_t fraction = cents % 100;
+		_out += std::to_string(cents / 100);
+		_out += fraction < 10 ? ".0" : ".";
+		_out += std::to_string(fraction);
+	} else if (kind < 0.9) {
+		_out += '"';
+		for (int i = 0; i < _shape.key_length; i++) {
+			_out += (char)('a' + next_random(_state) % 26);
+		}
+		_out += '"';
+	} else if (kind < 0.95) {
+		_out += (next_random(_state) & 1) ? "true" : "false";
+	} else {
+		_out += "null";
+	}
+}
+
+void DatasetGenerator::_write_value(int p_depth, std::string &p_path) {
+	_remaining--;
+	_written++;
+	_sample(_paths[p_depth - 1], _seen[p_depth - 1], p_path);
+	if (p_depth >= _shape.depth || _remaining <= 0) {
+		_write_leaf();
+		return;
+	}
+	_sample(_container_paths[p_depth - 1], _containers_seen[p_depth - 1], p_path);
+	bool is_array = _next_unit() < _shape.array_ratio;
+	_write_children(is_array, _shape.fanout, p_depth + 1, p_path);
+}
+
+void DatasetGenerator::_write_children(bool p_array, int64_t p_count, int p_depth, std::string &p_path) {
+	const size_t path_length = p_path.size();
+	_out += p_array ? '[' : '{';
+	for (int64_t i = 0; i < p_count && _remaining > 0; i++) {
+		if (i > 0) {
+			_out += ',';
+		}
+		if (path_length > 0) {
+			p_path += '/';
+		}
+		if (p_array) {
+			p_path += std::to_string(i);
+		} else {
+			size_t key_begin = _out.size() + 1;
+			_out += '"';
+			_write_key(i);
+			p_path.append(_out, key_begin, _out.size() - key_begin);
+			_out += "\":";
+		}
+		_write_value(p_depth, p_path);
+		p_path.resize(path_length);
+	}
+	_out += p_array ? ']' : '}';
+}
+
+std::string DatasetGenerator::generate() {
+	_state = _shape.seed;
+	_sample_state = ~_shape.seed;
+	_remaining = _shape.node_count;
+	_written = 0;
+	_seen.assign(_shape.depth, 0);
+	_containers_seen.assign(_shape.depth, 0);
+	_paths.assign(_shape.depth, std::vector<std::string>());
+	_container_paths.assign(_shape.depth, std::vector<std::string>());
+	_out.clear();
+	// Roughly what a node costs: a key, a leaf and the punctuation around them.
+	_out.reserve((size_t)_shape.node_count * (_shape.key_length * 2 + 8));
+
+	std::string path;
+	_write_children(false, std::numeric_limits<int64_t>::max(), 1, path);
+	return std::move(_out);
+}
@@ -0,0 +1,80 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Shape of a synthetic JSON document. Every value below the root counts as one node; nodes
+// above `depth` are containers of `fanout` children, the ones at `depth` are scalar leaves,
+// and the root keeps taking top-level entries until `node_count` nodes have been written.
+struct DatasetShape {
+	int64_t node_count = 100000;
+	int depth = 4;
+	int fanout = 8;
+	int key_length = 12;
+	// Chance that a container is an array rather than an object.
+	double array_ratio = 0.2;
+	uint64_t seed = 1;
+	// Paths kept per depth for the lookup benchmarks.
+	int samples_per_depth = 256;
+};
+
+// Writes a DatasetShape as compact JSON text. Output depends only on the shape, so a seed
+// reproduces the same document on every platform.
+class DatasetGenerator {
+public:
+	explicit DatasetGenerator(const DatasetShape &p_shape);
+
+	std::string generate();
+	// The generator's random stream, for other benchmark inputs that must be reproducible.
+	static uint64_t next_random(uint64_t &r_state);
+
+	int64_t get_node_count() const { return _written; }
+	// Sampled value paths, index 0 holding the top-level ones.
+	const std::vector<std::vector<std::string>> &get_paths() const { return _paths; }
+	// Sampled container paths, index 0 holding the top-level ones.
+	const std::vector<std::vector<std::string>> &get_container_paths() const { return _container_paths; }
+
+private:
+	DatasetShape _shape;
+	uint64_t _state = 0;
+	// A separate stream for sampling, so the samples kept never change the document.
+	uint64_t _sample_state = 0;
+	int64_t _remaining = 0;
+	int64_t _written = 0;
+	std::vector<int64_t> _seen;
+	std::vector<int64_t> _containers_seen;
+	std::vector<std::vector<std::string>> _paths;
+	std::vector<std::vector<std::string>> _container_paths;
+	std::string _out;
+
+	double _next_unit();
+	void _sample(std::vector<std::string> &r_samples, int64_t &r_seen, const std::string &p_path);
+	void _write_key(int64_t p_index);
+	void _write_leaf();
+	void _write_value(int p_depth, std::string &p_path);
+	void _write_children(bool p_array, int64_t p_count, int p_depth, std::string &p_path);
+};
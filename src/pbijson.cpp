@@ -22,108 +22,374 @@
  * SOFTWARE.
 */
 #include "pbijson.hpp"
+#include "pbijson_debug.hpp"
+#include "pbijson_decode.hpp"
+#include "pbijson_json_writer.hpp"
+#include "pbijson_overlay.hpp"
+#include "pbijson_query.hpp"
+#include "pbijson_snapshot.hpp"
 
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/classes/json.hpp>
 #include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/performance.hpp>
+#include <godot_cpp/classes/worker_thread_pool.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
 using namespace godot;
 
-template <typename T>
-class TypedCache {
-private:
-	Dictionary _cache;
-public:
-	bool has(const StringName &key) const { return _cache.has(key); }
-	T get(const StringName &key) const { return _cache.get(key, T()); }
-	void set(const StringName &key, const T &value) { _cache[key] = value; }
-	bool erase(const StringName &key) { return _cache.erase(key); }
-	void clear() { _cache.clear(); }
+// State collected while flattening, used to emit the optional sections that follow the flat index.
+struct PreBuiltIndexJSON::BuildContext {
+	struct FieldIndex {
+		String pattern;
+		PackedStringArray parts;
+		int record_level = -1;
+		std::map<String, std::vector<int>> entries;
+	};
+
+	// The flat index being built, one line per key.
+	PackedStringArray lines;
+	// Set for *_async builds, which report progress and stop early once cancelled.
+	PreBuiltIndexJSON *async_owner = nullptr;
+	bool cancelled = false;
+
+	// Unescaped keys and line indices of the path currently being flattened.
+	std::vector<String> path;
+	std::vector<int> path_lines;
+	std::vector<FieldIndex> field_indexes;
+
+	bool bloom_enabled = false;
+	int bloom_min_children = 64;
+	int bloom_bits_per_key = 10;
+	std::map<int, std::vector<String>> container_keys;
+
+	bool packed_arrays = false;
+	bool packed_written = false; // Whether any array was packed; such files need PBI_JSON_2.
+
+	bool path_hash_enabled = false;
+	int64_t path_hash_max_bytes = 0;
+	std::vector<uint64_t> path_hashes;
+	std::vector<PathHashIndex::Entry> path_hash_entries;
+
+	void push(const String &p_key, int p_line) {
+		if (bloom_enabled) {
+			container_keys[path_lines.empty() ? -1 : path_lines.back()].push_back(p_key);
+		}
+		path.push_back(p_key);
+		path_lines.push_back(p_line);
+		if (path_hash_enabled) {
+			uint64_t hash = PathHashIndex::hash_part(path_hashes.empty() ? PathHashIndex::HASH_BEGIN : path_hashes.back(), p_key);
+			path_hashes.push_back(hash);
+			PathHashIndex::Entry entry;
+			entry.hash = PathHashIndex::hash_finish(hash);
+			entry.line = p_line;
+			entry.depth = (int)path.size();
+			path_hash_entries.push_back(entry);
+		}
+	}
+
+	void pop() {
+		path.pop_back();
+		path_lines.pop_back();
+		if (path_hash_enabled) {
+			path_hashes.pop_back();
+		}
+	}
+
+	void add_leaf(const Variant &p_value) {
+		for (FieldIndex &index : field_indexes) {
+			if (index.parts.size() != (int64_t)path.size()) continue;
+			bool matches = true;
+			for (int i = 0; i < index.parts.size(); ++i) {
+				const String &part = index.parts[i];
+				if (part != "*" && part != path[i]) {
+					matches = false;
+					break;
+				}
+			}
+			if (!matches) continue;
+			String value_key = PreBuiltIndexJSON::_index_value_key(p_value);
+			if (value_key.is_empty()) continue;
+			index.entries[value_key].push_back(path_lines[index.record_level]);
+		}
+	}
+
+	// Whether a field index pattern reaches below the current path. Packed arrays have no
+	// lines for their elements, so arrays that an index needs to see are never packed.
+	bool is_indexed_below() const {
+		for (const FieldIndex &index : field_indexes) {
+			if (index.parts.size() <= (int64_t)path.size()) continue;
+			bool matches = true;
+			for (size_t i = 0; i < path.size(); ++i) {
+				if (index.parts[i] != "*" && index.parts[i] != path[i]) {
+					matches = false;
+					break;
+				}
+			}
+			if (matches) return true;
+		}
+		return false;
+	}
+
+	// The packed value for p_value (see ValueDecoder::PACKED_MARKER), or an empty String when
+	// packing is off or p_value is not a non-empty array of only numbers or only strings.
+	// JSON numbers arrive as floats, so arrays of integral numbers are stored as int64.
+	String pack_array(const Variant &p_value) {
+		if (!packed_arrays || p_value.get_type() != Variant::ARRAY || is_indexed_below()) return String();
+		Array values = p_value;
+		if (values.is_empty()) return String();
+		bool all_numbers = true;
+		bool all_strings = true;
+		bool all_integral = true;
+		for (int64_t i = 0; i < values.size() && (all_numbers || all_strings); ++i) {
+			Variant::Type type = values[i].get_type();
+			all_strings = all_strings && type == Variant::STRING;
+			all_numbers = all_numbers && (type == Variant::INT || type == Variant::FLOAT);
+			if (type == Variant::FLOAT) {
+				double value = values[i];
+				all_integral = all_integral && value > -9007199254740992.0 && value < 9007199254740992.0 && value == (double)(int64_t)value;
+			}
+		}
+		if (!all_numbers && !all_strings) return String();
+		char32_t type = all_strings ? ValueDecoder::PACKED_STRING : (all_integral ? ValueDecoder::PACKED_INT : ValueDecoder::PACKED_FLOAT);
+		PackedStringArray elements;
+		elements.resize(values.size());
+		String *elements_ptr = elements.ptrw();
+		for (int64_t i = 0; i < values.size(); ++i) {
+			elements_ptr[i] = type == ValueDecoder::PACKED_INT ? String::num_int64((int64_t)(double)values[i]) : JSON::stringify(values[i]);
+		}
+		packed_written = true;
+		return String::chr(ValueDecoder::PACKED_MARKER) + String::chr(type) + "[" + String(",").join(elements) + "]";
+	}
+
+	// Sections are written as `@KIND>line_count>params` followed by line_count payload lines.
+	void write_sections(PackedStringArray &r_lines) {
+		if (path_hash_enabled) {
+			PackedStringArray entries = PathHashIndex::build_section(path_hash_entries, path_hash_max_bytes);
+			r_lines.append("@PHX>" + String::num_int64(entries.size()) + ">FNV1A64");
+			r_lines.append_array(entries);
+		}
+		if (bloom_enabled) {
+			PackedStringArray filters = BloomFilterSet::build_section(container_keys, bloom_min_children, bloom_bits_per_key);
+			r_lines.append("@BLM>" + String::num_int64(filters.size()) + ">FNV1A64");
+			r_lines.append_array(filters);
+		}
+		for (const FieldIndex &index : field_indexes) {
+			r_lines.append("@IDX>" + String::num_int64(index.entries.size()) + ">" + index.pattern);
+			for (const std::pair<const String, std::vector<int>> &entry : index.entries) {
+				String line;
+				for (size_t i = 0; i < entry.second.size(); ++i) {
+					if (i > 0) line += ",";
+					line += String::num_int64(entry.second[i]);
+				}
+				r_lines.append(line + ">" + entry.first);
+			}
+		}
+	}
 };
 
-class CacheManager {
-private:
-	TypedCache<Variant> _value_cache;
-	TypedCache<bool> _has_path_cache;
-	TypedCache<int> _get_size_cache;
-	TypedCache<PackedStringArray> _get_subpaths_cache;
-	TypedCache<Array> _get_keys_cache;
-public:
-	void clear_all() {
-		_value_cache.clear();
-		_has_path_cache.clear();
-		_get_size_cache.clear();
-		_get_subpaths_cache.clear();
-		_get_keys_cache.clear();
-	}
-	void clear_by_flag(PreBuiltIndexJSON::CacheFlags flag) {
-		switch (flag) {
-			case PreBuiltIndexJSON::VALUE_CACHE: _value_cache.clear(); break;
-			case PreBuiltIndexJSON::HAS_PATH_CACHE: _has_path_cache.clear(); break;
-			case PreBuiltIndexJSON::GET_SIZE_CACHE: _get_size_cache.clear(); break;
-			case PreBuiltIndexJSON::GET_SUBPATHS_CACHE: _get_subpaths_cache.clear(); break;
-			case PreBuiltIndexJSON::GET_KEYS_CACHE: _get_keys_cache.clear(); break;
-			default: break;
-		}
-	}
-	bool has(PreBuiltIndexJSON::CacheFlags flag, const StringName &key) const {
-		switch (flag) {
-			case PreBuiltIndexJSON::VALUE_CACHE: return _value_cache.has(key);
-			case PreBuiltIndexJSON::HAS_PATH_CACHE: return _has_path_cache.has(key);
-			case PreBuiltIndexJSON::GET_SIZE_CACHE: return _get_size_cache.has(key);
-			case PreBuiltIndexJSON::GET_SUBPATHS_CACHE: return _get_subpaths_cache.has(key);
-			case PreBuiltIndexJSON::GET_KEYS_CACHE: return _get_keys_cache.has(key);
-			default: return false;
-		}
-	}
-	bool erase(PreBuiltIndexJSON::CacheFlags flag, const StringName &key) {
-		switch (flag) {
-			case PreBuiltIndexJSON::VALUE_CACHE: return _value_cache.erase(key);
-			case PreBuiltIndexJSON::HAS_PATH_CACHE: return _has_path_cache.erase(key);
-			case PreBuiltIndexJSON::GET_SIZE_CACHE: return _get_size_cache.erase(key);
-			case PreBuiltIndexJSON::GET_SUBPATHS_CACHE: return _get_subpaths_cache.erase(key);
-			case PreBuiltIndexJSON::GET_KEYS_CACHE: return _get_keys_cache.erase(key);
-			default: return false;
-		}
-	}
-	template <typename T> void set(PreBuiltIndexJSON::CacheFlags flag, const StringName &key, const T &value) {
-		if constexpr (std::is_same_v<T, Variant>) { if (flag == PreBuiltIndexJSON::VALUE_CACHE) _value_cache.set(key, value); } 
-		else if constexpr (std::is_same_v<T, bool>) { if (flag == PreBuiltIndexJSON::HAS_PATH_CACHE) _has_path_cache.set(key, value); } 
-		else if constexpr (std::is_same_v<T, int>) { if (flag == PreBuiltIndexJSON::GET_SIZE_CACHE) _get_size_cache.set(key, value); } 
-		else if constexpr (std::is_same_v<T, PackedStringArray>) { if (flag == PreBuiltIndexJSON::GET_SUBPATHS_CACHE) _get_subpaths_cache.set(key, value); } 
-		else if constexpr (std::is_same_v<T, Array>) { if (flag == PreBuiltIndexJSON::GET_KEYS_CACHE) _get_keys_cache.set(key, value); }
-	}
-	template <typename T> T get(PreBuiltIndexJSON::CacheFlags flag, const StringName &key) const {
-		if constexpr (std::is_same_v<T, Variant>) { if (flag == PreBuiltIndexJSON::VALUE_CACHE) return _value_cache.get(key); } 
-		else if constexpr (std::is_same_v<T, bool>) { if (flag == PreBuiltIndexJSON::HAS_PATH_CACHE) return _has_path_cache.get(key); } 
-		else if constexpr (std::is_same_v<T, int>) { if (flag == PreBuiltIndexJSON::GET_SIZE_CACHE) return _get_size_cache.get(key); } 
-		else if constexpr (std::is_same_v<T, PackedStringArray>) { if (flag == PreBuiltIndexJSON::GET_SUBPATHS_CACHE) return _get_subpaths_cache.get(key); } 
-		else if constexpr (std::is_same_v<T, Array>) { if (flag == PreBuiltIndexJSON::GET_KEYS_CACHE) return _get_keys_cache.get(key); }
-		return T();
+static PackedStringArray _variant_to_string_list(const Variant &p_value) {
+	if (p_value.get_type() == Variant::PACKED_STRING_ARRAY) {
+		return p_value;
+	}
+	PackedStringArray list;
+	if (p_value.get_type() == Variant::ARRAY) {
+		Array array = p_value;
+		for (int i = 0; i < array.size(); ++i) {
+			list.append(array[i]);
+		}
+	}
+	return list;
+}
+
+
+// Field projection for get_value(): the keys of a container to keep, each with the projection
+// of its own children. A node with `all` set keeps its whole subtree.
+struct PreBuiltIndexJSON::Projection {
+	bool all = false;
+	std::vector<std::pair<String, Projection>> fields;
+
+	void add(const PackedStringArray &p_parts, int p_part = 0) {
+		if (all) return;
+		if (p_part >= p_parts.size()) {
+			all = true;
+			fields.clear();
+			return;
+		}
+		for (std::pair<String, Projection> &field : fields) {
+			if (field.first == p_parts[p_part]) {
+				field.second.add(p_parts, p_part + 1);
+				return;
+			}
+		}
+		fields.emplace_back(p_parts[p_part], Projection());
+		fields.back().second.add(p_parts, p_part + 1);
+	}
+
+	const Projection *find(const String &p_key) const {
+		for (const std::pair<String, Projection> &field : fields) {
+			if (field.first == p_key) return &field.second;
+		}
+		return nullptr;
 	}
 };
 
+static std::atomic<uint64_t> error_slot_ids{ 0 };
+
+PreBuiltIndexJSONErrorSlot::PreBuiltIndexJSONErrorSlot() :
+		_id(error_slot_ids.fetch_add(1, std::memory_order_relaxed) + 1) {}
+
+// Returns this thread's entry, creating it on the thread's first call. Entries are never erased
+// before the slot dies and unordered_map nodes don't move, so the reference stays valid; it is
+// remembered per thread under the slot's id, which is never reused, so a remembered entry of a
+// freed instance can never match again.
+Ref<PreBuiltIndexJSONOutput> &PreBuiltIndexJSONErrorSlot::_get() const {
+	struct Recent {
+		uint64_t id = 0;
+		Ref<PreBuiltIndexJSONOutput> *slot = nullptr;
+	};
+	static thread_local Recent recent[4];
+	Recent &remembered = recent[_id & 3];
+	if (remembered.id == _id) {
+		return *remembered.slot;
+	}
+	Ref<PreBuiltIndexJSONOutput> &slot = _find_or_add();
+	remembered.id = _id;
+	remembered.slot = &slot;
+	return slot;
+}
+
+Ref<PreBuiltIndexJSONOutput> &PreBuiltIndexJSONErrorSlot::_find_or_add() const {
+	const std::thread::id thread = std::this_thread::get_id();
+	{
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		auto it = _slots.find(thread);
+		if (it != _slots.end()) {
+			return it->second;
+		}
+	}
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	PBIJSON_COUNT_ALLOCATION();
+	Ref<PreBuiltIndexJSONOutput> &slot = _slots[thread];
+	if (slot.is_null()) {
+		slot.instantiate();
+	}
+	return slot;
+}
+
+PreBuiltIndexJSONErrorSlot &PreBuiltIndexJSONErrorSlot::operator=(const Ref<PreBuiltIndexJSONOutput> &p_output) {
+	Ref<PreBuiltIndexJSONOutput> &slot = _get();
+	slot = p_output;
+	if (slot.is_null()) {
+		PBIJSON_COUNT_ALLOCATION();
+		slot.instantiate();
+	}
+	return *this;
+}
+
+void PreBuiltIndexJSONErrorSlot::clear() const {
+	Ref<PreBuiltIndexJSONOutput> &slot = _get();
+	if (slot->get_reference_count() == 1) {
+		slot->clear();
+	} else if (slot->get_error_type() != PreBuiltIndexJSONOutput::OK || slot->has_data()) {
+		// A shared output that already reads OK is kept, so a caller holding on to a result
+		// does not cost every later query an allocation.
+		PBIJSON_COUNT_ALLOCATION();
+		slot = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+	}
+}
+
+void PreBuiltIndexJSONErrorSlot::set_error(PreBuiltIndexJSONOutput::ErrorType p_error_type, const String &p_message) const {
+	Ref<PreBuiltIndexJSONOutput> &slot = _get();
+	if (slot->get_reference_count() == 1) {
+		slot->clear();
+		slot->set_error_type(p_error_type);
+		slot->set_message(p_message);
+	} else {
+		PBIJSON_COUNT_ALLOCATION();
+		slot = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(p_error_type, p_message)));
+	}
+}
 
 void PreBuiltIndexJSON::_bind_methods() {
 	// ADD_PROPERTY(PropertyInfo(Variant::INT, "cache_flags", PROPERTY_HINT_FLAGS, "Value Cache,Path Existence Cache,Size Cache,Sub-paths Cache,Keys Cache"), "set_cache_flags", "get_cache_flags");
-	ClassDB::bind_method(D_METHOD("build_from_string", "json_text"), &PreBuiltIndexJSON::build_from_string);
-	ClassDB::bind_method(D_METHOD("build_from_file", "json_file_path"), &PreBuiltIndexJSON::build_from_file);
-	ClassDB::bind_method(D_METHOD("build_from_file_to", "json_file_path", "target_path"), &PreBuiltIndexJSON::build_from_file_to);
+	ClassDB::bind_method(D_METHOD("build_from_string", "json_text", "options"), &PreBuiltIndexJSON::build_from_string, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("build_from_file", "json_file_path", "options"), &PreBuiltIndexJSON::build_from_file, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("build_from_file_to", "json_file_path", "target_path", "options"), &PreBuiltIndexJSON::build_from_file_to, DEFVAL(Dictionary()));
 	ClassDB::bind_method(D_METHOD("open_file", "path","ignore_hash"), &PreBuiltIndexJSON::open_file, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("build_from_file_async", "json_file_path", "options"), &PreBuiltIndexJSON::build_from_file_async, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("build_from_file_to_async", "json_file_path", "target_path", "options"), &PreBuiltIndexJSON::build_from_file_to_async, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("open_file_async", "path", "ignore_hash"), &PreBuiltIndexJSON::open_file_async, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("cancel_async"), &PreBuiltIndexJSON::cancel_async);
+	ClassDB::bind_method(D_METHOD("is_async_running"), &PreBuiltIndexJSON::is_async_running);
+	ClassDB::bind_method(D_METHOD("wait_for_async"), &PreBuiltIndexJSON::wait_for_async);
 	ClassDB::bind_method(D_METHOD("open_from_string", "data","ignore_hash"), &PreBuiltIndexJSON::open_from_string, DEFVAL(false));
 	ClassDB::bind_method(D_METHOD("open_from_array", "data","ignore_hash"), &PreBuiltIndexJSON::open_from_array, DEFVAL(false));
 	ClassDB::bind_method(D_METHOD("reload_file","ignore_hash"), &PreBuiltIndexJSON::reload_file, DEFVAL(false));
-	ClassDB::bind_method(D_METHOD("get_value", "key_path", "default"), &PreBuiltIndexJSON::get_value, DEFVAL(Variant()));
+	ClassDB::bind_method(D_METHOD("hot_reload", "ignore_hash", "keep_valid_caches"), &PreBuiltIndexJSON::hot_reload, DEFVAL(false), DEFVAL(true));
+	ClassDB::bind_method(D_METHOD("is_reloading"), &PreBuiltIndexJSON::is_reloading);
+	ClassDB::bind_method(D_METHOD("wait_for_reload"), &PreBuiltIndexJSON::wait_for_reload);
+	ClassDB::bind_method(D_METHOD("get_value", "key_path", "default", "options"), &PreBuiltIndexJSON::get_value, DEFVAL(Variant()), DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("get_int", "key_path", "default"), &PreBuiltIndexJSON::get_int, DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("get_float", "key_path", "default"), &PreBuiltIndexJSON::get_float, DEFVAL(0.0));
+	ClassDB::bind_method(D_METHOD("get_bool", "key_path", "default"), &PreBuiltIndexJSON::get_bool, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("get_string", "key_path", "default"), &PreBuiltIndexJSON::get_string, DEFVAL(String()));
+	ClassDB::bind_method(D_METHOD("get_json", "key_path", "indent"), &PreBuiltIndexJSON::get_json, DEFVAL(String()));
+	ClassDB::bind_method(D_METHOD("get_json_buffer", "key_path", "indent"), &PreBuiltIndexJSON::get_json_buffer, DEFVAL(String()));
+	ClassDB::bind_method(D_METHOD("store_json", "file", "key_path", "indent"), &PreBuiltIndexJSON::store_json, DEFVAL(String()));
     ClassDB::bind_method(D_METHOD("has_path", "key_path"), &PreBuiltIndexJSON::has_path);
     ClassDB::bind_method(D_METHOD("get_size", "key_path"), &PreBuiltIndexJSON::get_size);
     ClassDB::bind_method(D_METHOD("get_keys", "key_path"), &PreBuiltIndexJSON::get_keys);
     ClassDB::bind_method(D_METHOD("get_sub_paths", "key_path"), &PreBuiltIndexJSON::get_sub_paths);
+	ClassDB::bind_method(D_METHOD("query", "container_path", "predicate", "return_paths"), &PreBuiltIndexJSON::query, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("aggregate", "collection_path", "field_path"), &PreBuiltIndexJSON::aggregate);
+	ClassDB::bind_method(D_METHOD("top_k", "collection_path", "field_path", "k", "ascending"), &PreBuiltIndexJSON::top_k, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("find_by", "field_path", "value"), &PreBuiltIndexJSON::find_by);
+	ClassDB::bind_method(D_METHOD("get_indexed_fields"), &PreBuiltIndexJSON::get_indexed_fields);
+	ClassDB::bind_method(D_METHOD("set_value", "key_path", "value"), &PreBuiltIndexJSON::set_value);
+	ClassDB::bind_method(D_METHOD("erase_path", "key_path"), &PreBuiltIndexJSON::erase_path);
+	ClassDB::bind_method(D_METHOD("get_pending_change_count"), &PreBuiltIndexJSON::get_pending_change_count);
+	ClassDB::bind_method(D_METHOD("discard_changes"), &PreBuiltIndexJSON::discard_changes);
+	ClassDB::bind_method(D_METHOD("compact", "options"), &PreBuiltIndexJSON::compact, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("save_to", "target_path", "options"), &PreBuiltIndexJSON::save_to, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("diff", "other"), &PreBuiltIndexJSON::diff);
+	ClassDB::bind_method(D_METHOD("apply_patch", "patch"), &PreBuiltIndexJSON::apply_patch);
 	ClassDB::bind_method(D_METHOD("clear"), &PreBuiltIndexJSON::clear);
 	ClassDB::bind_method(D_METHOD("close"), &PreBuiltIndexJSON::close);
 	ClassDB::bind_method(D_METHOD("clear_caches"), &PreBuiltIndexJSON::clear_caches);
 	ClassDB::bind_method(D_METHOD("clear_cache", "flag"), &PreBuiltIndexJSON::clear_cache);
 	ClassDB::bind_method(D_METHOD("remove_from_cache", "flag", "key_path"), &PreBuiltIndexJSON::remove_from_cache);
+	ClassDB::bind_method(D_METHOD("set_cache_limit", "flags", "max_entries", "max_bytes"), &PreBuiltIndexJSON::set_cache_limit, DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("get_cache_stats", "flag"), &PreBuiltIndexJSON::get_cache_stats);
+	ClassDB::bind_method(D_METHOD("reset_cache_stats", "flags"), &PreBuiltIndexJSON::reset_cache_stats, DEFVAL(ALL));
+	ClassDB::bind_method(D_METHOD("get_cache_memory_usage"), &PreBuiltIndexJSON::get_cache_memory_usage);
+	ClassDB::bind_method(D_METHOD("get_stats"), &PreBuiltIndexJSON::get_stats);
+	ClassDB::bind_method(D_METHOD("get_stat", "name"), &PreBuiltIndexJSON::get_stat);
+	ClassDB::bind_method(D_METHOD("reset_stats"), &PreBuiltIndexJSON::reset_stats);
+	ClassDB::bind_method(D_METHOD("set_stats_enabled", "enabled"), &PreBuiltIndexJSON::set_stats_enabled);
+	ClassDB::bind_method(D_METHOD("is_stats_enabled"), &PreBuiltIndexJSON::is_stats_enabled);
+	ClassDB::bind_method(D_METHOD("add_performance_monitors", "category"), &PreBuiltIndexJSON::add_performance_monitors, DEFVAL("PBIJSON"));
+	ClassDB::bind_method(D_METHOD("remove_performance_monitors"), &PreBuiltIndexJSON::remove_performance_monitors);
+	ClassDB::bind_method(D_METHOD("start_trace", "options"), &PreBuiltIndexJSON::start_trace, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("stop_trace"), &PreBuiltIndexJSON::stop_trace);
+	ClassDB::bind_method(D_METHOD("is_tracing"), &PreBuiltIndexJSON::is_tracing);
+	ClassDB::bind_method(D_METHOD("get_trace_events"), &PreBuiltIndexJSON::get_trace_events);
+	ClassDB::bind_method(D_METHOD("dump_trace", "path"), &PreBuiltIndexJSON::dump_trace);
+	ClassDB::bind_method(D_METHOD("get_trace_report", "top"), &PreBuiltIndexJSON::get_trace_report, DEFVAL(20));
+	ClassDB::bind_static_method(get_class_static(), D_METHOD("load_trace_report", "path", "top"), &PreBuiltIndexJSON::load_trace_report, DEFVAL(20));
+	ClassDB::bind_method(D_METHOD("prefetch", "paths"), &PreBuiltIndexJSON::prefetch);
+	ClassDB::bind_method(D_METHOD("is_prefetching"), &PreBuiltIndexJSON::is_prefetching);
+	ClassDB::bind_method(D_METHOD("wait_for_prefetch"), &PreBuiltIndexJSON::wait_for_prefetch);
+	ClassDB::bind_method(D_METHOD("get_cached_paths", "flags"), &PreBuiltIndexJSON::get_cached_paths, DEFVAL(ALL));
+	ClassDB::bind_method(D_METHOD("set_warmup_paths", "paths"), &PreBuiltIndexJSON::set_warmup_paths);
+	ClassDB::bind_method(D_METHOD("get_warmup_paths"), &PreBuiltIndexJSON::get_warmup_paths);
 	ClassDB::bind_method(D_METHOD("get_last_error"), &PreBuiltIndexJSON::get_last_error);
 	ClassDB::bind_method(D_METHOD("is_data_loaded"), &PreBuiltIndexJSON::is_data_loaded);
 	ClassDB::bind_method(D_METHOD("get_opened_file"), &PreBuiltIndexJSON::get_opened_file);
@@ -132,6 +398,14 @@ void PreBuiltIndexJSON::_bind_methods() {
     ClassDB::bind_method(D_METHOD("has_in_cache", "flag", "key_path"), &PreBuiltIndexJSON::has_in_cache);
 
 	ClassDB::bind_static_method(get_class_static(),D_METHOD("get_pbijson_format"), &PreBuiltIndexJSON::get_pbijson_format);
+	ClassDB::bind_static_method(get_class_static(),D_METHOD("get_shared_dataset_count"), &PreBuiltIndexJSON::get_shared_dataset_count);
+	ClassDB::bind_static_method(get_class_static(),D_METHOD("get_line_scan_kernel"), &PreBuiltIndexJSON::get_line_scan_kernel);
+	ClassDB::bind_static_method(get_class_static(),D_METHOD("get_debug_allocation_count"), &PreBuiltIndexJSON::get_debug_allocation_count);
+	ClassDB::bind_static_method(get_class_static(),D_METHOD("reset_debug_allocation_count"), &PreBuiltIndexJSON::reset_debug_allocation_count);
+
+	ADD_SIGNAL(MethodInfo("hot_reload_completed", PropertyInfo(Variant::OBJECT, "output", PROPERTY_HINT_RESOURCE_TYPE, "PreBuiltIndexJSONOutput")));
+	ADD_SIGNAL(MethodInfo("async_progress", PropertyInfo(Variant::STRING, "stage"), PropertyInfo(Variant::INT, "current"), PropertyInfo(Variant::INT, "total")));
+	ADD_SIGNAL(MethodInfo("async_completed", PropertyInfo(Variant::OBJECT, "output", PROPERTY_HINT_RESOURCE_TYPE, "PreBuiltIndexJSONOutput")));
 
 	BIND_ENUM_CONSTANT(NONE);
 	BIND_ENUM_CONSTANT(VALUE_CACHE);
@@ -139,104 +413,178 @@ void PreBuiltIndexJSON::_bind_methods() {
 	BIND_ENUM_CONSTANT(GET_SIZE_CACHE);
 	BIND_ENUM_CONSTANT(GET_SUBPATHS_CACHE);
 	BIND_ENUM_CONSTANT(GET_KEYS_CACHE);
+	BIND_ENUM_CONSTANT(AGGREGATE_CACHE);
+	BIND_ENUM_CONSTANT(LOCATION_CACHE);
 	BIND_ENUM_CONSTANT(ALL);
 }
 
 PreBuiltIndexJSON::PreBuiltIndexJSON() {
 	_mutex.instantiate();
-	_last_error.instantiate();
-	_cache_manager = new CacheManager();
+	std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+	snapshot->dataset = std::make_shared<Dataset>();
+	_snapshot = snapshot;
 }
 
 PreBuiltIndexJSON::~PreBuiltIndexJSON() {
-	delete _cache_manager;
+	// The monitors call back into this object, so they must not outlive it.
+	remove_performance_monitors();
+	_prefetch_cancelled = true;
+	if (_prefetch_task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(_prefetch_task_id);
+	}
+	if (_reload_task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(_reload_task_id);
+	}
+	_async_cancelled = true;
+	if (_async_task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(_async_task_id);
+	}
 }
 
+// Files with sections (and the BL header that locates them) or packed arrays are written as
+// PBI_JSON_2, so that a reader that only knows PBI_JSON_1 rejects them instead of misreading
+// them. Files without either are still written as PBI_JSON_1, which is read as before.
+static const char *PBIJSON_FORMAT_1 = "PBI_JSON_1";
+
 String PreBuiltIndexJSON::get_pbijson_format() {
-	return String("PBI_JSON_1");
+	return String("PBI_JSON_2");
 }
 
-Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::build_from_file(const String &p_json_file) {
-	_mutex->lock();
+int PreBuiltIndexJSON::get_shared_dataset_count() {
+	return DatasetRegistry::size();
+}
+
+String PreBuiltIndexJSON::get_line_scan_kernel() {
+	return String(LineScanIndex::get_kernel_name());
+}
+
+int64_t PreBuiltIndexJSON::get_debug_allocation_count() {
+#ifdef DEBUG_ENABLED
+	return pbijson_debug::allocation_count;
+#else
+	return -1;
+#endif
+}
+
+void PreBuiltIndexJSON::reset_debug_allocation_count() {
+#ifdef DEBUG_ENABLED
+	pbijson_debug::allocation_count = 0;
+#endif
+}
+
+// Building never touches the loaded data, so it needs no lock; errors go to the caller's thread.
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::build_from_file(const String &p_json_file, const Dictionary &p_options) {
 	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
 	Ref<FileAccess> read_file = FileAccess::open(p_json_file, FileAccess::ModeFlags::READ);
 	if (read_file.is_null()) {
 		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(FileAccess::get_open_error())));
-		_mutex->unlock();
 		return _last_error;
 	}
-	Ref<PreBuiltIndexJSONOutput> output = _build(read_file->get_as_text());
+	Ref<PreBuiltIndexJSONOutput> output = _build(read_file->get_as_text(), p_options);
 	if (output->get_error_type() != PreBuiltIndexJSONOutput::OK) {
 		_last_error = output;
-		_mutex->unlock();
 		return _last_error;
 	}
 	
-	_mutex->unlock();
 	return output;
 }
 
-Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::build_from_file_to(const String &p_json_file, const String &p_target_path) {
-	_mutex->lock();
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::build_from_file_to(const String &p_json_file, const String &p_target_path, const Dictionary &p_options) {
 	Ref<FileAccess> read_file = FileAccess::open(p_json_file, FileAccess::ModeFlags::READ);
 	if (read_file.is_null()) {
 		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(FileAccess::get_open_error())));
-		_mutex->unlock();
 		return _last_error;
 	}
-	Ref<PreBuiltIndexJSONOutput> output = _build(read_file->get_as_text());
+	Ref<PreBuiltIndexJSONOutput> output = _build(read_file->get_as_text(), p_options);
 	if (!output->has_data()) {
-		_mutex->unlock();
 		return _last_error;
 	}
+	return _store_build(output, p_target_path);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::build_from_string(const String &p_json_text, const Dictionary &p_options) {
+	return _build(p_json_text, p_options);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_store_build(const Ref<PreBuiltIndexJSONOutput> &p_output, const String &p_target_path) {
 	Ref<FileAccess> write_file = FileAccess::open(p_target_path, FileAccess::ModeFlags::WRITE);
 	if (write_file.is_null()) {
 		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(FileAccess::get_open_error())));
-		_mutex->unlock();
 		return _last_error;
 	}
-	write_file->store_string(output->get_data());
-	_mutex->unlock();
-	return output;
-}
-
-Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::build_from_string(const String &p_json_text) {
-	_mutex->lock();
-	Ref<PreBuiltIndexJSONOutput> output = _build(p_json_text);
-	_mutex->unlock();
-	return output;
+	write_file->store_string(p_output->get_data());
+	return p_output;
 }
 
-Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_build(const String &p_json_text) {
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_build(const String &p_json_text, const Dictionary &p_options, bool p_async) {
+	PBIJSON_STATS_SCOPE(BUILD);
 	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
-	if (!_build_buffer.is_empty()) { // why?
-		_build_buffer.clear();
-		UtilityFunctions::printerr("Build buffer was not empty. This may indicate a data race or unclean state.", __FUNCTION__, __FILE__, __LINE__);
-	}
 	Ref<JSON> json_parser = memnew(JSON);
+	if (p_async && !_async_step("parse", 0, p_json_text.length())) {
+		return _cancelled_output();
+	}
 	Error err = json_parser->parse(p_json_text);
 	if (err != OK) {
 		Ref<PreBuiltIndexJSONOutput> output = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_JSON_PARSE, json_parser->get_error_message(), json_parser->get_error_line())));
-		_mutex->unlock();
 		return output;
 	}
-	Variant json_data = json_parser->get_data();
-	if (json_data.get_type() != Variant::DICTIONARY && json_data.get_type() != Variant::ARRAY) {
+	if (p_async && !_async_step("parse", p_json_text.length(), p_json_text.length())) {
+		return _cancelled_output();
+	}
+	return _build_from_data(json_parser->get_data(), p_options, p_async);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_build_from_data(const Variant &p_data, const Dictionary &p_options, bool p_async) {
+	if (p_data.get_type() != Variant::DICTIONARY && p_data.get_type() != Variant::ARRAY) {
 		Ref<PreBuiltIndexJSONOutput> output = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_UNSUPPORTED_TYPE, "Top-level JSON data must be a Dictionary or an Array.")));
-		_mutex->unlock();
 		return output;
 	}
+	BuildContext context;
+	if (p_async) {
+		context.async_owner = this;
+	}
+	PackedStringArray index_fields = _variant_to_string_list(p_options.get("index_fields", Array()));
+	for (int i = 0; i < index_fields.size(); ++i) {
+		BuildContext::FieldIndex index;
+		index.pattern = index_fields[i].rstrip("/");
+		index.parts = _parse_escaped_path(index.pattern);
+		for (int j = 0; j < index.parts.size(); ++j) {
+			if (index.parts[j] == "*") index.record_level = j;
+		}
+		if (index.record_level < 0 || index.record_level == index.parts.size() - 1) {
+			return Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Index field '" + index.pattern + "' must contain a '*' segment followed by a field name.")));
+		}
+		context.field_indexes.push_back(index);
+	}
+	context.path_hash_enabled = p_options.get("path_hash_index", false);
+	context.path_hash_max_bytes = p_options.get("path_hash_max_bytes", 0);
+	context.packed_arrays = p_options.get("packed_arrays", false);
+	context.bloom_enabled = p_options.get("bloom_filters", false);
+	context.bloom_min_children = p_options.get("bloom_min_children", 64);
+	context.bloom_bits_per_key = p_options.get("bloom_bits_per_key", 10);
 	Dictionary container_lines;
-	_build_flat_index_recursive(json_data, 1, container_lines);
-	_add_jump_marks_to_buffer(container_lines);
-	String file_text = String("\n").join(_build_buffer);
-	String md5 = file_text.md5_text();
+	_build_flat_index_recursive(p_data, 1, container_lines, context);
+	if (context.cancelled || (p_async && !_async_step("flatten", context.lines.size(), context.lines.size()))) {
+		return _cancelled_output();
+	}
+	_add_jump_marks_to_buffer(container_lines, context.lines);
+	PackedStringArray section_lines;
+	context.write_sections(section_lines);
+	String file_text = String("\n").join(context.lines);
 	Dictionary header = Dictionary();
+	if (!section_lines.is_empty()) {
+		// BL (body lines) tells the reader where the flat index ends and the sections begin.
+		header.set("BL", String::num_int64(context.lines.size()));
+		file_text = context.lines.is_empty() ? String("\n").join(section_lines) : file_text + "\n" + String("\n").join(section_lines);
+	}
+	String md5 = file_text.md5_text();
+	if (p_async && !_async_step("hash", file_text.length(), file_text.length())) {
+		return _cancelled_output();
+	}
 	header.set("HASH_ALGO","MD5");
 	header.set("HASH",md5);
-	header.set("FV",get_pbijson_format());
+	header.set("FV", section_lines.is_empty() && !context.packed_written ? String(PBIJSON_FORMAT_1) : get_pbijson_format());
 	file_text = _generate_file_header(header) + file_text;
-	_build_buffer.clear();
 	Ref<PreBuiltIndexJSONOutput> output = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(file_text)));
 	return output;
 }
@@ -253,7 +601,8 @@ String PreBuiltIndexJSON::_generate_file_header(const Dictionary &data) {
 	return String("|").join(fields) +"\n";
 }
 
-void PreBuiltIndexJSON::_build_flat_index_recursive(const Variant &p_current_value, int p_depth, Dictionary &p_container_lines) {
+void PreBuiltIndexJSON::_build_flat_index_recursive(const Variant &p_current_value, int p_depth, Dictionary &p_container_lines, BuildContext &p_context) {
+	PackedStringArray &lines = p_context.lines;
 	Variant::Type value_type = p_current_value.get_type();
 	if (value_type == Variant::DICTIONARY) {
 		Dictionary data_dict = p_current_value;
@@ -265,18 +614,28 @@ void PreBuiltIndexJSON::_build_flat_index_recursive(const Variant &p_current_val
 			String prefix = String::chr(DEPTH_MARKER).repeat(p_depth);
 			String formatted_key = JSON::stringify(key_var);
 			String line_header = prefix + formatted_key;
-			_build_buffer.append(line_header);
-			int64_t current_line_idx = _build_buffer.size() - 1;
+			lines.append(line_header);
+			int64_t current_line_idx = lines.size() - 1;
+			if (p_context.async_owner && (current_line_idx % ASYNC_PROGRESS_LINES) == 0 && !p_context.async_owner->_async_step("flatten", current_line_idx, -1)) {
+				p_context.cancelled = true;
+			}
+			if (p_context.cancelled) return;
+			p_context.push(key_var, current_line_idx);
 			Variant::Type sub_value_type = value.get_type();
-			if (sub_value_type == Variant::DICTIONARY || sub_value_type == Variant::ARRAY) {
+			String packed = p_context.pack_array(value);
+			if (!packed.is_empty()) {
+				lines[current_line_idx] += String::chr(VALUE_SEPARATOR) + packed;
+			} else if (sub_value_type == Variant::DICTIONARY || sub_value_type == Variant::ARRAY) {
 				Dictionary dict;
 				dict["depth"] = p_depth;
 				dict["value"] = value;
 				p_container_lines[current_line_idx] = dict;
-				_build_flat_index_recursive(value, p_depth + 1, p_container_lines);
+				_build_flat_index_recursive(value, p_depth + 1, p_container_lines, p_context);
 			} else {
-				_build_buffer[current_line_idx] += String::chr(VALUE_SEPARATOR) + JSON::stringify(value);
+				lines[current_line_idx] += String::chr(VALUE_SEPARATOR) + JSON::stringify(value);
+				p_context.add_leaf(value);
 			}
+			p_context.pop();
 		}
 	} else if (value_type == Variant::ARRAY) {
 		Array data_array = p_current_value;
@@ -285,23 +644,33 @@ void PreBuiltIndexJSON::_build_flat_index_recursive(const Variant &p_current_val
 			String prefix = String::chr(DEPTH_MARKER).repeat(p_depth);
 			String formatted_key = String("[{0}]").format(Array::make(i));
 			String line_header = prefix + formatted_key;
-			_build_buffer.append(line_header);
-			int64_t current_line_idx = _build_buffer.size() - 1;
+			lines.append(line_header);
+			int64_t current_line_idx = lines.size() - 1;
+			if (p_context.async_owner && (current_line_idx % ASYNC_PROGRESS_LINES) == 0 && !p_context.async_owner->_async_step("flatten", current_line_idx, -1)) {
+				p_context.cancelled = true;
+			}
+			if (p_context.cancelled) return;
+			p_context.push(String::num_int64(i), current_line_idx);
 			Variant::Type sub_value_type = value.get_type();
-			if (sub_value_type == Variant::DICTIONARY || sub_value_type == Variant::ARRAY) {
+			String packed = p_context.pack_array(value);
+			if (!packed.is_empty()) {
+				lines[current_line_idx] += String::chr(VALUE_SEPARATOR) + packed;
+			} else if (sub_value_type == Variant::DICTIONARY || sub_value_type == Variant::ARRAY) {
 				Dictionary dict;
 				dict["depth"] = p_depth;
 				dict["value"] = value;
 				p_container_lines[current_line_idx] = dict;
-				_build_flat_index_recursive(value, p_depth + 1, p_container_lines);
+				_build_flat_index_recursive(value, p_depth + 1, p_container_lines, p_context);
 			} else {
-				_build_buffer[current_line_idx] += String::chr(VALUE_SEPARATOR) + JSON::stringify(value);
+				lines[current_line_idx] += String::chr(VALUE_SEPARATOR) + JSON::stringify(value);
+				p_context.add_leaf(value);
 			}
+			p_context.pop();
 		}
 	}
 }
 
-void PreBuiltIndexJSON::_add_jump_marks_to_buffer(Dictionary &p_container_lines) {
+void PreBuiltIndexJSON::_add_jump_marks_to_buffer(Dictionary &p_container_lines, PackedStringArray &r_lines) {
     Array sorted_keys = p_container_lines.keys();
     sorted_keys.sort();
     Dictionary line_counts;
@@ -311,8 +680,8 @@ void PreBuiltIndexJSON::_add_jump_marks_to_buffer(Dictionary &p_container_lines)
         int depth = container_info["depth"];
         int descendant_count = 0;
         int64_t j = line_idx + 1;
-        while (j < _build_buffer.size()) {
-            const String& line = _build_buffer[j];
+        while (j < r_lines.size()) {
+            const String& line = r_lines[j];
             int line_depth = _get_line_depth(line);
             if (line_depth <= depth) {
                 break;
@@ -328,302 +697,1340 @@ void PreBuiltIndexJSON::_add_jump_marks_to_buffer(Dictionary &p_container_lines)
         }
         if (descendant_count > 0) {
             line_counts[line_idx] = descendant_count;
-            _build_buffer[line_idx] += String::chr(JUMP_MARKER_OPEN) + String::num_int64(descendant_count);
+            r_lines[line_idx] += String::chr(JUMP_MARKER_OPEN) + String::num_int64(descendant_count);
         } else {
             Variant empty_container = container_info["value"];
-            _build_buffer[line_idx] += String::chr(VALUE_SEPARATOR) + JSON::stringify(empty_container);
+            r_lines[line_idx] += String::chr(VALUE_SEPARATOR) + JSON::stringify(empty_container);
         }
     }
 }
 
-Variant PreBuiltIndexJSON::get_value(const String &p_key_path, const Variant &p_default) const {
-	_mutex->lock();
-	_last_error->clear();
-	const StringName key(p_key_path);
-	if (is_cache_enabled(VALUE_CACHE) && _cache_manager->has(VALUE_CACHE, key)) {
-		_mutex->unlock();
-		return _cache_manager->get<Variant>(VALUE_CACHE, key);
+Variant PreBuiltIndexJSON::get_value(const String &p_key_path, const Variant &p_default, const Dictionary &p_options) const {
+	PBIJSON_STATS_SCOPE(GET_VALUE);
+	PBIJSON_TRACE_SCOPE(GET_VALUE, p_key_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	const PackedStringArray &lines = snapshot->dataset->lines;
+	_last_error.clear();
+	// A shaped container is only part of the value, so it neither reads nor fills the value cache.
+	int max_depth = 0;
+	Projection fields;
+	bool shaped = false;
+	if (!p_options.is_empty()) {
+		PBIJSON_COUNT_ALLOCATION(); // The field paths are parsed into a Projection.
+		max_depth = p_options.get("max_depth", 0);
+		PackedStringArray field_paths = _variant_to_string_list(p_options.get("fields", Array()));
+		for (int i = 0; i < field_paths.size(); ++i) {
+			fields.add(_parse_escaped_path(field_paths[i].rstrip("/")));
+		}
+		shaped = max_depth > 0 || !fields.fields.empty();
 	}
-	if (!is_data_loaded()) {
-		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN)));
-		_mutex->unlock();
+	Variant merged;
+	bool found = false;
+	if (_read_overlay(*snapshot, p_key_path, merged, found)) {
+		if (!found) {
+			_set_path_error(p_key_path);
+			return p_default;
+		}
+		if (shaped) {
+			return _shape_value(merged, max_depth > 0 ? max_depth : -1, p_options.get("stubs", true), nullptr, fields.fields.empty() ? nullptr : &fields, p_key_path.rstrip("/"));
+		}
+		return merged;
+	}
+	const CacheKey key(p_key_path);
+	Variant cached;
+	if (!shaped && is_cache_enabled(VALUE_CACHE) && snapshot->caches->try_get<Variant>(VALUE_CACHE, key, cached)) {
+		return cached;
+	}
+	if (!snapshot->dataset->is_loaded()) {
+		_set_error(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN);
+		return p_default;
+	}
+	PathLocation location;
+	if (!_locate_path(*snapshot, p_key_path, location, true)) {
 		return p_default;
 	}
-	PackedStringArray path_parts = _parse_escaped_path(p_key_path);
 	Variant result;
-	if (path_parts.is_empty() || (path_parts.size() == 1 && path_parts[0].is_empty())) {
-		bool is_root_array = false;
-		if (!_current_open_data.is_empty()) {
-			is_root_array = _get_line_key_part(_current_open_data[0]).begins_with("[");
-		}
-		result = _rebuild_container_from_slice(_current_open_data, 1, is_root_array);
-		if (is_cache_enabled(VALUE_CACHE)) {
-			_cache_manager->set<Variant>(VALUE_CACHE, key, result);
-		}
-		_mutex->unlock();
-		return result;
+	if (location.jump >= 0) {
+		PBIJSON_COUNT_ALLOCATION(); // Containers are rebuilt into new Arrays and Dictionaries.
 	}
-	int current_line_idx = 0;
-	int search_range_end = _current_open_data.size();
-	bool is_parent_array = false;
-	if (!_current_open_data.is_empty()) {
-		is_parent_array = _get_line_key_part(_current_open_data[0]).begins_with("[");
+	if (shaped && location.jump >= 0) {
+		int begin = location.children_begin();
+		int end = location.children_end();
+		bool is_array = begin < end && _line_has_index_key(lines[begin]);
+		bool stubs = p_options.get("stubs", true);
+		return _materialize(*snapshot, begin, end, is_array, max_depth > 0 ? max_depth : -1, stubs, nullptr, fields.fields.empty() ? nullptr : &fields, p_key_path.rstrip("/"));
 	}
-	for (int i = 0; i < path_parts.size(); ++i) {
-		const String &part_to_find = path_parts[i];
-		int expected_depth = i + 1;
-		Dictionary find_result = _find_part_in_range(part_to_find, expected_depth, current_line_idx, search_range_end, is_parent_array, p_key_path);
-		if (find_result.is_empty()) {
-			if (_last_error->get_error_type() == PreBuiltIndexJSONOutput::OK) {
-				_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Path part '" + part_to_find + "' not found.")));
-			}
-			_mutex->unlock();
-			return p_default;
-		}
-		current_line_idx = find_result["line_idx"];
-		const String &line_content = _current_open_data[current_line_idx];
-		if (i == path_parts.size() - 1) {
-			if (line_content.contains(String::chr(JUMP_MARKER_OPEN))) {
-				int jump_count = line_content.get_slice(String::chr(JUMP_MARKER_OPEN), 1).to_int();
-				PackedStringArray data_slice = _current_open_data.slice(current_line_idx + 1, current_line_idx + 1 + jump_count);
-				bool is_target_array = false;
-				if (!data_slice.is_empty()) {
-					is_target_array = _get_line_key_part(data_slice[0]).begins_with("[");
-				}
-				result = _rebuild_container_from_slice(data_slice, expected_depth + 1, is_target_array);
-			} else {
-				result = _get_line_value(line_content, current_line_idx);
-			}
-			if (is_cache_enabled(VALUE_CACHE)) {
-				_cache_manager->set<Variant>(VALUE_CACHE, key, result);
-			}
-			_mutex->unlock();
-			return result;
+	if (location.line_idx < 0) {
+		bool is_root_array = _get_line_key_part(lines[0]).begins_with("[");
+		result = _rebuild_container_from_slice(lines, 1, is_root_array);
+	} else if (location.jump >= 0) {
+		PackedStringArray data_slice = lines.slice(location.line_idx + 1, location.line_idx + 1 + location.jump);
+		bool is_target_array = false;
+		if (!data_slice.is_empty()) {
+			is_target_array = _get_line_key_part(data_slice[0]).begins_with("[");
 		}
-		if (!line_content.contains(String::chr(JUMP_MARKER_OPEN))) {
-			_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Path expects a container, but found a value at part '" + part_to_find + "'.")));
-			_mutex->unlock();
-			return p_default;
+		result = _rebuild_container_from_slice(data_slice, location.depth + 1, is_target_array);
+	} else if (location.element >= 0) {
+		result = _get_element_value(lines[location.line_idx], location.element);
+	} else {
+		result = _get_line_value(lines[location.line_idx], location.line_idx);
+	}
+	if (is_cache_enabled(VALUE_CACHE)) {
+		snapshot->caches->set<Variant>(VALUE_CACHE, key, result);
+	}
+	return result;
+}
+
+// The typed getters decode the leaf's text straight into T. A value already in the value cache
+// is converted instead, and text outside the decoder's subset is judged by what JSON parses it to.
+template <typename T, typename D, typename C>
+T PreBuiltIndexJSON::_get_typed_value(const String &p_key_path, const T &p_default, const char *p_expected, D &&p_decode, C &&p_convert) const {
+	PBIJSON_STATS_SCOPE(GET_TYPED);
+	PBIJSON_TRACE_SCOPE(GET_TYPED, p_key_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	_last_error.clear();
+	T value;
+	Variant merged;
+	bool found = false;
+	if (_read_overlay(*snapshot, p_key_path, merged, found)) {
+		if (!found) {
+			_set_path_error(p_key_path);
+		} else if (p_convert(merged, value)) {
+			return value;
+		} else {
+			_set_type_error(p_key_path, p_expected);
 		}
-		int jump_count = line_content.get_slice(String::chr(JUMP_MARKER_OPEN), 1).to_int();
-        if (current_line_idx + 1 < _current_open_data.size()) {
-		    is_parent_array = _get_line_key_part(_current_open_data[current_line_idx + 1]).begins_with("[");
-        } else {
-            is_parent_array = false;
-        }
-		current_line_idx += 1;
-		search_range_end = current_line_idx + jump_count;
+		return p_default;
 	}
-	_mutex->unlock();
+	Variant cached;
+	if (is_cache_enabled(VALUE_CACHE) && snapshot->caches->try_get<Variant>(VALUE_CACHE, CacheKey(p_key_path), cached)) {
+		if (p_convert(cached, value)) return value;
+		_set_type_error(p_key_path, p_expected);
+		return p_default;
+	}
+	int line_idx = -1;
+	int value_begin = 0;
+	int value_end = 0;
+	if (!_find_leaf(*snapshot, p_key_path, p_expected, line_idx, value_begin, value_end)) {
+		return p_default;
+	}
+	const String &line = snapshot->dataset->lines[line_idx];
+	if (p_decode(line, value_begin, value_end, value)) {
+		return value;
+	}
+	Variant parsed;
+	if (value_end == line.length()) {
+		parsed = _get_line_value(line, line_idx);
+	} else {
+		ValueDecoder::decode_value(line, value_begin, value_end, parsed);
+	}
+	if (p_convert(parsed, value)) {
+		return value;
+	}
+	_set_type_error(p_key_path, p_expected);
 	return p_default;
 }
 
-bool PreBuiltIndexJSON::has_path(const String &p_key_path) const {
-	_mutex->lock();
-	_last_error->clear();
-    const StringName key(p_key_path);
-	if (is_cache_enabled(HAS_PATH_CACHE) && _cache_manager->has(HAS_PATH_CACHE, key)) {
-        _mutex->unlock();
-		return _cache_manager->get<bool>(HAS_PATH_CACHE, key);
+int64_t PreBuiltIndexJSON::get_int(const String &p_key_path, int64_t p_default) const {
+	return _get_typed_value<int64_t>(p_key_path, p_default, "a number", ValueDecoder::decode_int, [](const Variant &p_value, int64_t &r_value) {
+		if (p_value.get_type() != Variant::INT && p_value.get_type() != Variant::FLOAT) return false;
+		r_value = p_value;
+		return true;
+	});
+}
+
+double PreBuiltIndexJSON::get_float(const String &p_key_path, double p_default) const {
+	return _get_typed_value<double>(p_key_path, p_default, "a number", ValueDecoder::decode_float, [](const Variant &p_value, double &r_value) {
+		if (p_value.get_type() != Variant::INT && p_value.get_type() != Variant::FLOAT) return false;
+		r_value = p_value;
+		return true;
+	});
+}
+
+bool PreBuiltIndexJSON::get_bool(const String &p_key_path, bool p_default) const {
+	return _get_typed_value<bool>(p_key_path, p_default, "a bool", ValueDecoder::decode_bool, [](const Variant &p_value, bool &r_value) {
+		if (p_value.get_type() != Variant::BOOL) return false;
+		r_value = p_value;
+		return true;
+	});
+}
+
+String PreBuiltIndexJSON::get_string(const String &p_key_path, const String &p_default) const {
+	return _get_typed_value<String>(p_key_path, p_default, "a string", ValueDecoder::decode_string, [](const Variant &p_value, String &r_value) {
+		if (p_value.get_type() != Variant::STRING) return false;
+		r_value = p_value;
+		return true;
+	});
+}
+
+String PreBuiltIndexJSON::get_json(const String &p_key_path, const String &p_indent) const {
+	JsonWriter writer(false);
+	if (!_export_json(p_key_path, p_indent, writer)) {
+		return String();
 	}
-	if (!is_data_loaded()) {
-		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN)));
-		_mutex->unlock();
-		return false;
+	return writer.get_string();
+}
+
+PackedByteArray PreBuiltIndexJSON::get_json_buffer(const String &p_key_path, const String &p_indent) const {
+	JsonWriter writer(true);
+	if (!_export_json(p_key_path, p_indent, writer)) {
+		return PackedByteArray();
 	}
-	PackedStringArray path_parts = _parse_escaped_path(p_key_path);
-	if (path_parts.is_empty() || (path_parts.size() == 1 && path_parts[0].is_empty())) {
-		_mutex->unlock();
-		return is_data_loaded();
+	return writer.get_bytes();
+}
+
+Error PreBuiltIndexJSON::store_json(const Ref<FileAccess> &p_file, const String &p_key_path, const String &p_indent) const {
+	if (p_file.is_null()) {
+		_set_error(PreBuiltIndexJSONOutput::ERR_FILE_NOT_OPEN, "store_json() needs a file opened for writing.");
+		return ERR_INVALID_PARAMETER;
 	}
-	int current_line_idx = 0;
-	int search_range_end = _current_open_data.size();
-	bool is_parent_array = _get_line_key_part(_current_open_data[0]).begins_with("[");
-	bool result = false;
-	for (int i = 0; i < path_parts.size(); ++i) {
-		const String &part_to_find = path_parts[i];
-		int expected_depth = i + 1;
-		Dictionary find_result = _find_part_in_range(part_to_find, expected_depth, current_line_idx, search_range_end, is_parent_array, p_key_path);
-		if (find_result.is_empty()) {
-			result = false;
-			if (is_cache_enabled(HAS_PATH_CACHE)) _cache_manager->set<bool>(HAS_PATH_CACHE, key, result);
-			_mutex->unlock();
-			return result;
-		}
-		if (i == path_parts.size() - 1) {
-			result = true;
-			if (is_cache_enabled(HAS_PATH_CACHE)) _cache_manager->set<bool>(HAS_PATH_CACHE, key, result);
-			_mutex->unlock();
-			return result;
-		}
-		current_line_idx = find_result["line_idx"];
-		const String &line_content = _current_open_data[current_line_idx];
-		if (!line_content.contains(String::chr(JUMP_MARKER_OPEN))) {
-			result = false;
-			if (is_cache_enabled(HAS_PATH_CACHE)) _cache_manager->set<bool>(HAS_PATH_CACHE, key, result);
-			_mutex->unlock();
-			return result;
-		}
-		int jump_count = line_content.get_slice(String::chr(JUMP_MARKER_OPEN), 1).to_int();
-        if (current_line_idx + 1 < _current_open_data.size()) {
-		    is_parent_array = _get_line_key_part(_current_open_data[current_line_idx + 1]).begins_with("[");
-        } else {
-            is_parent_array = false;
-        }
-		current_line_idx += 1;
-		search_range_end = current_line_idx + jump_count;
+	JsonWriter writer(p_file);
+	if (!_export_json(p_key_path, p_indent, writer)) {
+		writer.finish();
+		return ERR_INVALID_DATA;
 	}
-	result = false;
-	if (is_cache_enabled(HAS_PATH_CACHE)) _cache_manager->set<bool>(HAS_PATH_CACHE, key, result);
-	_mutex->unlock();
+	return writer.finish();
+}
+
+bool PreBuiltIndexJSON::has_path(const String &p_key_path) const {
+	PBIJSON_STATS_SCOPE(HAS_PATH);
+	PBIJSON_TRACE_SCOPE(HAS_PATH, p_key_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	_last_error.clear();
+	Variant merged;
+	bool found = false;
+	if (_read_overlay(*snapshot, p_key_path, merged, found)) {
+		return found;
+	}
+    const CacheKey key(p_key_path);
+	bool cached = false;
+	if (is_cache_enabled(HAS_PATH_CACHE) && snapshot->caches->try_get<bool>(HAS_PATH_CACHE, key, cached)) {
+        return cached;
+	}
+	if (!snapshot->dataset->is_loaded()) {
+		_set_error(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN);
+		return false;
+	}
+	PathLocation location;
+	bool result = _locate_path(*snapshot, p_key_path, location, false);
+	bool is_root = result && location.line_idx < 0;
+	if (!is_root && is_cache_enabled(HAS_PATH_CACHE)) snapshot->caches->set<bool>(HAS_PATH_CACHE, key, result);
 	return result;
 }
 
 int PreBuiltIndexJSON::get_size(const String &p_key_path) const {
-	_mutex->lock();
-    const StringName key(p_key_path);
-	if (is_cache_enabled(GET_SIZE_CACHE) && _cache_manager->has(GET_SIZE_CACHE, key)) {
-        _mutex->unlock();
-		return _cache_manager->get<int>(GET_SIZE_CACHE, key);
+	PBIJSON_STATS_SCOPE(GET_SIZE);
+	PBIJSON_TRACE_SCOPE(GET_SIZE, p_key_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	const PackedStringArray &lines = snapshot->dataset->lines;
+	Variant merged;
+	bool found = false;
+	if (_read_overlay(*snapshot, p_key_path, merged, found)) {
+		if (!found) _set_path_error(p_key_path);
+		return WriteOverlay::is_container(merged) ? (int)_get_child_keys(merged).size() : 0;
 	}
-	Dictionary slice_info = _find_container_slice(p_key_path);
+    const CacheKey key(p_key_path);
+	int cached = 0;
+	if (is_cache_enabled(GET_SIZE_CACHE) && snapshot->caches->try_get<int>(GET_SIZE_CACHE, key, cached)) {
+        return cached;
+	}
+	PathLocation location;
 	int size = 0;
-	if (!slice_info.is_empty()) {
-		int start_idx = slice_info["start_idx"];
-		int end_idx = slice_info["end_idx"];
-		int child_depth = slice_info["child_depth"];
-		for (int i = start_idx; i < end_idx; ++i) {
-			const String &line = _current_open_data[i];
-			if (_get_line_depth(line) == child_depth) {
-				size++;
-			}
-		}
+	if (_find_container_slice(*snapshot, p_key_path, location)) {
+		size = _count_children(*snapshot, location);
+	} else if (location.line_idx >= 0 && location.jump < 0 && location.element < 0) {
+		const String &line = lines[location.line_idx];
+		int64_t packed_size = ValueDecoder::get_packed_size(line, _get_line_key_end(line) + 1, line.length());
+		size = packed_size > 0 ? (int)packed_size : 0;
 	}
-	if (is_cache_enabled(GET_SIZE_CACHE)) _cache_manager->set<int>(GET_SIZE_CACHE, key, size);
-	_mutex->unlock();
+	if (is_cache_enabled(GET_SIZE_CACHE)) snapshot->caches->set<int>(GET_SIZE_CACHE, key, size);
 	return size;
 }
 
 Array PreBuiltIndexJSON::get_keys(const String &p_key_path) const {
-	_mutex->lock();
-    const StringName key(p_key_path);
-	if (is_cache_enabled(GET_KEYS_CACHE) && _cache_manager->has(GET_KEYS_CACHE, key)) {
-        _mutex->unlock();
-		return _cache_manager->get<Array>(GET_KEYS_CACHE, key);
+	PBIJSON_STATS_SCOPE(GET_KEYS);
+	PBIJSON_TRACE_SCOPE(GET_KEYS, p_key_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	const PackedStringArray &lines = snapshot->dataset->lines;
+	Variant merged;
+	bool found = false;
+	if (_read_overlay(*snapshot, p_key_path, merged, found)) {
+		if (!found) _set_path_error(p_key_path);
+		if (!WriteOverlay::is_container(merged)) return Array();
+		if (WriteOverlay::is_array(merged)) return _get_index_keys(_get_child_keys(merged).size());
+		return _get_child_keys(merged);
+	}
+    const CacheKey key(p_key_path);
+	Array cached;
+	if (is_cache_enabled(GET_KEYS_CACHE) && snapshot->caches->try_get<Array>(GET_KEYS_CACHE, key, cached)) {
+        return cached;
 	}
-	Dictionary slice_info = _find_container_slice(p_key_path);
+	PathLocation location;
 	Array keys;
-	if (!slice_info.is_empty()) {
-		int start_idx = slice_info["start_idx"];
-		int end_idx = slice_info["end_idx"];
-		int child_depth = slice_info["child_depth"];
-        Ref<JSON> json = memnew(JSON);
-		for (int i = start_idx; i < end_idx; ++i) {
-			const String &line = _current_open_data[i];
-			if (_get_line_depth(line) == child_depth) {
-				String key_part = _get_line_key_part(line);
-				Variant parsed_key = json->parse_string(key_part);
-				keys.append(parsed_key);
+	if (_find_container_slice(*snapshot, p_key_path, location)) {
+		int start_idx = location.children_begin();
+		int end_idx = location.children_end();
+		int child_depth = location.depth + 1;
+		const LineScanIndex &line_scan = snapshot->dataset->line_scan;
+		if (line_scan.size() == lines.size()) {
+			for (int i = line_scan.find_depth(start_idx, end_idx, child_depth); i < end_idx; i = line_scan.find_depth(i + 1, end_idx, child_depth)) {
+				keys.append(_parse_line_key(lines[i]));
+			}
+		} else {
+			for (int i = start_idx; i < end_idx; ++i) {
+				const String &line = lines[i];
+				if (_get_line_depth(line) == child_depth) {
+					keys.append(_parse_line_key(line));
+				}
 			}
 		}
+	} else if (_last_error->get_error_type() == PreBuiltIndexJSONOutput::OK && location.line_idx >= 0 && location.jump < 0 && location.element < 0) {
+		// A packed array is a single line, but it lists its elements like any array, as get_size() counts them.
+		const String &line = lines[location.line_idx];
+		int64_t packed_size = ValueDecoder::get_packed_size(line, _get_line_key_end(line) + 1, line.length());
+		if (packed_size > 0) keys = _get_index_keys(packed_size);
 	}
-	if (is_cache_enabled(GET_KEYS_CACHE)) _cache_manager->set<Array>(GET_KEYS_CACHE, key, keys);
-	_mutex->unlock();
+	if (is_cache_enabled(GET_KEYS_CACHE)) snapshot->caches->set<Array>(GET_KEYS_CACHE, key, keys);
 	return keys;
 }
 
 PackedStringArray PreBuiltIndexJSON::get_sub_paths(const String &p_key_path) const {
-	_mutex->lock();
-    const StringName key(p_key_path);
-	if (is_cache_enabled(GET_SUBPATHS_CACHE) && _cache_manager->has(GET_SUBPATHS_CACHE, key)) {
-        _mutex->unlock();
-		return _cache_manager->get<PackedStringArray>(GET_SUBPATHS_CACHE, key);
+	PBIJSON_STATS_SCOPE(GET_SUB_PATHS);
+	PBIJSON_TRACE_SCOPE(GET_SUB_PATHS, p_key_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	const PackedStringArray &lines = snapshot->dataset->lines;
+	Variant merged;
+	bool found = false;
+	if (_read_overlay(*snapshot, p_key_path, merged, found)) {
+		if (!found) _set_path_error(p_key_path);
+		PackedStringArray sub_paths;
+		// Walked depth-first like the lines, so each entry is followed by the entries inside it.
+		std::vector<std::pair<Variant, String>> pending;
+		pending.emplace_back(merged, p_key_path.rstrip("/"));
+		bool is_base = true;
+		while (!pending.empty()) {
+			Variant value = pending.back().first;
+			String path = pending.back().second;
+			pending.pop_back();
+			if (!is_base) sub_paths.append(path);
+			is_base = false;
+			if (!WriteOverlay::is_container(value)) continue;
+			bool is_array = WriteOverlay::is_array(value);
+			value = WriteOverlay::to_array(value);
+			Array keys = _get_child_keys(value);
+			for (int64_t i = keys.size() - 1; i >= 0; --i) {
+				String part = is_array ? String(JSON::parse_string("[" + String::num_int64(i) + "]")) : String(keys[i]);
+				Variant child;
+				WriteOverlay::get_child(value, is_array ? String::num_int64(i) : part, child);
+				pending.emplace_back(child, path.is_empty() ? part : path + "/" + part);
+			}
+		}
+		return sub_paths;
+	}
+    const CacheKey key(p_key_path);
+	PackedStringArray cached;
+	if (is_cache_enabled(GET_SUBPATHS_CACHE) && snapshot->caches->try_get<PackedStringArray>(GET_SUBPATHS_CACHE, key, cached)) {
+        return cached;
 	}
-	Dictionary slice_info = _find_container_slice(p_key_path);
+	PathLocation location;
 	PackedStringArray sub_paths;
-	if (!slice_info.is_empty()) {
+	if (_find_container_slice(*snapshot, p_key_path, location)) {
 		Array path_stack;
 		String base_path = p_key_path.rstrip("/");
 		if (!base_path.is_empty()) {
 			path_stack = base_path.split("/");
 		}
 		int base_depth = path_stack.size();
-        Ref<JSON> json = memnew(JSON);
-		for (int i = slice_info["start_idx"]; i < (int)slice_info["end_idx"]; ++i) {
-			const String &line = _current_open_data[i];
+		for (int i = location.children_begin(); i < location.children_end(); ++i) {
+			const String &line = lines[i];
 			int current_depth = _get_line_depth(line);
 			int relative_depth = current_depth - base_depth - 1;
-			String key_part = _get_line_key_part(line);
-			Variant parsed_key = json->parse_string(key_part);
+			Variant parsed_key = _parse_line_key(line);
 			while (path_stack.size() > base_depth + relative_depth) {
 				path_stack.pop_back();
 			}
 			path_stack.push_back(String(parsed_key));
 			sub_paths.append(String("/").join(path_stack));
 		}
+	} else if (_last_error->get_error_type() == PreBuiltIndexJSONOutput::OK && location.line_idx >= 0 && location.jump < 0 && location.element < 0) {
+		// The elements of a packed array have no lines of their own, and no sub paths below them.
+		const String &line = lines[location.line_idx];
+		int64_t packed_size = ValueDecoder::get_packed_size(line, _get_line_key_end(line) + 1, line.length());
+		String base_path = p_key_path.rstrip("/");
+		Array index_keys = _get_index_keys(packed_size > 0 ? packed_size : 0);
+		for (int64_t i = 0; i < index_keys.size(); ++i) {
+			sub_paths.append(base_path + "/" + String(index_keys[i]));
+		}
 	}
-	if (is_cache_enabled(GET_SUBPATHS_CACHE)) _cache_manager->set<PackedStringArray>(GET_SUBPATHS_CACHE, key, sub_paths);
-	_mutex->unlock();
+	if (is_cache_enabled(GET_SUBPATHS_CACHE)) snapshot->caches->set<PackedStringArray>(GET_SUBPATHS_CACHE, key, sub_paths);
 	return sub_paths;
 }
 
-Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::open_file(const String &p_path,const bool &ignore_hash) {
-	_mutex->lock();
-	clear_caches();
-	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
-	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::ModeFlags::READ);
-	if (file.is_null()) {
-		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(FileAccess::get_open_error())));
-		_mutex->unlock();
-		return _last_error;
+Array PreBuiltIndexJSON::query(const String &p_container_path, const Variant &p_predicate, bool p_return_paths) const {
+	PBIJSON_STATS_SCOPE(QUERY);
+	PBIJSON_TRACE_SCOPE(QUERY, p_container_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	const PackedStringArray &lines = snapshot->dataset->lines;
+	Array matches;
+	PathLocation location;
+	Variant merged;
+	bool found = false;
+	bool overlaid = _read_overlay(*snapshot, p_container_path, merged, found);
+	if (overlaid) {
+		_last_error.clear();
+		if (!found) _set_path_error(p_container_path);
+		if (!WriteOverlay::is_container(merged)) return matches;
+		merged = WriteOverlay::to_array(merged);
+	} else if (!_find_container_slice(*snapshot, p_container_path, location)) {
+		// A packed array is a leaf line; its elements are matched like those of a merged array.
+		if (_last_error->get_error_type() != PreBuiltIndexJSONOutput::OK || !_read_packed_line(*snapshot, location, merged)) return matches;
+		overlaid = true;
 	}
-	_current_open_file = p_path;
-	_current_open_data = file->get_as_text().split("\n", false);
-	_open_data(_current_open_data,ignore_hash);
-	_mutex->unlock();
-	return _last_error;
-}
-
-Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::open_from_string(const String &p_data,const bool &ignore_hash) {
-	_mutex->lock();
-	_current_open_file = "";
-	Ref<PreBuiltIndexJSONOutput> output= _open_data(p_data.split("\n", false),ignore_hash);
-	_mutex->unlock();
-	return output;
-}
+	QueryPredicate predicate;
+	if (!predicate.compile(p_predicate)) {
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_QUERY_PARSE, predicate.get_error())));
+		return matches;
+	}
+	String base_path = p_container_path.rstrip("/");
 
-Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::open_from_array(const PackedStringArray &p_data,const bool &ignore_hash) {
-	_mutex->lock();
-	clear_caches();
-	_current_open_file = "";
-	Ref<PreBuiltIndexJSONOutput> output= _open_data(p_data,ignore_hash);
-	_mutex->unlock();
-	return output;
-}
+	if (overlaid) {
+		// A container with pending changes, or a packed array, is matched record by record on
+		// its value; fields are written back to JSON text, which is what the predicate compares.
+		struct MergedResolver {
+			std::vector<PackedStringArray> field_parts;
+			Variant record;
 
-Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_open_data(const PackedStringArray &p_data,const bool &ignore_hash) {
-	clear_caches();
-	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
-	if (p_data.size() <1) {
-		return _last_error;
+			bool resolve(int p_field, String &r_raw, bool &r_is_container) {
+				Variant value = record;
+				if (!WriteOverlay::navigate(value, field_parts[p_field], 0)) return false;
+				r_is_container = value.get_type() == Variant::DICTIONARY || value.get_type() == Variant::ARRAY;
+				r_raw = r_is_container ? String() : JSON::stringify(value);
+				return true;
+			}
+		};
+		MergedResolver resolver;
+		for (int i = 0; i < predicate.get_field_count(); ++i) {
+			resolver.field_parts.push_back(_parse_escaped_path(predicate.get_field(i)));
+		}
+		Array keys = _get_child_keys(merged);
+		for (int64_t i = 0; i < keys.size(); ++i) {
+			WriteOverlay::get_child(merged, String(keys[i]), resolver.record);
+			if (!predicate.evaluate(resolver)) continue;
+			if (p_return_paths) {
+				String escaped_key = _escape_path_part(String(keys[i]));
+				matches.append(base_path.is_empty() ? escaped_key : base_path + "/" + escaped_key);
+			} else {
+				matches.append(keys[i]);
+			}
+		}
+		return matches;
 	}
-	
-	Dictionary header = _parse_header(p_data.get(0));
+
+	// Resolves predicate fields relative to the current record, straight from the flat lines.
+	// Each field is looked up at most once per record.
+	struct RecordResolver {
+		const PreBuiltIndexJSON *self = nullptr;
+		const Snapshot *snapshot = nullptr;
+		std::vector<PathView> field_paths;
+		std::vector<int> state; // 0 = unresolved, 1 = found, 2 = missing
+		std::vector<String> raw_values;
+		std::vector<bool> is_container;
+		int record_line = 0;
+		int record_jump = -1;
+		int child_depth = 0;
+
+		void reset(int p_line, int p_jump) {
+			record_line = p_line;
+			record_jump = p_jump;
+			std::fill(state.begin(), state.end(), 0);
+		}
+
+		bool resolve(int p_field, String &r_raw, bool &r_is_container) {
+			if (state[p_field] == 0) {
+				const PathView &path = field_paths[p_field];
+				int line_idx = record_line;
+				if (path.size() > 0) {
+					line_idx = record_jump > 0 ? self->_find_relative_line(*snapshot, path, child_depth + 1, record_line + 1, record_line + 1 + record_jump) : -1;
+				}
+				if (line_idx < 0) {
+					state[p_field] = 2;
+				} else {
+					const String &line = snapshot->dataset->lines[line_idx];
+					is_container[p_field] = self->_get_line_jump(line) >= 0;
+					raw_values[p_field] = is_container[p_field] ? String() : self->_get_line_raw_value(line);
+					state[p_field] = 1;
+				}
+			}
+			if (state[p_field] == 2) return false;
+			r_raw = raw_values[p_field];
+			r_is_container = is_container[p_field];
+			return true;
+		}
+	};
+
+	RecordResolver resolver;
+	resolver.self = this;
+	resolver.snapshot = snapshot.get();
+	resolver.child_depth = location.depth + 1;
+	for (int i = 0; i < predicate.get_field_count(); ++i) {
+		resolver.field_paths.emplace_back(predicate.get_field(i));
+	}
+	resolver.state.resize(predicate.get_field_count(), 0);
+	resolver.raw_values.resize(predicate.get_field_count());
+	resolver.is_container.resize(predicate.get_field_count(), false);
+
+	int start_idx = location.children_begin();
+	int end_idx = location.children_end();
+	for (int i = start_idx; i < end_idx; ) {
+		const String &line = lines[i];
+		int jump = _get_line_jump(line);
+		if (_get_line_depth(line) != resolver.child_depth) {
+			i++;
+			continue;
+		}
+		resolver.reset(i, jump);
+		if (predicate.evaluate(resolver)) {
+			Variant key = _get_line_key(line);
+			if (p_return_paths) {
+				String escaped_key = _escape_path_part(String(key));
+				matches.append(base_path.is_empty() ? escaped_key : base_path + "/" + escaped_key);
+			} else {
+				matches.append(key);
+			}
+		}
+		// Skip the record's subtree in one step.
+		i += 1 + (jump > 0 ? jump : 0);
+	}
+	return matches;
+}
+
+template <typename F>
+bool PreBuiltIndexJSON::_scan_numeric_field(const Snapshot &p_snapshot, const String &p_collection_path, const String &p_field_path, F &&p_callback) const {
+	PathLocation location;
+	if (!_find_container_slice(p_snapshot, p_collection_path, location)) return false;
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	const PathView field_path(p_field_path);
+	int start_idx = location.children_begin();
+	int end_idx = location.children_end();
+	int child_depth = location.depth + 1;
+	for (int i = start_idx; i < end_idx; ) {
+		const String &line = lines[i];
+		int jump = _get_line_jump(line);
+		if (_get_line_depth(line) != child_depth) {
+			i++;
+			continue;
+		}
+		int field_line = i;
+		if (field_path.size() > 0) {
+			field_line = jump > 0 ? _find_relative_line(p_snapshot, field_path, child_depth + 1, i + 1, i + 1 + jump) : -1;
+		}
+		if (field_line >= 0) {
+			String raw = _get_line_raw_value(lines[field_line]);
+			if (!raw.is_empty() && (raw[0] == U'-' || (raw[0] >= U'0' && raw[0] <= U'9'))) {
+				p_callback(i, raw.to_float());
+			}
+		}
+		i += 1 + (jump > 0 ? jump : 0);
+	}
+	return true;
+}
+
+// _scan_numeric_field() over a collection that pending changes have already built, or over the
+// elements of a packed array. Records are reported by their child index.
+template <typename F>
+bool PreBuiltIndexJSON::_scan_numeric_value(const Variant &p_collection, const String &p_field_path, F &&p_callback) const {
+	if (!WriteOverlay::is_container(p_collection)) return false;
+	const Variant collection = WriteOverlay::to_array(p_collection);
+	PackedStringArray field_parts = _parse_escaped_path(p_field_path);
+	Array keys = _get_child_keys(collection);
+	for (int64_t i = 0; i < keys.size(); ++i) {
+		Variant value;
+		WriteOverlay::get_child(collection, String(keys[i]), value);
+		if (!WriteOverlay::navigate(value, field_parts, 0)) continue;
+		if (value.get_type() == Variant::INT || value.get_type() == Variant::FLOAT) {
+			p_callback((int)i, (double)value);
+		}
+	}
+	return true;
+}
+
+Dictionary PreBuiltIndexJSON::aggregate(const String &p_collection_path, const String &p_field_path) const {
+	PBIJSON_STATS_SCOPE(AGGREGATE);
+	PBIJSON_TRACE_SCOPE(AGGREGATE, p_collection_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	const CacheKey key(p_collection_path + "\n" + p_field_path + "\naggregate");
+	Variant merged;
+	bool merged_found = false;
+	bool overlaid = _read_overlay(*snapshot, p_collection_path, merged, merged_found);
+	Variant cached;
+	if (!overlaid && is_cache_enabled(AGGREGATE_CACHE) && snapshot->caches->try_get<Variant>(AGGREGATE_CACHE, key, cached)) {
+		return cached;
+	}
+	int64_t count = 0;
+	double sum = 0.0;
+	double min_value = 0.0;
+	double max_value = 0.0;
+	auto add_value = [&](int p_record, double p_value) {
+		if (count == 0 || p_value < min_value) min_value = p_value;
+		if (count == 0 || p_value > max_value) max_value = p_value;
+		sum += p_value;
+		count++;
+	};
+	bool found = false;
+	if (overlaid) {
+		if (!merged_found) _set_path_error(p_collection_path);
+		found = merged_found && _scan_numeric_value(merged, p_field_path, add_value);
+	} else {
+		found = _scan_numeric_field(*snapshot, p_collection_path, p_field_path, add_value);
+		if (!found && _read_packed_path(*snapshot, p_collection_path, merged)) {
+			found = _scan_numeric_value(merged, p_field_path, add_value);
+		}
+	}
+	Dictionary result;
+	if (!found) {
+		return result;
+	}
+	result["count"] = count;
+	result["sum"] = sum;
+	result["min"] = count > 0 ? Variant(min_value) : Variant();
+	result["max"] = count > 0 ? Variant(max_value) : Variant();
+	result["avg"] = count > 0 ? Variant(sum / count) : Variant();
+	if (!overlaid && is_cache_enabled(AGGREGATE_CACHE)) snapshot->caches->set<Variant>(AGGREGATE_CACHE, key, result);
+	return result;
+}
+
+Array PreBuiltIndexJSON::top_k(const String &p_collection_path, const String &p_field_path, int p_k, bool p_ascending) const {
+	PBIJSON_STATS_SCOPE(TOP_K);
+	PBIJSON_TRACE_SCOPE(TOP_K, p_collection_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	const PackedStringArray &lines = snapshot->dataset->lines;
+	const CacheKey key(p_collection_path + "\n" + p_field_path + "\ntop_k:" + String::num_int64(p_k) + (p_ascending ? ":asc" : ":desc"));
+	Variant merged;
+	bool merged_found = false;
+	bool overlaid = _read_overlay(*snapshot, p_collection_path, merged, merged_found);
+	Variant cached;
+	if (!overlaid && is_cache_enabled(AGGREGATE_CACHE) && snapshot->caches->try_get<Variant>(AGGREGATE_CACHE, key, cached)) {
+		return cached;
+	}
+	Array result;
+	if (p_k <= 0) {
+		return result;
+	}
+	// Bounded heap of (value, record line). The heap top is the entry that would be
+	// evicted next, so it only ever holds k elements. It is not reserved up front: k comes
+	// from the caller and may be far larger than the collection.
+	typedef std::pair<double, int> Entry;
+	std::vector<Entry> heap;
+	auto evict_first = [p_ascending](const Entry &a, const Entry &b) {
+		return p_ascending ? a.first < b.first : a.first > b.first;
+	};
+	// Records are line indices, or child indices into the merged collection.
+	auto add_value = [&](int p_record, double p_value) {
+		if ((int)heap.size() < p_k) {
+			heap.push_back(Entry(p_value, p_record));
+			std::push_heap(heap.begin(), heap.end(), evict_first);
+		} else if (evict_first(Entry(p_value, p_record), heap.front())) {
+			std::pop_heap(heap.begin(), heap.end(), evict_first);
+			heap.back() = Entry(p_value, p_record);
+			std::push_heap(heap.begin(), heap.end(), evict_first);
+		}
+	};
+	bool found = false;
+	bool by_child_index = overlaid;
+	Array merged_keys;
+	if (overlaid) {
+		if (!merged_found) _set_path_error(p_collection_path);
+		found = merged_found && _scan_numeric_value(merged, p_field_path, add_value);
+		merged_keys = _get_child_keys(merged);
+	} else {
+		found = _scan_numeric_field(*snapshot, p_collection_path, p_field_path, add_value);
+		if (!found && _read_packed_path(*snapshot, p_collection_path, merged)) {
+			by_child_index = true;
+			found = _scan_numeric_value(merged, p_field_path, add_value);
+			merged_keys = _get_child_keys(merged);
+		}
+	}
+	if (!found) {
+		return result;
+	}
+	std::sort_heap(heap.begin(), heap.end(), evict_first);
+	for (const Entry &entry : heap) {
+		Dictionary item;
+		item["key"] = by_child_index ? merged_keys[entry.second] : _get_line_key(lines[entry.second]);
+		item["value"] = entry.first;
+		result.append(item);
+	}
+	if (!overlaid && is_cache_enabled(AGGREGATE_CACHE)) snapshot->caches->set<Variant>(AGGREGATE_CACHE, key, result);
+	return result;
+}
+
+// Compares the value key of an IDX entry (`line,line,...>value_key`) with p_value_key in the
+// order of String::operator<, reading the entry in place.
+static int _compare_index_entry(const String &p_entry, const String &p_value_key) {
+	const char32_t *chars = p_entry.ptr();
+	int length = p_entry.length();
+	int pos = 0;
+	while (pos < length && chars[pos] != U'>') pos++;
+	pos++;
+	const char32_t *key = p_value_key.ptr();
+	int key_length = p_value_key.length();
+	int i = 0;
+	for (; pos < length && i < key_length; ++pos, ++i) {
+		if (chars[pos] != key[i]) return chars[pos] < key[i] ? -1 : 1;
+	}
+	if (pos < length) return 1;
+	return i < key_length ? -1 : 0;
+}
+
+PackedStringArray PreBuiltIndexJSON::find_by(const String &p_field_path, const Variant &p_value) const {
+	PBIJSON_STATS_SCOPE(FIND_BY);
+	PBIJSON_TRACE_SCOPE(FIND_BY, p_field_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	_last_error.clear();
+	PackedStringArray record_paths;
+	if (!snapshot->dataset->is_loaded()) {
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN)));
+		return record_paths;
+	}
+	String pattern = p_field_path.rstrip("/");
+	if (!snapshot->dataset->field_indexes.has(pattern)) {
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Field '" + pattern + "' is not indexed. Add it to the \"index_fields\" build option.")));
+		return record_paths;
+	}
+	String value_key = _index_value_key(p_value);
+	PackedStringArray pattern_parts = _parse_escaped_path(pattern);
+	int fixed_parts = 0;
+	while (fixed_parts < pattern_parts.size() && pattern_parts[fixed_parts] != "*") {
+		fixed_parts++;
+	}
+	Variant merged;
+	bool found = false;
+	if (_read_overlay(*snapshot, _join_path(pattern_parts.slice(0, fixed_parts)), merged, found)) {
+		// The index describes the loaded lines, so records under pending changes are searched
+		// on their merged values instead, in the same depth-first order.
+		int record_level = fixed_parts;
+		for (int i = fixed_parts; i < pattern_parts.size(); ++i) {
+			if (pattern_parts[i] == "*") record_level = i;
+		}
+		struct Step {
+			Variant value;
+			int part = 0;
+			String path;
+			String record_path;
+		};
+		std::vector<Step> pending;
+		if (found) {
+			pending.push_back({ merged, fixed_parts, _join_path(pattern_parts.slice(0, fixed_parts)), String() });
+		}
+		while (!pending.empty()) {
+			Step step = pending.back();
+			pending.pop_back();
+			if (step.part == pattern_parts.size()) {
+				if (!WriteOverlay::is_container(step.value) && _index_value_key(step.value) == value_key) {
+					record_paths.append(step.record_path);
+				}
+				continue;
+			}
+			Array keys;
+			if (pattern_parts[step.part] == "*") {
+				keys = _get_child_keys(step.value);
+			} else {
+				keys.append(pattern_parts[step.part]);
+			}
+			for (int64_t i = keys.size() - 1; i >= 0; --i) {
+				Step next;
+				String part = keys[i];
+				if (!WriteOverlay::get_child(step.value, part, next.value)) continue;
+				next.part = step.part + 1;
+				String escaped = _escape_path_part(part);
+				next.path = step.path.is_empty() ? escaped : step.path + "/" + escaped;
+				next.record_path = step.part == record_level ? next.path : step.record_path;
+				pending.push_back(next);
+			}
+		}
+		return record_paths;
+	}
+	Vector2i range = snapshot->dataset->field_indexes[pattern];
+	// Entries are `line,line,...>value_key`, sorted by value_key.
+	int low = range.x;
+	int high = range.x + range.y;
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (_compare_index_entry(snapshot->dataset->section_data[mid], value_key) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (low < range.x + range.y) {
+		const String &entry = snapshot->dataset->section_data[low];
+		if (_compare_index_entry(entry, value_key) == 0) {
+			int separator_pos = entry.find(">");
+			PackedStringArray record_lines = entry.substr(0, separator_pos).split(",", false);
+			for (int i = 0; i < record_lines.size(); ++i) {
+				record_paths.append(_get_path_for_line(*snapshot, record_lines[i].to_int()));
+			}
+		}
+	}
+	return record_paths;
+}
+
+PackedStringArray PreBuiltIndexJSON::get_indexed_fields() const {
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	PackedStringArray fields = _variant_to_string_list(snapshot->dataset->field_indexes.keys());
+	return fields;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::set_value(const String &p_key_path, const Variant &p_value) {
+	return _edit(p_key_path, p_value, false);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::erase_path(const String &p_key_path) {
+	return _edit(p_key_path, Variant(), true);
+}
+
+int PreBuiltIndexJSON::get_pending_change_count() const {
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	return snapshot->overlay ? (int)snapshot->overlay->edits.size() : 0;
+}
+
+void PreBuiltIndexJSON::discard_changes() {
+	_mutex->lock();
+	_publish_overlay(nullptr);
+	_mutex->unlock();
+}
+
+// The merged data is rebuilt like a parsed JSON document: the sections address lines by number,
+// so they are regenerated along with the lines. The build holds the mutex so edits wait for it;
+// the new lines are then loaded without it, and only published if nothing changed meanwhile.
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::compact(const Dictionary &p_options) {
+	_mutex->lock();
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	Ref<PreBuiltIndexJSONOutput> output = _build_merged(p_options);
+	_mutex->unlock();
+	if (!output->has_data()) {
+		return output;
+	}
+	std::shared_ptr<Dataset> dataset;
+	output = _load_dataset(output->get_data().split("\n", false), false, dataset);
+	if (dataset) {
+		_mutex->lock();
+		if (_get_snapshot() != snapshot) {
+			// An edit or a load landed while the lines were parsed; publishing them would undo it.
+			output = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(ERR_BUSY, "The compacted data was discarded because the data changed while it was loaded.")));
+			_last_error = output;
+		} else {
+			// Still tied to the file it was opened from, so reload_file() and hot_reload() keep working.
+			_commit_dataset(dataset, snapshot->file, false);
+		}
+		_mutex->unlock();
+	}
+	return output;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::save_to(const String &p_target_path, const Dictionary &p_options) {
+	Ref<PreBuiltIndexJSONOutput> output = _build_merged(p_options);
+	if (!output->has_data()) {
+		return output;
+	}
+	return _store_build(output, p_target_path);
+}
+
+static Dictionary _patch_op(const String &p_op, const String &p_path, const Variant &p_value = Variant()) {
+	Dictionary op;
+	op["op"] = p_op;
+	op["path"] = p_path;
+	if (p_op != "remove") op["value"] = p_value;
+	return op;
+}
+
+// Both files write keys in sorted order and every container's entries in one block, so the two
+// versions are compared in a single merge walk: an unchanged leaf costs one comparison of its
+// text, and only added or changed values are rebuilt for the patch.
+Dictionary PreBuiltIndexJSON::diff(const Ref<PreBuiltIndexJSON> &p_other) const {
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	_last_error.clear();
+	Dictionary patch;
+	if (!snapshot->dataset->is_loaded() || p_other.is_null() || !p_other->is_data_loaded()) {
+		_set_error(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN, "diff() needs data loaded in both instances.");
+		return patch;
+	}
+	const PreBuiltIndexJSON &other = *p_other.ptr();
+	std::shared_ptr<const Snapshot> other_snapshot = other._get_snapshot();
+	const PackedStringArray &old_lines = snapshot->dataset->lines;
+	const PackedStringArray &new_lines = other_snapshot->dataset->lines;
+	Array ops;
+	bool is_array = _line_has_index_key(old_lines[0]);
+	if (is_array != other._line_has_index_key(new_lines[0])) {
+		Variant value;
+		other._read_base_value(*other_snapshot, String(), value);
+		ops.append(_patch_op("replace", String(), value));
+	} else {
+		_diff_range(*snapshot, 0, old_lines.size(), other, *other_snapshot, 0, new_lines.size(), is_array, String(), ops);
+	}
+	patch["base_hash"] = snapshot->dataset->content_hash;
+	patch["target_hash"] = other_snapshot->dataset->content_hash;
+	patch["ops"] = ops;
+	return patch;
+}
+
+// Operations are ordered so that replaying them never shifts an index a later one relies on.
+// Inside an array, the unchanged elements at both ends are skipped, so inserting or removing a
+// few elements costs as many operations, however long the array; the elements between are
+// compared by position, then the extra new ones are inserted in ascending order or the extra
+// old ones are removed from the end.
+void PreBuiltIndexJSON::_diff_range(const Snapshot &p_old, int p_old_begin, int p_old_end, const PreBuiltIndexJSON &p_other, const Snapshot &p_new, int p_new_begin, int p_new_end, bool p_is_array, const String &p_path, Array &r_ops) const {
+	const PackedStringArray &old_lines = p_old.dataset->lines;
+	const PackedStringArray &new_lines = p_new.dataset->lines;
+	auto next_old = [&](int p_line) { int jump = _get_line_jump(old_lines[p_line]); return p_line + 1 + (jump > 0 ? jump : 0); };
+	auto next_new = [&](int p_line) { int jump = p_other._get_line_jump(new_lines[p_line]); return p_line + 1 + (jump > 0 ? jump : 0); };
+	auto child_path = [&](const String &p_part) { return p_path.is_empty() ? p_part : p_path + "/" + p_part; };
+	if (p_is_array) {
+		std::vector<int> old_elements;
+		std::vector<int> new_elements;
+		for (int i = p_old_begin; i < p_old_end; i = next_old(i)) {
+			old_elements.push_back(i);
+		}
+		for (int j = p_new_begin; j < p_new_end; j = next_new(j)) {
+			new_elements.push_back(j);
+		}
+		// Two elements are the same if all their lines are, apart from the index in the first.
+		auto same_element = [&](int p_old_line, int p_new_line) {
+			int count = next_old(p_old_line) - p_old_line;
+			if (count != next_new(p_new_line) - p_new_line) return false;
+			const String &old_line = old_lines[p_old_line];
+			const String &new_line = new_lines[p_new_line];
+			int old_begin = _get_line_key_end(old_line);
+			int new_begin = p_other._get_line_key_end(new_line);
+			int length = old_line.length() - old_begin;
+			if (length != new_line.length() - new_begin || memcmp(old_line.ptr() + old_begin, new_line.ptr() + new_begin, length * sizeof(char32_t)) != 0) return false;
+			for (int k = 1; k < count; ++k) {
+				if (old_lines[p_old_line + k] != new_lines[p_new_line + k]) return false;
+			}
+			return true;
+		};
+		const int old_count = (int)old_elements.size();
+		const int new_count = (int)new_elements.size();
+		int prefix = 0;
+		while (prefix < old_count && prefix < new_count && same_element(old_elements[prefix], new_elements[prefix])) {
+			prefix++;
+		}
+		int suffix = 0;
+		while (suffix < old_count - prefix && suffix < new_count - prefix && same_element(old_elements[old_count - 1 - suffix], new_elements[new_count - 1 - suffix])) {
+			suffix++;
+		}
+		const int old_middle = old_count - prefix - suffix;
+		const int new_middle = new_count - prefix - suffix;
+		const int paired = std::min(old_middle, new_middle);
+		for (int k = 0; k < paired; ++k) {
+			_diff_line(p_old, old_elements[prefix + k], p_other, p_new, new_elements[prefix + k], child_path(String::num_int64(prefix + k)), r_ops);
+		}
+		for (int k = paired; k < new_middle; ++k) {
+			r_ops.append(_patch_op("add", child_path(String::num_int64(prefix + k)), p_other._read_line_entry(p_new, new_elements[prefix + k])));
+		}
+		for (int k = old_middle - 1; k >= paired; --k) {
+			r_ops.append(_patch_op("remove", child_path(String::num_int64(prefix + k))));
+		}
+		return;
+	}
+	int i = p_old_begin;
+	int j = p_new_begin;
+	while (i < p_old_end && j < p_new_end) {
+		String old_key = _get_line_key(old_lines[i]);
+		String new_key = p_other._get_line_key(new_lines[j]);
+		if (old_key == new_key) {
+			_diff_line(p_old, i, p_other, p_new, j, child_path(_escape_path_part(old_key)), r_ops);
+			i = next_old(i);
+			j = next_new(j);
+		} else if (old_key < new_key) {
+			r_ops.append(_patch_op("remove", child_path(_escape_path_part(old_key))));
+			i = next_old(i);
+		} else {
+			r_ops.append(_patch_op("add", child_path(_escape_path_part(new_key)), p_other._read_line_entry(p_new, j)));
+			j = next_new(j);
+		}
+	}
+	for (; j < p_new_end; j = next_new(j)) {
+		r_ops.append(_patch_op("add", child_path(_escape_path_part(p_other._get_line_key(new_lines[j]))), p_other._read_line_entry(p_new, j)));
+	}
+	for (; i < p_old_end; i = next_old(i)) {
+		r_ops.append(_patch_op("remove", child_path(_escape_path_part(_get_line_key(old_lines[i])))));
+	}
+}
+
+void PreBuiltIndexJSON::_diff_line(const Snapshot &p_old, int p_old_line, const PreBuiltIndexJSON &p_other, const Snapshot &p_new, int p_new_line, const String &p_path, Array &r_ops) const {
+	const String &old_line = p_old.dataset->lines[p_old_line];
+	const String &new_line = p_new.dataset->lines[p_new_line];
+	int old_jump = _get_line_jump(old_line);
+	int new_jump = p_other._get_line_jump(new_line);
+	if (old_jump > 0 && new_jump > 0) {
+		bool is_array = _line_has_index_key(p_old.dataset->lines[p_old_line + 1]);
+		if (is_array == p_other._line_has_index_key(p_new.dataset->lines[p_new_line + 1])) {
+			_diff_range(p_old, p_old_line + 1, p_old_line + 1 + old_jump, p_other, p_new, p_new_line + 1, p_new_line + 1 + new_jump, is_array, p_path, r_ops);
+			return;
+		}
+	} else if (old_jump < 0 && new_jump < 0) {
+		// Values are compared as the text the builder wrote, without decoding them.
+		int old_begin = _get_line_key_end(old_line) + 1;
+		int new_begin = p_other._get_line_key_end(new_line) + 1;
+		int length = old_line.length() - old_begin;
+		if (length == new_line.length() - new_begin && memcmp(old_line.ptr() + old_begin, new_line.ptr() + new_begin, length * sizeof(char32_t)) == 0) {
+			return;
+		}
+	}
+	r_ops.append(_patch_op("replace", p_path, p_other._read_line_entry(p_new, p_new_line)));
+}
+
+// Replays the operations as pending changes, all or none: if one fails, the changes made by the
+// earlier ones are withdrawn again.
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::apply_patch(const Dictionary &p_patch) {
+	_mutex->lock();
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	String base_hash = p_patch.get("base_hash", String());
+	if (!base_hash.is_empty() && !snapshot->dataset->content_hash.is_empty() && base_hash != snapshot->dataset->content_hash) {
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_HASH, "The patch was made for other data than the data loaded.")));
+		_mutex->unlock();
+		return _last_error;
+	}
+	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+	// All operations go into one working copy of the pending changes, which is only published
+	// once every operation has been checked; a failing patch leaves the data as it was.
+	std::shared_ptr<WriteOverlay> overlay;
+	std::shared_ptr<Snapshot> working = _begin_edits(overlay);
+	Array ops = p_patch.get("ops", Array());
+	bool applied = true;
+	for (int64_t i = 0; i < ops.size() && applied; ++i) {
+		Dictionary op = ops[i];
+		String kind = op.get("op", String());
+		String path = op.get("path", String());
+		if (kind == "remove") {
+			applied = _add_edit(*working, *overlay, path, Variant(), true, false);
+		} else if ((kind == "add" || kind == "replace") && op.has("value")) {
+			// As in JSON Patch, adding to an array inserts before the element at the index.
+			applied = _add_edit(*working, *overlay, path, op["value"], false, kind == "add");
+		} else {
+			_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_FORMAT, "Malformed patch operation " + String::num_int64(i) + ".")));
+			applied = false;
+		}
+	}
+	if (applied && !ops.is_empty()) {
+		std::atomic_store(&_snapshot, std::shared_ptr<const Snapshot>(working));
+	}
+	_mutex->unlock();
+	return _last_error;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_build_merged(const Dictionary &p_options) {
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+	if (!snapshot->dataset->is_loaded()) {
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN)));
+		return _last_error;
+	}
+	Variant data;
+	bool found = false;
+	if (!_read_overlay(*snapshot, String(), data, found)) {
+		_read_base_value(*snapshot, String(), data);
+	}
+	return _build_from_data(data, p_options);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_edit(const String &p_key_path, const Variant &p_value, bool p_erase) {
+	_mutex->lock();
+	std::shared_ptr<WriteOverlay> overlay;
+	std::shared_ptr<Snapshot> working = _begin_edits(overlay);
+	if (_add_edit(*working, *overlay, p_key_path, p_value, p_erase, false)) {
+		std::atomic_store(&_snapshot, std::shared_ptr<const Snapshot>(working));
+	}
+	_mutex->unlock();
+	return _last_error;
+}
+
+// Called with the mutex held. An unpublished copy of the current snapshot with its own copy of
+// the pending changes, which _add_edit() extends; publishing it makes all of them visible at once.
+std::shared_ptr<PreBuiltIndexJSON::Snapshot> PreBuiltIndexJSON::_begin_edits(std::shared_ptr<WriteOverlay> &r_overlay) {
+	std::shared_ptr<const Snapshot> previous = _get_snapshot();
+	r_overlay = previous->overlay ? std::make_shared<WriteOverlay>(*previous->overlay) : std::make_shared<WriteOverlay>();
+	std::shared_ptr<Snapshot> working = std::make_shared<Snapshot>();
+	working->file = previous->file;
+	working->dataset = previous->dataset;
+	working->overlay = r_overlay;
+	working->caches = previous->caches;
+	return working;
+}
+
+// Checks the edit against p_working as it currently reads, pending changes included, so that
+// replaying the edits in order never meets a path that does not exist, then appends it to
+// p_overlay, the overlay of p_working. Merged values p_working already built are brought up to
+// date with the new edit alone, so a batch of edits never rebuilds what an earlier one touched.
+bool PreBuiltIndexJSON::_add_edit(Snapshot &p_working, WriteOverlay &p_overlay, const String &p_key_path, const Variant &p_value, bool p_erase, bool p_insert) {
+	const Snapshot *snapshot = &p_working;
+	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+	WriteOverlay::Edit edit;
+	edit.parts = _parse_escaped_path(p_key_path);
+	edit.scope = edit.parts.size();
+	edit.erase = p_erase;
+	String error;
+	PreBuiltIndexJSONOutput::ErrorType error_type = PreBuiltIndexJSONOutput::ERR_INVALID_PATH;
+	if (!snapshot->dataset->is_loaded()) {
+		error_type = PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN;
+		error = "No data is loaded.";
+	} else if (!p_erase && !WriteOverlay::is_json_value(p_value)) {
+		error_type = PreBuiltIndexJSONOutput::ERR_UNSUPPORTED_TYPE;
+		error = "Only JSON values can be stored (null, bool, numbers, String, packed arrays, Array and Dictionary with String keys).";
+	} else if (edit.parts.is_empty()) {
+		if (p_erase || (p_value.get_type() != Variant::DICTIONARY && p_value.get_type() != Variant::ARRAY)) {
+			error = "The root can only be replaced by a Dictionary or an Array.";
+		}
+	} else {
+		edit.parts = _canonical_parts(*snapshot, edit.parts);
+		String parent_path = _join_path(edit.parts.slice(0, edit.parts.size() - 1));
+		String part = edit.parts[edit.parts.size() - 1];
+		// Only the parent's kind and, for arrays, its size are needed; an untouched container
+		// is not rebuilt to learn them.
+		Variant parent;
+		bool parent_found = false;
+		bool is_array = false;
+		bool is_container = false;
+		int64_t size = 0;
+		bool has_child = false;
+		if (_read_overlay(*snapshot, parent_path, parent, parent_found)) {
+			is_container = parent_found && WriteOverlay::is_container(parent);
+			is_array = WriteOverlay::is_array(parent);
+			size = is_container ? _get_child_keys(parent).size() : 0;
+			Variant child;
+			has_child = is_container && WriteOverlay::get_child(parent, part, child);
+		} else {
+			PathLocation location;
+			if (_locate_path(*snapshot, parent_path, location, false)) {
+				if (location.jump >= 0) {
+					is_container = true;
+					is_array = location.jump > 0 && _line_has_index_key(snapshot->dataset->lines[location.children_begin()]);
+					size = is_array ? _count_children(*snapshot, location) : 0;
+				} else if (location.element < 0 && _read_base_value(*snapshot, parent_path, parent)) {
+					is_container = WriteOverlay::is_container(parent);
+					is_array = WriteOverlay::is_array(parent);
+					size = is_container ? _get_child_keys(parent).size() : 0;
+				}
+			}
+			PathLocation child_location;
+			has_child = is_container && _locate_path(*snapshot, _join_path(edit.parts), child_location, false);
+		}
+		if (!is_container) {
+			error = "Cannot edit '" + p_key_path + "': its parent does not exist or is not a container.";
+		} else if (is_array) {
+			int64_t index = part.is_valid_int() ? part.to_int() : -1;
+			if (index < 0 || index > size || (index == size && p_erase)) {
+				error = "Array index '" + part + "' is out of range for '" + p_key_path + "'. Elements can be replaced, erased or appended at index " + String::num_int64(size) + ".";
+			} else {
+				edit.parts.set(edit.parts.size() - 1, String::num_int64(index));
+				edit.insert = p_insert && !p_erase && index < size;
+				// Appending, inserting or erasing renumbers the elements, so the edit changes the array as a whole.
+				if (p_erase || edit.insert || index == size) edit.scope--;
+			}
+		} else if (p_erase && !has_child) {
+			error = "Path '" + p_key_path + "' not found.";
+		}
+	}
+	if (!error.is_empty()) {
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(error_type, error)));
+		return false;
+	}
+	if (!p_erase) edit.value = p_value.duplicate(true);
+	p_overlay.edits.push_back(edit);
+	int edit_index = (int)p_overlay.edits.size() - 1;
+	std::lock_guard<std::mutex> lock(p_working.merged_mutex);
+	for (std::pair<const String, Snapshot::MergedValue> &merged : p_working.merged_values) {
+		p_overlay.apply(merged.second.root, edit_index, merged.second.value, merged.second.found);
+	}
+	return true;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::open_file(const String &p_path,const bool &ignore_hash) {
+	std::shared_ptr<const Dataset> dataset;
+	_read_dataset(p_path, ignore_hash, dataset);
+	if (dataset) {
+		_mutex->lock();
+		_commit_dataset(dataset, p_path, false);
+		_mutex->unlock();
+	}
+	return _last_error;
+}
+
+// Loads a .pbijson file, or takes the dataset another instance already loaded from it.
+// Only the header line is read to find a shared dataset; it is reused when its verified
+// content hash matches the one in the header. Datasets loaded with ignore_hash are never shared.
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_read_dataset(const String &p_path, bool p_ignore_hash, std::shared_ptr<const Dataset> &r_dataset, bool p_async) {
+	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::ModeFlags::READ);
+	if (file.is_null()) {
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(FileAccess::get_open_error())));
+		return _last_error;
+	}
+	int64_t length = file->get_length();
+	String registry_key;
+	Dictionary header = _parse_header(file->get_line());
+	if (header.has("HASH")) {
+		registry_key = p_path.simplify_path() + "|" + String(header.get("HASH_ALGO", "MD5")) + ":" + String(header["HASH"]).strip_edges();
+		std::shared_ptr<const Dataset> shared = DatasetRegistry::find(registry_key);
+		if (shared) {
+			_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+			if (p_async && !_async_step("read", length, length)) {
+				_last_error = _cancelled_output();
+				return _last_error;
+			}
+			r_dataset = shared;
+			return _last_error;
+		}
+	}
+	if (p_async && !_async_step("read", 0, length)) {
+		_last_error = _cancelled_output();
+		return _last_error;
+	}
+	file->seek(0);
+	PackedStringArray data = file->get_as_text().split("\n", false);
+	file.unref();
+	if (p_async && !_async_step("read", length, length)) {
+		_last_error = _cancelled_output();
+		return _last_error;
+	}
+	std::shared_ptr<Dataset> dataset;
+	_load_dataset(data, p_ignore_hash, dataset, p_async);
+	if (dataset) {
+		if (!registry_key.is_empty() && !dataset->content_hash.is_empty()) {
+			DatasetRegistry::add(registry_key, dataset);
+		}
+		r_dataset = dataset;
+	}
+	return _last_error;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::open_from_string(const String &p_data,const bool &ignore_hash) {
+	return _open_data(p_data.split("\n", false),ignore_hash);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::open_from_array(const PackedStringArray &p_data,const bool &ignore_hash) {
+	return _open_data(p_data,ignore_hash);
+}
+
+std::mutex PreBuiltIndexJSON::DatasetRegistry::_mutex;
+std::map<String, std::weak_ptr<const PreBuiltIndexJSON::Dataset>> PreBuiltIndexJSON::DatasetRegistry::_datasets;
+
+std::shared_ptr<const PreBuiltIndexJSON::Dataset> PreBuiltIndexJSON::DatasetRegistry::find(const String &p_key) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _datasets.find(p_key);
+	return it == _datasets.end() ? nullptr : it->second.lock();
+}
+
+void PreBuiltIndexJSON::DatasetRegistry::add(const String &p_key, const std::shared_ptr<const Dataset> &p_dataset) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	// Entries only hold weak references; drop the ones whose dataset no instance uses anymore.
+	for (auto it = _datasets.begin(); it != _datasets.end();) {
+		if (it->second.expired()) {
+			it = _datasets.erase(it);
+		} else {
+			++it;
+		}
+	}
+	_datasets[p_key] = p_dataset;
+}
+
+int PreBuiltIndexJSON::DatasetRegistry::size() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	int count = 0;
+	for (const auto &entry : _datasets) {
+		if (!entry.second.expired()) count++;
+	}
+	return count;
+}
+
+std::shared_ptr<const PreBuiltIndexJSON::Snapshot> PreBuiltIndexJSON::_get_snapshot() const {
+	return std::atomic_load(&_snapshot);
+}
+
+// Called with the mutex held. Readers that already pinned the previous snapshot finish on it;
+// it is freed when the last of them returns. Cached results are only carried over when
+// both datasets were verified against the same content hash, since line numbers and values
+// in the caches are otherwise meaningless for the new data.
+void PreBuiltIndexJSON::_publish(const std::shared_ptr<const Dataset> &p_dataset, const String &p_file, bool p_keep_valid_caches) {
+	std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+	snapshot->file = p_file;
+	snapshot->dataset = p_dataset;
+	std::shared_ptr<const Snapshot> previous = _get_snapshot();
+	if (previous) {
+		const String &previous_hash = previous->dataset->content_hash;
+		bool keep_entries = p_keep_valid_caches && !previous_hash.is_empty() && previous_hash == p_dataset->content_hash;
+		snapshot->caches->copy_settings(*previous->caches, keep_entries);
+	}
+	std::atomic_store(&_snapshot, std::shared_ptr<const Snapshot>(snapshot));
+	_generation++;
+}
+
+// Called with the mutex held. The dataset stays, and so does the cache manager itself: cached
+// results only ever describe the loaded lines, since paths with pending changes neither read
+// nor fill the caches.
+void PreBuiltIndexJSON::_publish_overlay(const std::shared_ptr<const WriteOverlay> &p_overlay) {
+	std::shared_ptr<const Snapshot> previous = _get_snapshot();
+	std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+	snapshot->file = previous->file;
+	snapshot->dataset = previous->dataset;
+	snapshot->overlay = p_overlay && !p_overlay->is_empty() ? p_overlay : nullptr;
+	snapshot->caches = previous->caches;
+	std::atomic_store(&_snapshot, std::shared_ptr<const Snapshot>(snapshot));
+}
+
+// Called with the mutex held.
+void PreBuiltIndexJSON::_commit_dataset(const std::shared_ptr<const Dataset> &p_dataset, const String &p_file, bool p_keep_valid_caches) {
+	_publish(p_dataset, p_file, p_keep_valid_caches);
+	_prefetch_queue.clear();
+	_prefetch_next = 0;
+	if (!_warmup_paths.is_empty()) {
+		_queue_prefetch(_warmup_paths);
+	}
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_open_data(const PackedStringArray &p_data,const bool &ignore_hash, const String &p_file) {
+	std::shared_ptr<Dataset> dataset;
+	_load_dataset(p_data, ignore_hash, dataset);
+	if (dataset) {
+		_mutex->lock();
+		_commit_dataset(dataset, p_file, false);
+		_mutex->unlock();
+	}
+	return _last_error;
+}
+
+// Parses and verifies p_data into a new dataset without touching the loaded one, so it needs
+// no lock and can run on any thread. On failure r_dataset is left empty and the error is returned.
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_load_dataset(const PackedStringArray &p_data, bool p_ignore_hash, std::shared_ptr<Dataset> &r_dataset, bool p_async) {
+	PBIJSON_STATS_SCOPE(LOAD);
+	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+	if (p_data.size() <1) {
+		return _last_error;
+	}
+	
+	Dictionary header = _parse_header(p_data.get(0));
 	if (header.size() <1 && _last_error->get_error_type() != PreBuiltIndexJSONOutput::OK) {
 		return _last_error;
 	}
 
-	if (header.get("FV","") != get_pbijson_format()) {
+	String format = header.get("FV", "");
+	if (format != get_pbijson_format() && format != PBIJSON_FORMAT_1) {
 		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_FORMAT,"File format version does not match")));
 		return _last_error;
 	}
 	PackedStringArray context_data = p_data;
 	_remove_trailing_empty_line(context_data);
 	context_data.remove_at(0);
-	if (!ignore_hash) {
+	String hash = "";
+	if (!p_ignore_hash) {
+		PBIJSON_STATS_SCOPE(HASH_VERIFICATION);
 		String text = String("\n").join(context_data);
+		if (p_async && !_async_step("hash", 0, text.length())) {
+			_last_error = _cancelled_output();
+			return _last_error;
+		}
 		String hash_algo =  header.get("HASH_ALGO","MD5");
-		String hash = "";
 		if (hash_algo == "MD5") {
 			hash = text.md5_text();
 		} else if (hash_algo == "SHA-256") {
@@ -641,87 +2048,626 @@ Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_open_data(const PackedStringArr
 			_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_HASH,String("hash verification error: {0}/{1}").format(format_data) )));
 			return _last_error;
 		}
+		if (p_async && !_async_step("hash", text.length(), text.length())) {
+			_last_error = _cancelled_output();
+			return _last_error;
+		}
 
 	}
+
+	std::shared_ptr<Dataset> dataset = std::make_shared<Dataset>();
+	int body_lines = String(header.get("BL", "-1")).to_int();
+	if (body_lines >= 0 && body_lines <= context_data.size()) {
+		dataset->section_data = context_data.slice(body_lines);
+		context_data.resize(body_lines);
+		if (_parse_sections(*dataset)->get_error_type() != PreBuiltIndexJSONOutput::OK) {
+			return _last_error;
+		}
+	}
 	
-	_current_open_data = context_data;
+	dataset->lines = context_data;
+	_build_line_scan(*dataset);
+	if (!hash.is_empty()) {
+		dataset->content_hash = String(header.get("HASH_ALGO","MD5")) + ":" + hash.strip_edges();
+	}
+	r_dataset = dataset;
+	return _last_error;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_parse_sections(Dataset &r_dataset) {
+	// Only sections that are read line by line at query time are kept in section_data;
+	// the others are decoded into their own structures here.
+	PackedStringArray kept_lines;
+	for (int i = 0; i < r_dataset.section_data.size(); ) {
+		const String &line = r_dataset.section_data[i];
+		PackedStringArray fields = line.substr(1).split(">", true, 2);
+		if (!line.begins_with(String::chr(SECTION_MARKER)) || fields.size() < 2 || !fields[1].is_valid_int()) {
+			_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_FORMAT, "Malformed section header: " + line)));
+			return _last_error;
+		}
+		int count = fields[1].to_int();
+		if (count < 0 || i + 1 + count > r_dataset.section_data.size()) {
+			_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_FORMAT, "Section exceeds the end of the file: " + line)));
+			return _last_error;
+		}
+		String params = fields.size() > 2 ? fields[2] : String();
+		// Unknown sections are skipped so newer files stay readable.
+		if (fields[0] == "IDX") {
+			r_dataset.field_indexes[params] = Vector2i(kept_lines.size() + 1, count);
+			kept_lines.append_array(r_dataset.section_data.slice(i, i + 1 + count));
+		} else if (fields[0] == "BLM" && params == "FNV1A64") {
+			if (!r_dataset.bloom_filters.load(r_dataset.section_data, i + 1, count)) {
+				_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_FORMAT, "Malformed bloom filter section.")));
+				return _last_error;
+			}
+		} else if (fields[0] == "PHX" && params == "FNV1A64") {
+			if (!r_dataset.path_hash_index.load(r_dataset.section_data, i + 1, count)) {
+				_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_FORMAT, "Malformed path hash section.")));
+				return _last_error;
+			}
+		}
+		i += 1 + count;
+	}
+	r_dataset.section_data = kept_lines;
 	return _last_error;
 }
 
 Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::reload_file(const bool &ignore_hash) {
-	if (get_opened_file().is_empty()) {
+	String file = get_opened_file();
+	if (file.is_empty()) {
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_FILE_NOT_OPEN)));
+		return _last_error;
+	}
+	return open_file(file,ignore_hash);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::hot_reload(bool p_ignore_hash, bool p_keep_valid_caches) {
+	String file = get_opened_file();
+	if (file.is_empty()) {
 		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_FILE_NOT_OPEN)));
 		return _last_error;
 	}
-	return open_file(_current_open_file,ignore_hash);
+	_mutex->lock();
+	if (_reload_running) {
+		_mutex->unlock();
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(ERR_BUSY, "Another hot reload is already running.")));
+		return _last_error;
+	}
+	if (_reload_task_id != -1) {
+		// The previous task has already finished its work; reap it.
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(_reload_task_id);
+	}
+	_reload_path = file;
+	_reload_ignore_hash = p_ignore_hash;
+	_reload_keep_caches = p_keep_valid_caches;
+	_reload_generation = _generation;
+	_reload_result.unref();
+	_reload_running = true;
+	_reload_task_id = WorkerThreadPool::get_singleton()->add_task(callable_mp(this, &PreBuiltIndexJSON::_reload_task), false, "PreBuiltIndexJSON hot reload");
+	_mutex->unlock();
+	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+	return _last_error;
+}
+
+bool PreBuiltIndexJSON::is_reloading() const {
+	_mutex->lock();
+	bool running = _reload_running;
+	_mutex->unlock();
+	return running;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::wait_for_reload() {
+	_mutex->lock();
+	int64_t task_id = _reload_task_id;
+	_reload_task_id = -1;
+	_mutex->unlock();
+	if (task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(task_id);
+	}
+	_mutex->lock();
+	Ref<PreBuiltIndexJSONOutput> result = _reload_result;
+	_mutex->unlock();
+	return result;
+}
+
+// Reads and verifies the file without the mutex, so foreground queries keep running on the
+// current snapshot, and only takes it to swap the new snapshot in.
+void PreBuiltIndexJSON::_reload_task() {
+	_mutex->lock();
+	String path = _reload_path;
+	bool ignore_hash = _reload_ignore_hash;
+	bool keep_caches = _reload_keep_caches;
+	uint64_t generation = _reload_generation;
+	_mutex->unlock();
+
+	std::shared_ptr<const Dataset> dataset;
+	Ref<PreBuiltIndexJSONOutput> result = _read_dataset(path, ignore_hash, dataset);
+
+	_mutex->lock();
+	if (dataset) {
+		if (_generation != generation) {
+			// Something else was loaded meanwhile; publishing the old file would undo it.
+			result = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(ERR_BUSY, "The reloaded data was discarded because newer data was loaded while the reload ran.")));
+		} else {
+			_commit_dataset(dataset, path, keep_caches);
+		}
+	}
+	_reload_result = result;
+	_reload_running = false;
+	_mutex->unlock();
+	call_deferred("emit_signal", "hot_reload_completed", result);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::build_from_file_async(const String &p_json_file, const Dictionary &p_options) {
+	return _start_async(ASYNC_BUILD, p_json_file, String(), p_options, false);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::build_from_file_to_async(const String &p_json_file, const String &p_target_path, const Dictionary &p_options) {
+	return _start_async(ASYNC_BUILD_TO, p_json_file, p_target_path, p_options, false);
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::open_file_async(const String &p_path, bool p_ignore_hash) {
+	return _start_async(ASYNC_OPEN, p_path, String(), Dictionary(), p_ignore_hash);
+}
+
+void PreBuiltIndexJSON::cancel_async() {
+	_async_cancelled = true;
+}
+
+bool PreBuiltIndexJSON::is_async_running() const {
+	_mutex->lock();
+	bool running = _async_running;
+	_mutex->unlock();
+	return running;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::wait_for_async() {
+	_mutex->lock();
+	int64_t task_id = _async_task_id;
+	_async_task_id = -1;
+	_mutex->unlock();
+	if (task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(task_id);
+	}
+	_mutex->lock();
+	Ref<PreBuiltIndexJSONOutput> result = _async_result;
+	_mutex->unlock();
+	return result;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_start_async(AsyncOperation p_operation, const String &p_source, const String &p_target, const Dictionary &p_options, bool p_ignore_hash) {
+	_mutex->lock();
+	if (_async_running) {
+		_mutex->unlock();
+		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(ERR_BUSY, "Another asynchronous operation is already running.")));
+		return _last_error;
+	}
+	if (_async_task_id != -1) {
+		// The previous task has already finished its work; reap it.
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(_async_task_id);
+	}
+	_async_operation = p_operation;
+	_async_source = p_source;
+	_async_target = p_target;
+	_async_options = p_options.duplicate(true);
+	_async_ignore_hash = p_ignore_hash;
+	_async_result.unref();
+	_async_cancelled = false;
+	_async_running = true;
+	_async_task_id = WorkerThreadPool::get_singleton()->add_task(callable_mp(this, &PreBuiltIndexJSON::_async_task), false, "PreBuiltIndexJSON async operation");
+	_mutex->unlock();
+	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::OK)));
+	return _last_error;
+}
+
+// Emits async_progress on the main thread. Returns false once the operation has been cancelled.
+bool PreBuiltIndexJSON::_async_step(const String &p_stage, int64_t p_current, int64_t p_total) {
+	if (_async_cancelled) return false;
+	call_deferred("emit_signal", "async_progress", p_stage, p_current, p_total);
+	return true;
+}
+
+Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::_cancelled_output() {
+	return Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_CANCELLED, "The operation was cancelled.")));
+}
+
+void PreBuiltIndexJSON::_async_task() {
+	_mutex->lock();
+	AsyncOperation operation = _async_operation;
+	String source = _async_source;
+	String target = _async_target;
+	Dictionary options = _async_options;
+	bool ignore_hash = _async_ignore_hash;
+	_mutex->unlock();
+
+	Ref<PreBuiltIndexJSONOutput> output;
+	if (operation == ASYNC_OPEN) {
+		std::shared_ptr<const Dataset> dataset;
+		output = _read_dataset(source, ignore_hash, dataset, true);
+		if (dataset) {
+			_mutex->lock();
+			if (_async_cancelled) {
+				output = _cancelled_output();
+			} else {
+				_commit_dataset(dataset, source, false);
+			}
+			_mutex->unlock();
+		}
+	} else {
+		String text;
+		Ref<FileAccess> file = FileAccess::open(source, FileAccess::ModeFlags::READ);
+		if (file.is_null()) {
+			output = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(FileAccess::get_open_error())));
+		} else {
+			int64_t length = file->get_length();
+			if (_async_step("read", 0, length)) {
+				text = file->get_as_text();
+			}
+			file.unref();
+			if (!_async_step("read", length, length)) {
+				output = _cancelled_output();
+			}
+		}
+		if (output.is_null()) {
+			output = _build(text, options, true);
+			if (operation == ASYNC_BUILD_TO && output->has_data()) {
+				output = _store_build(output, target);
+				if (output->has_data()) {
+					_async_step("write", output->get_data().length(), output->get_data().length());
+				}
+			}
+		}
+	}
+
+	_mutex->lock();
+	_async_result = output;
+	_async_running = false;
+	_mutex->unlock();
+	call_deferred("emit_signal", "async_completed", output);
+}
+
+void PreBuiltIndexJSON::clear() {
+	_mutex->lock();
+	_publish(std::make_shared<Dataset>(), String());
+	_prefetch_queue.clear();
+	_prefetch_next = 0;
+	_last_error.clear();
+	_mutex->unlock();
+}
+
+void PreBuiltIndexJSON::close() {
+	_mutex->lock();
+	_publish(std::make_shared<Dataset>(), String());
+	_prefetch_queue.clear();
+	_prefetch_next = 0;
+	_mutex->unlock();
+}
+
+void PreBuiltIndexJSON::clear_caches() {
+	_get_snapshot()->caches->clear_all();
+}
+
+void PreBuiltIndexJSON::clear_cache(CacheFlags p_flag) {
+	_get_snapshot()->caches->clear_by_flag(p_flag);
+}
+
+bool PreBuiltIndexJSON::remove_from_cache(CacheFlags p_flag, const String &p_key_path) {
+	return _get_snapshot()->caches->erase(p_flag, CacheKey(p_key_path));
+}
+
+void PreBuiltIndexJSON::set_cache_limit(int p_flags, int64_t p_max_entries, int64_t p_max_bytes) {
+	// Under the mutex so the limits cannot be lost to a snapshot being published concurrently.
+	_mutex->lock();
+	_get_snapshot()->caches->set_limits(p_flags, p_max_entries, p_max_bytes);
+	_mutex->unlock();
+}
+
+Dictionary PreBuiltIndexJSON::get_cache_stats(CacheFlags p_flag) const {
+	return _get_snapshot()->caches->get_stats(p_flag);
+}
+
+void PreBuiltIndexJSON::reset_cache_stats(int p_flags) {
+	_get_snapshot()->caches->reset_stats(p_flags);
+}
+
+int64_t PreBuiltIndexJSON::get_cache_memory_usage() const {
+	return _get_snapshot()->caches->get_total_bytes();
+}
+
+// Names of the cache categories in get_stats() and the monitors, by CacheFlags bit.
+static const char *const CACHE_NAMES[] = { "value", "has_path", "get_size", "get_sub_paths", "get_keys", "aggregate", "location" };
+
+Dictionary PreBuiltIndexJSON::get_stats() const {
+	Dictionary stats = _stats.to_dictionary();
+#ifdef PBIJSON_NO_STATS
+	stats["available"] = false;
+#else
+	stats["available"] = true;
+#endif
+	Dictionary caches;
+	for (int bit = 0; bit < (int)std::size(CACHE_NAMES); bit++) {
+		Dictionary cache = get_cache_stats(static_cast<CacheFlags>(1 << bit));
+		int64_t hits = cache["hits"];
+		int64_t lookups = hits + (int64_t)cache["misses"];
+		cache["hit_rate"] = lookups > 0 ? (double)hits / lookups : 0.0;
+		caches[CACHE_NAMES[bit]] = cache;
+	}
+	stats["caches"] = caches;
+	return stats;
+}
+
+double PreBuiltIndexJSON::get_stat(const String &p_name) const {
+	if (p_name.ends_with("/hit_rate")) {
+		String cache_name = p_name.trim_suffix("/hit_rate");
+		for (int bit = 0; bit < (int)std::size(CACHE_NAMES); bit++) {
+			if (cache_name == CACHE_NAMES[bit]) {
+				Dictionary cache = get_cache_stats(static_cast<CacheFlags>(1 << bit));
+				int64_t hits = cache["hits"];
+				int64_t lookups = hits + (int64_t)cache["misses"];
+				return lookups > 0 ? (double)hits / lookups : 0.0;
+			}
+		}
+		return 0.0;
+	}
+	return _stats.get(p_name);
+}
+
+void PreBuiltIndexJSON::reset_stats() {
+	_stats.reset();
+}
+
+void PreBuiltIndexJSON::set_stats_enabled(bool p_enabled) {
+#ifndef PBIJSON_NO_STATS
+	_stats.set_enabled(p_enabled);
+#endif
+}
+
+bool PreBuiltIndexJSON::is_stats_enabled() const {
+	return _stats.is_enabled();
+}
+
+// Registers "<category>/<name>" monitors reading get_stat(), which the editor debugger graphs
+// and Performance.get_custom_monitor() reports. Each id can exist once per process, so two
+// instances need different categories.
+Error PreBuiltIndexJSON::add_performance_monitors(const String &p_category) {
+	Performance *performance = Performance::get_singleton();
+	if (performance == nullptr) {
+		return ERR_UNAVAILABLE;
+	}
+	_mutex->lock();
+	if (!_monitor_ids.is_empty()) {
+		_mutex->unlock();
+		return ERR_ALREADY_IN_USE;
+	}
+	// Monitor name -> get_stat() name.
+	std::vector<std::pair<String, String>> monitors;
+	for (int i = 0; i < QueryStats::METHOD_MAX; i++) {
+		String method = QueryStats::get_method_name(static_cast<QueryStats::Method>(i));
+		monitors.emplace_back(method + " calls", method + "/calls");
+		monitors.emplace_back(method + " mean usec", method + "/mean_usec");
+	}
+	for (int i = 0; i < QueryStats::COUNTER_MAX; i++) {
+		String counter = QueryStats::get_counter_name(static_cast<QueryStats::Counter>(i));
+		monitors.emplace_back(counter.replace("_", " "), counter);
+	}
+	monitors.emplace_back("lines per lookup", "lines_per_lookup");
+	for (const char *cache : CACHE_NAMES) {
+		monitors.emplace_back(String(cache) + " cache hit rate", String(cache) + "/hit_rate");
+	}
+
+	for (const std::pair<String, String> &monitor : monitors) {
+		String id = p_category + "/" + monitor.first;
+		if (performance->has_custom_monitor(id)) {
+			for (int i = 0; i < _monitor_ids.size(); i++) {
+				performance->remove_custom_monitor(_monitor_ids[i]);
+			}
+			_monitor_ids.clear();
+			_mutex->unlock();
+			return ERR_ALREADY_EXISTS;
+		}
+		Array arguments;
+		arguments.push_back(monitor.second);
+		performance->add_custom_monitor(id, Callable(this, "get_stat"), arguments);
+		_monitor_ids.push_back(id);
+	}
+	_mutex->unlock();
+	return OK;
+}
+
+void PreBuiltIndexJSON::remove_performance_monitors() {
+	_mutex->lock();
+	Performance *performance = Performance::get_singleton();
+	for (int i = 0; performance != nullptr && i < _monitor_ids.size(); i++) {
+		if (performance->has_custom_monitor(_monitor_ids[i])) {
+			performance->remove_custom_monitor(_monitor_ids[i]);
+		}
+	}
+	_monitor_ids.clear();
+	_mutex->unlock();
+}
+
+// Starting replaces the ring, so a new trace never mixes with events of an earlier one.
+// Queries already inside a traced call finish writing into the ring they started with.
+Error PreBuiltIndexJSON::start_trace(const Dictionary &p_options) {
+#ifdef PBIJSON_NO_STATS
+	return ERR_UNAVAILABLE;
+#else
+	int capacity = p_options.get("capacity", 16384);
+	int sample_every = p_options.get("sample_every", 1);
+	if (capacity < 1 || sample_every < 1) {
+		return ERR_INVALID_PARAMETER;
+	}
+	_mutex->lock();
+	_trace.start(capacity, sample_every);
+	_mutex->unlock();
+	return OK;
+#endif
+}
+
+void PreBuiltIndexJSON::stop_trace() {
+	_trace.stop();
+}
+
+bool PreBuiltIndexJSON::is_tracing() const {
+	return _trace.is_tracing();
+}
+
+Array PreBuiltIndexJSON::get_trace_events() const {
+	Array events;
+	QueryTraceHolder::Pin pin(_trace);
+	QueryTrace *trace = pin.get();
+	if (!trace) {
+		return events;
+	}
+	for (const TraceEvent &event : trace->get_events()) {
+		events.push_back(QueryTrace::to_dictionary(event));
+	}
+	return events;
+}
+
+Error PreBuiltIndexJSON::dump_trace(const String &p_path) const {
+	QueryTraceHolder::Pin pin(_trace);
+	QueryTrace *trace = pin.get();
+	if (!trace) {
+		return ERR_UNCONFIGURED;
+	}
+	return QueryTrace::save(p_path, trace->get_events(), trace->get_sample_every(), trace->get_dropped());
+}
+
+Dictionary PreBuiltIndexJSON::get_trace_report(int p_top) const {
+	QueryTraceHolder::Pin pin(_trace);
+	QueryTrace *trace = pin.get();
+	if (!trace) {
+		return QueryTrace::summarize(std::vector<TraceEvent>(), p_top, 1, 0);
+	}
+	return QueryTrace::summarize(trace->get_events(), p_top, trace->get_sample_every(), trace->get_dropped());
+}
+
+Dictionary PreBuiltIndexJSON::load_trace_report(const String &p_path, int p_top) {
+	std::vector<TraceEvent> events;
+	int sample_every = 1;
+	uint64_t dropped = 0;
+	Error err = QueryTrace::load(p_path, events, sample_every, dropped);
+	if (err != OK) {
+		Dictionary report;
+		report["error"] = err;
+		return report;
+	}
+	return QueryTrace::summarize(events, p_top, sample_every, dropped);
+}
+
+void PreBuiltIndexJSON::prefetch(const PackedStringArray &p_paths) {
+	_mutex->lock();
+	_queue_prefetch(p_paths);
+	_mutex->unlock();
+}
+
+bool PreBuiltIndexJSON::is_prefetching() const {
+	_mutex->lock();
+	bool running = _prefetch_running;
+	_mutex->unlock();
+	return running;
 }
 
-void PreBuiltIndexJSON::clear() {
+void PreBuiltIndexJSON::wait_for_prefetch() {
 	_mutex->lock();
-	_current_open_data.clear();
-	_build_buffer.clear();
-	_current_open_file = "";
-	_last_error->clear();
-	clear_caches();
+	int64_t task_id = _prefetch_task_id;
+	_prefetch_task_id = -1;
 	_mutex->unlock();
+	if (task_id != -1) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(task_id);
+	}
 }
 
-void PreBuiltIndexJSON::close() {
+PackedStringArray PreBuiltIndexJSON::get_cached_paths(int p_flags) const {
+	return _get_snapshot()->caches->get_cached_paths(p_flags);
+}
+
+void PreBuiltIndexJSON::set_warmup_paths(const PackedStringArray &p_paths) {
 	_mutex->lock();
-	_current_open_data.clear();
-	_current_open_file = "";
+	_warmup_paths = p_paths;
 	_mutex->unlock();
 }
 
-void PreBuiltIndexJSON::clear_caches() {
-	_cache_manager->clear_all();
+PackedStringArray PreBuiltIndexJSON::get_warmup_paths() const {
+	_mutex->lock();
+	PackedStringArray paths = _warmup_paths;
+	_mutex->unlock();
+	return paths;
 }
 
-void PreBuiltIndexJSON::clear_cache(CacheFlags p_flag) {
-	_cache_manager->clear_by_flag(p_flag);
+// Called with the mutex held.
+void PreBuiltIndexJSON::_queue_prefetch(const PackedStringArray &p_paths) {
+	if (p_paths.is_empty() || _prefetch_cancelled) return;
+	_prefetch_queue.append_array(p_paths);
+	if (_prefetch_running) return;
+	if (_prefetch_task_id != -1) {
+		// The previous task has already released the queue and is returning; reap it.
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(_prefetch_task_id);
+	}
+	_prefetch_running = true;
+	_prefetch_task_id = WorkerThreadPool::get_singleton()->add_task(callable_mp(this, &PreBuiltIndexJSON::_prefetch_task), false, "PreBuiltIndexJSON prefetch");
 }
 
-bool PreBuiltIndexJSON::remove_from_cache(CacheFlags p_flag, const StringName &p_key_path) {
-	return _cache_manager->erase(p_flag, p_key_path);
+void PreBuiltIndexJSON::_prefetch_task() {
+	while (true) {
+		_mutex->lock();
+		if (_prefetch_cancelled || _prefetch_next >= _prefetch_queue.size()) {
+			_prefetch_queue.clear();
+			_prefetch_next = 0;
+			_prefetch_running = false;
+			_mutex->unlock();
+			return;
+		}
+		String path = _prefetch_queue[_prefetch_next++];
+		_mutex->unlock();
+		// Errors land in this worker thread's slot, never in a foreground caller's.
+		if (is_cache_enabled(VALUE_CACHE)) {
+			get_value(path);
+		} else {
+			std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+			if (snapshot->dataset->is_loaded()) {
+				PathLocation location;
+				_locate_path(*snapshot, path, location, false);
+			}
+		}
+	}
 }
 
 Ref<PreBuiltIndexJSONOutput> PreBuiltIndexJSON::get_last_error() const {
-    _mutex->lock();
-    Ref<PreBuiltIndexJSONOutput> err = _last_error;
-    _mutex->unlock();
-    return err;
+	return _last_error;
 }
 
 bool PreBuiltIndexJSON::is_data_loaded() const {
-	return !_current_open_data.is_empty();
+	return _get_snapshot()->dataset->is_loaded();
 }
 
 String PreBuiltIndexJSON::get_opened_file() const {
-	return _current_open_file;
+	return _get_snapshot()->file;
 }
 
 void PreBuiltIndexJSON::set_cache_flags(int p_flags) {
-	cache_flags = static_cast<CacheFlags>(p_flags);
+	cache_flags.store(p_flags, std::memory_order_relaxed);
 }
 
 int PreBuiltIndexJSON::get_cache_flags() const {
-	return static_cast<int>(cache_flags);
+	return cache_flags.load(std::memory_order_relaxed);
 }
 
 bool PreBuiltIndexJSON::is_cache_enabled(CacheFlags p_flag) const {
-	return (cache_flags & p_flag) != 0;
+	return (cache_flags.load(std::memory_order_relaxed) & p_flag) != 0;
 }
 
 void PreBuiltIndexJSON::set_cache_enabled(CacheFlags p_flag, bool p_enabled) {
 	if (p_enabled) {
-		cache_flags = static_cast<CacheFlags>(cache_flags | p_flag);
+		cache_flags.fetch_or(p_flag, std::memory_order_relaxed);
 	} else {
-		cache_flags = static_cast<CacheFlags>(cache_flags & ~p_flag);
+		cache_flags.fetch_and(~p_flag, std::memory_order_relaxed);
 	}
 }
 
-bool PreBuiltIndexJSON::has_in_cache(CacheFlags p_flag, const StringName &p_key_path) const {
-	return _cache_manager->has(p_flag, p_key_path);
+bool PreBuiltIndexJSON::has_in_cache(CacheFlags p_flag, const String &p_key_path) const {
+	return _get_snapshot()->caches->has(p_flag, CacheKey(p_key_path));
 }
 
 int PreBuiltIndexJSON::_get_line_depth(const String &p_line) const {
@@ -767,34 +2713,364 @@ PackedStringArray PreBuiltIndexJSON::_parse_escaped_path(const String &p_path) c
 	return parts;
 }
 
-Dictionary PreBuiltIndexJSON::_find_part_in_range(const String &p_part, int p_depth, int p_start_line, int p_end_line, bool p_is_parent_array, const String &p_full_path) const {
-	String key_part_to_find;
-	bool is_int = p_part.is_valid_int();
-	if (p_is_parent_array) {
-		if (!is_int) {
-			_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Invalid path: An array can only be indexed by an integer. Got '" + p_part + "'. Full path: " + p_full_path)));
-			return Dictionary();
+// Reads a part the way PathView::to_index does, so that "03" and "+3" name element 3.
+static bool _parse_index_part(const String &p_part, int64_t &r_index) {
+	int length = p_part.length();
+	if (length == 0) return false;
+	int pos = 0;
+	bool negative = false;
+	if (length > 1 && (p_part[0] == U'+' || p_part[0] == U'-')) {
+		negative = p_part[0] == U'-';
+		pos++;
+	}
+	int64_t value = 0;
+	for (; pos < length; pos++) {
+		char32_t c = p_part[pos];
+		if (c < U'0' || c > U'9' || value > (INT64_MAX - 9) / 10) return false;
+		value = value * 10 + (c - U'0');
+	}
+	r_index = negative ? -value : value;
+	return true;
+}
+
+// Spells every array index in p_parts the way the edits store it, so that pending changes
+// match however a path writes the index. Only a part that reads as an index but is spelled
+// otherwise costs a lookup of its parent's kind; dictionary keys such as "03" are kept.
+PackedStringArray PreBuiltIndexJSON::_canonical_parts(const Snapshot &p_snapshot, const PackedStringArray &p_parts) const {
+	PackedStringArray parts = p_parts;
+	for (int i = 0; i < parts.size(); i++) {
+		int64_t index = 0;
+		if (!_parse_index_part(parts[i], index)) continue;
+		String canonical = String::num_int64(index);
+		if (canonical == parts[i]) continue;
+		String parent_path = _join_path(parts.slice(0, i));
+		Variant parent;
+		bool found = false;
+		bool is_array = false;
+		if (_read_overlay(p_snapshot, parent_path, parent, found)) {
+			is_array = found && WriteOverlay::is_array(parent);
+		} else {
+			PathLocation location;
+			if (_locate_path(p_snapshot, parent_path, location, false)) {
+				if (location.jump > 0) {
+					is_array = _line_has_index_key(p_snapshot.dataset->lines[location.children_begin()]);
+				} else if (location.jump < 0 && location.element < 0 && _read_base_value(p_snapshot, parent_path, parent)) {
+					is_array = WriteOverlay::is_array(parent);
+				}
+			}
+		}
+		if (is_array) parts.set(i, canonical);
+	}
+	return parts;
+}
+
+// FNV-1a of an array index spelled the way the builder stores it (String::num_int64).
+static uint64_t _hash_index_key(int64_t p_index) {
+	char32_t digits[24];
+	int count = 0;
+	uint64_t magnitude = p_index < 0 ? 0 - (uint64_t)p_index : (uint64_t)p_index;
+	do {
+		digits[count++] = U'0' + (char32_t)(magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+	uint64_t hash = PathHashIndex::HASH_BEGIN;
+	if (p_index < 0) hash = PathHashIndex::hash_char(hash, U'-');
+	while (count > 0) {
+		hash = PathHashIndex::hash_char(hash, digits[--count]);
+	}
+	return PathHashIndex::hash_finish(PathHashIndex::hash_end_part(hash));
+}
+
+static int _hex_digit(char32_t p_char) {
+	if (p_char >= U'0' && p_char <= U'9') return p_char - U'0';
+	if (p_char >= U'a' && p_char <= U'f') return p_char - U'a' + 10;
+	if (p_char >= U'A' && p_char <= U'F') return p_char - U'A' + 10;
+	return -1;
+}
+
+// Reads the four hex digits of a unicode escape starting at p_pos.
+static bool _read_hex4(const char32_t *p_chars, int p_length, int p_pos, char32_t &r_value) {
+	if (p_pos + 4 > p_length) return false;
+	r_value = 0;
+	for (int i = 0; i < 4; ++i) {
+		int digit = _hex_digit(p_chars[p_pos + i]);
+		if (digit < 0) return false;
+		r_value = (r_value << 4) | (char32_t)digit;
+	}
+	return true;
+}
+
+// Reads the next code point of a quoted key at r_pos, decoding JSON escapes.
+// Returns 1 for a code point, 0 at the closing quote and -1 when the key is cut short.
+static int _read_key_char(const char32_t *p_chars, int p_length, int &r_pos, char32_t &r_char) {
+	if (r_pos >= p_length) return -1;
+	char32_t c = p_chars[r_pos++];
+	if (c == U'"') return 0;
+	if (c == U'\\') {
+		if (r_pos >= p_length) return -1;
+		char32_t escape = p_chars[r_pos++];
+		switch (escape) {
+			case U'b': c = U'\b'; break;
+			case U'f': c = U'\f'; break;
+			case U'n': c = U'\n'; break;
+			case U'r': c = U'\r'; break;
+			case U't': c = U'\t'; break;
+			case U'v': c = U'\v'; break;
+			case U'u': {
+				if (!_read_hex4(p_chars, p_length, r_pos, c)) return -1;
+				r_pos += 4;
+				char32_t low;
+				if (c >= 0xD800 && c <= 0xDBFF && r_pos + 1 < p_length && p_chars[r_pos] == U'\\' && p_chars[r_pos + 1] == U'u' && _read_hex4(p_chars, p_length, r_pos + 2, low) && low >= 0xDC00 && low <= 0xDFFF) {
+					c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+					r_pos += 6;
+				}
+			} break;
+			default: c = escape; break;
+		}
+	}
+	r_char = c;
+	return 1;
+}
+
+// Hash of a line's key, equal to the one _find_part_in_range() computes for the path part
+// that _line_key_matches() accepts for this line. Unreadable keys hash to 0.
+static uint64_t _hash_line_key(const String &p_line, int p_depth) {
+	const char32_t *chars = p_line.ptr();
+	int length = p_line.length();
+	int pos = p_depth;
+	if (pos >= length) return 0;
+	if (chars[pos] == U'[') {
+		int64_t index = 0;
+		int digits = 0;
+		for (pos++; pos < length && chars[pos] >= U'0' && chars[pos] <= U'9'; ++pos) {
+			index = index * 10 + (chars[pos] - U'0');
+			digits++;
+		}
+		return digits > 0 ? _hash_index_key(index) : 0;
+	}
+	if (chars[pos++] != U'"') return 0;
+	uint64_t hash = PathHashIndex::HASH_BEGIN;
+	char32_t c;
+	int read;
+	while ((read = _read_key_char(chars, length, pos, c)) > 0) {
+		hash = PathHashIndex::hash_char(hash, c);
+	}
+	return read < 0 ? 0 : PathHashIndex::hash_finish(PathHashIndex::hash_end_part(hash));
+}
+
+void PreBuiltIndexJSON::_build_line_scan(Dataset &r_dataset) const {
+	const PackedStringArray &lines = r_dataset.lines;
+	r_dataset.line_scan.clear();
+	r_dataset.line_scan.reserve(lines.size());
+	for (int i = 0; i < lines.size(); ++i) {
+		const String &line = lines[i];
+		int depth = _get_line_depth(line);
+		r_dataset.line_scan.append((uint32_t)depth, (uint32_t)_hash_line_key(line, depth));
+	}
+}
+
+bool PreBuiltIndexJSON::_line_has_index_key(const String &p_line) const {
+	int depth = _get_line_depth(p_line);
+	return depth < p_line.length() && p_line[depth] == U'[';
+}
+
+// Whether the line sits at exactly p_depth and its key is part p_part of p_path, compared
+// in place: the JSON escapes of the line and the path escapes are decoded as they are read.
+bool PreBuiltIndexJSON::_line_key_matches(const String &p_line, int p_depth, const PathView &p_path, int p_part, bool p_is_index, int64_t p_index) const {
+	const char32_t *chars = p_line.ptr();
+	int length = p_line.length();
+	if (length <= p_depth) return false;
+	for (int i = 0; i < p_depth; ++i) {
+		if (chars[i] != DEPTH_MARKER) return false;
+	}
+	int pos = p_depth;
+	if (p_is_index) {
+		if (chars[pos++] != U'[') return false;
+		int64_t index = 0;
+		int digits = 0;
+		while (pos < length && chars[pos] >= U'0' && chars[pos] <= U'9') {
+			index = index * 10 + (chars[pos++] - U'0');
+			digits++;
 		}
-		key_part_to_find = String("[{0}]").format(Array::make(p_part.to_int()));
+		if (digits == 0 || index != p_index || pos >= length || chars[pos++] != U']') return false;
 	} else {
-		key_part_to_find = JSON::stringify(p_part);
+		if (chars[pos++] != U'"') return false;
+		PathView::PartReader reader = p_path.read(p_part);
+		char32_t expected;
+		char32_t c;
+		while (true) {
+			int read = _read_key_char(chars, length, pos, c);
+			if (read < 0) return false;
+			if (read == 0) break;
+			if (!reader.next(expected) || expected != c) return false;
+		}
+		if (reader.next(expected)) return false;
+	}
+	return pos < length && (chars[pos] == JUMP_MARKER_OPEN || chars[pos] == VALUE_SEPARATOR);
+}
+
+// Returns the line of the child named by part p_part of p_path among the lines
+// [p_start_line, p_end_line) at p_depth, or -1.
+int PreBuiltIndexJSON::_find_part_in_range(const Snapshot &p_snapshot, const PathView &p_path, int p_part, int p_depth, int p_start_line, int p_end_line, bool p_is_parent_array, bool p_report_errors) const {
+	int64_t index = 0;
+	if (p_is_parent_array && !p_path.to_index(p_part, index)) {
+		if (p_report_errors) {
+			_set_error(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Invalid path: An array can only be indexed by an integer. Got '" + p_path.get_part(p_part) + "'. Full path: " + p_path.get_path());
+		}
+		return -1;
+	}
+	const Dataset &dataset = *p_snapshot.dataset;
+	uint64_t key_hash = p_is_parent_array ? _hash_index_key(index) : PathHashIndex::hash_finish(p_path.hash(PathHashIndex::HASH_BEGIN, p_part));
+	// The container owning this range is the line right before it (-1 for the root).
+	if (dataset.bloom_filters.size() > 0 && !dataset.bloom_filters.may_contain(p_start_line - 1, key_hash)) {
+		PBIJSON_STATS_ADD(BLOOM_REJECTIONS, 1);
+		return -1;
+	}
+	const PackedStringArray &lines = dataset.lines;
+	// Lines scanned counts the span searched up to the match, whichever way it was searched.
+	if (dataset.line_scan.size() == lines.size()) {
+		// Only lines at the right depth with the right key hash are compared in full.
+		for (int i = dataset.line_scan.find_key(p_start_line, p_end_line, p_depth, (uint32_t)key_hash); i < p_end_line; i = dataset.line_scan.find_key(i + 1, p_end_line, p_depth, (uint32_t)key_hash)) {
+			if (_line_key_matches(lines[i], p_depth, p_path, p_part, p_is_parent_array, index)) {
+				PBIJSON_COUNT_LINES_SCANNED(i - p_start_line + 1);
+				return i;
+			}
+		}
+		PBIJSON_COUNT_LINES_SCANNED(p_end_line - p_start_line);
+		return -1;
 	}
-	String search_pattern = String::chr(DEPTH_MARKER).repeat(p_depth) + key_part_to_find;
 	for (int i = p_start_line; i < p_end_line; ++i) {
-		const String &line = _current_open_data[i];
-		if (line.begins_with(search_pattern)) {
-			if (line.length() > search_pattern.length()) {
-				char32_t char_after_pattern = line[search_pattern.length()];
-				if (char_after_pattern == JUMP_MARKER_OPEN || char_after_pattern == VALUE_SEPARATOR) {
-					Dictionary result;
-					result["line_idx"] = i;
-					result["key_part"] = key_part_to_find;
-					return result;
-				}
+		if (_line_key_matches(lines[i], p_depth, p_path, p_part, p_is_parent_array, index)) {
+			PBIJSON_COUNT_LINES_SCANNED(i - p_start_line + 1);
+			return i;
+		}
+	}
+	PBIJSON_COUNT_LINES_SCANNED(p_end_line - p_start_line);
+	return -1;
+}
+
+int PreBuiltIndexJSON::_find_relative_line(const Snapshot &p_snapshot, const PathView &p_path, int p_depth, int p_start_line, int p_end_line) const {
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	int current_line_idx = p_start_line;
+	int search_range_end = p_end_line;
+	for (int i = 0; i < p_path.size(); ++i) {
+		if (current_line_idx >= search_range_end) return -1;
+		bool is_parent_array = _line_has_index_key(lines[current_line_idx]);
+		int line_idx = _find_part_in_range(p_snapshot, p_path, i, p_depth + i, current_line_idx, search_range_end, is_parent_array, false);
+		if (line_idx < 0) return -1;
+		if (i == p_path.size() - 1) return line_idx;
+		int jump_count = _get_line_jump(lines[line_idx]);
+		if (jump_count <= 0) return -1;
+		current_line_idx = line_idx + 1;
+		search_range_end = current_line_idx + jump_count;
+	}
+	return -1;
+}
+
+String PreBuiltIndexJSON::_escape_path_part(const String &p_part) {
+	return p_part.replace("\\", "\\\\").replace("/", "\\/");
+}
+
+int PreBuiltIndexJSON::_get_line_key_end(const String &p_line) const {
+	int content_start = _get_line_depth(p_line);
+	int length = p_line.length();
+	if (content_start >= length) return -1;
+	const char32_t *chars = p_line.ptr();
+	if (chars[content_start] == U'[') {
+		for (int i = content_start + 1; i < length; ++i) {
+			if (chars[i] == U']') return i + 1;
+		}
+	} else if (chars[content_start] == U'"') {
+		int i = ValueDecoder::find_quote_or_escape(chars, content_start + 1, length);
+		while (i < length) {
+			if (chars[i] == U'"') return i + 1;
+			i = ValueDecoder::find_quote_or_escape(chars, i + 2, length);
+		}
+	}
+	return -1;
+}
+
+int PreBuiltIndexJSON::_get_line_jump(const String &p_line) const {
+	int key_end = _get_line_key_end(p_line);
+	if (key_end < 0 || key_end >= p_line.length() || p_line[key_end] != JUMP_MARKER_OPEN) return -1;
+	int jump = 0;
+	for (int i = key_end + 1; i < p_line.length(); ++i) {
+		char32_t c = p_line[i];
+		if (c < U'0' || c > U'9') break;
+		jump = jump * 10 + (c - U'0');
+	}
+	return jump;
+}
+
+String PreBuiltIndexJSON::_get_line_raw_value(const String &p_line) const {
+	int key_end = _get_line_key_end(p_line);
+	if (key_end < 0 || key_end >= p_line.length() || p_line[key_end] != VALUE_SEPARATOR) return String();
+	return p_line.substr(key_end + 1).strip_edges();
+}
+
+String PreBuiltIndexJSON::_get_path_for_line(const Snapshot &p_snapshot, int p_line_idx) const {
+	// Walk down from the root, stepping over sibling subtrees with their jump markers.
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	String path;
+	int i = 0;
+	int end = lines.size();
+	while (i < end && p_line_idx < end) {
+		const String &line = lines[i];
+		int jump = _get_line_jump(line);
+		int subtree_end = i + 1 + (jump > 0 ? jump : 0);
+		if (p_line_idx >= subtree_end) {
+			i = subtree_end;
+			continue;
+		}
+		String part = _escape_path_part(String(_get_line_key(line)));
+		path = path.is_empty() ? part : path + "/" + part;
+		if (i == p_line_idx) return path;
+		i++;
+		end = subtree_end;
+	}
+	return String();
+}
+
+String PreBuiltIndexJSON::_index_value_key(const Variant &p_value) {
+	switch (p_value.get_type()) {
+		case Variant::NIL: return "null";
+		case Variant::BOOL: return bool(p_value) ? "true" : "false";
+		case Variant::INT: return String::num_int64(p_value);
+		case Variant::FLOAT: {
+			// JSON numbers are parsed as floats; normalize integral values so 50 and 50.0 share a key.
+			double value = p_value;
+			if (value > -9007199254740992.0 && value < 9007199254740992.0 && value == (double)(int64_t)value) {
+				return String::num_int64((int64_t)value);
 			}
+			return String::num(value);
 		}
+		case Variant::STRING:
+		case Variant::STRING_NAME: return JSON::stringify(String(p_value));
+		default: return String();
+	}
+}
+
+Variant PreBuiltIndexJSON::_get_line_key(const String &p_line) const {
+	int key_start = _get_line_depth(p_line);
+	int key_end = _get_line_key_end(p_line);
+	if (key_end > key_start && p_line[key_start] == U'[') {
+		return p_line.substr(key_start + 1, key_end - key_start - 2).to_int();
 	}
-	return Dictionary();
+	String key;
+	if (key_end > key_start && ValueDecoder::decode_string(p_line, key_start, key_end, key)) {
+		return key;
+	}
+	return QueryPredicate::decode_raw_string(_get_line_key_part(p_line));
+}
+
+Variant PreBuiltIndexJSON::_parse_line_key(const String &p_line) const {
+	int key_start = _get_line_depth(p_line);
+	int key_end = _get_line_key_end(p_line);
+	String key;
+	if (key_end > key_start && p_line[key_start] == U'"' && ValueDecoder::decode_string(p_line, key_start, key_end, key)) {
+		return key;
+	}
+	return JSON::parse_string(_get_line_key_part(p_line));
 }
 
 String PreBuiltIndexJSON::_get_line_key_part(const String &p_line) const {
@@ -821,11 +3097,16 @@ String PreBuiltIndexJSON::_get_line_key_part(const String &p_line) const {
 }
 
 Variant PreBuiltIndexJSON::_get_line_value(const String &p_line, int p_line_number) const {
-	int separator_pos = p_line.find(String::chr(VALUE_SEPARATOR));
-	if (separator_pos == -1) return Variant();
-	String value_str = p_line.substr(separator_pos + 1).strip_edges();
+	int key_end = _get_line_key_end(p_line);
+	if (key_end < 0 || key_end >= p_line.length() || p_line[key_end] != VALUE_SEPARATOR) return Variant();
+	Variant result;
+	if (ValueDecoder::decode_value(p_line, key_end + 1, p_line.length(), result)) {
+		return result;
+	}
+	PBIJSON_COUNT_ALLOCATION();
+	String value_str = p_line.substr(key_end + 1).strip_edges();
 	Ref<JSON> json = memnew(JSON);
-	Variant result = json->parse_string(value_str);
+	result = json->parse_string(value_str);
 	// What if the value is actually an empty value?
 	//if (result.get_type() == Variant::NIL) {
 	//	_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_VALUE_PARSE, "Value parsing error on line " + p_line + ". Raw value string: '" + value_str + "'")));
@@ -834,6 +3115,59 @@ Variant PreBuiltIndexJSON::_get_line_value(const String &p_line, int p_line_numb
 	return result;
 }
 
+// Builds the container whose children are the lines [p_begin, p_end), walking sibling subtrees
+// with their jump markers so that skipped children cost one line each. p_levels is the number of
+// container levels that may still be built (-1 for all); deeper containers become their path, or
+// are left out when p_stubs is false. p_keys filters this container's children and p_children
+// is applied to every child container.
+Variant PreBuiltIndexJSON::_materialize(const Snapshot &p_snapshot, int p_begin, int p_end, bool p_is_array, int p_levels, bool p_stubs, const Projection *p_keys, const Projection *p_children, const String &p_path) const {
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	Array array;
+	Dictionary dict;
+	int index = 0;
+	for (int i = p_begin; i < p_end; ) {
+		const String &line = lines[i];
+		int jump = _get_line_jump(line);
+		int next = i + 1 + (jump > 0 ? jump : 0);
+		Variant key = p_is_array ? Variant(index++) : _parse_line_key(line);
+		String part = p_is_array ? String::num_int64(index - 1) : String(key);
+		const Projection *child_keys = p_children;
+		if (p_keys) {
+			child_keys = p_keys->find(part);
+			// A field path that goes deeper than a value selects nothing.
+			if (!child_keys || (jump < 0 && !child_keys->all)) {
+				i = next;
+				continue;
+			}
+			if (child_keys->all) child_keys = nullptr;
+		}
+		Variant value;
+		if (jump < 0) {
+			value = _get_line_value(line, i);
+		} else {
+			String escaped = _escape_path_part(part);
+			String child_path = p_path.is_empty() ? escaped : p_path + "/" + escaped;
+			if (p_levels == 1) {
+				if (!p_stubs) {
+					i = next;
+					continue;
+				}
+				value = child_path;
+			} else {
+				bool is_array = jump > 0 && _line_has_index_key(lines[i + 1]);
+				value = _materialize(p_snapshot, i + 1, i + 1 + jump, is_array, p_levels < 0 ? -1 : p_levels - 1, p_stubs, child_keys, nullptr, child_path);
+			}
+		}
+		if (p_is_array) {
+			array.append(value);
+		} else {
+			dict[key] = value;
+		}
+		i = next;
+	}
+	return p_is_array ? Variant(array) : Variant(dict);
+}
+
 Variant PreBuiltIndexJSON::_rebuild_container_from_slice(const PackedStringArray &p_slice, int p_base_depth, bool p_is_array) const {
 	if (_last_error.is_valid() && _last_error->get_error_type() != PreBuiltIndexJSONOutput::OK) return Variant();
 	if (p_is_array) {
@@ -862,14 +3196,13 @@ Variant PreBuiltIndexJSON::_rebuild_container_from_slice(const PackedStringArray
 		return new_array;
 	} else {
 		Dictionary new_dict;
-        Ref<JSON> json = memnew(JSON);
 		for (int i = 0; i < p_slice.size(); ) {
 			const String &line = p_slice[i];
 			if (_get_line_depth(line) != p_base_depth) {
 				i++;
 				continue;
 			}
-			Variant key = json->parse_string(_get_line_key_part(line));
+			Variant key = _parse_line_key(line);
 			if (line.contains(String::chr(JUMP_MARKER_OPEN))) {
 				int jump = line.get_slice(String::chr(JUMP_MARKER_OPEN), 1).to_int();
 				if (i + 1 + jump > p_slice.size()) {
@@ -890,68 +3223,560 @@ Variant PreBuiltIndexJSON::_rebuild_container_from_slice(const PackedStringArray
 	}
 }
 
-Dictionary PreBuiltIndexJSON::_find_container_slice(const String &p_key_path) const {
+bool PreBuiltIndexJSON::_export_json(const String &p_key_path, const String &p_indent, JsonWriter &r_writer) const {
+	PBIJSON_STATS_SCOPE(GET_JSON);
+	PBIJSON_TRACE_SCOPE(GET_JSON, p_key_path);
+	std::shared_ptr<const Snapshot> snapshot = _get_snapshot();
+	_last_error.clear();
+	if (!snapshot->dataset->is_loaded()) {
+		_set_error(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN);
+		return false;
+	}
+	Variant merged;
+	bool found = false;
+	if (_read_overlay(*snapshot, p_key_path, merged, found)) {
+		if (!found) {
+			_set_path_error(p_key_path);
+			return false;
+		}
+		String text = JSON::stringify(merged, p_indent);
+		r_writer.write(text.ptr(), text.length());
+		return true;
+	}
+	PathLocation location;
+	if (!_locate_path(*snapshot, p_key_path, location, true)) {
+		return false;
+	}
+	return _write_json(*snapshot, location, p_indent, r_writer);
+}
 
-	_last_error->clear();
-	if (!is_data_loaded()) {
-		_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN)));
-		return Dictionary();
-	}
-	PackedStringArray path_parts = _parse_escaped_path(p_key_path);
-	if (path_parts.is_empty() || (path_parts.size() == 1 && path_parts[0].is_empty())) {
-		Dictionary result;
-		result["start_idx"] = 0;
-		result["end_idx"] = _current_open_data.size();
-		result["child_depth"] = 1;
-		return result;
+// Writes the value at p_location as JSON in one pass over its lines. Keys and scalar values are
+// already JSON text, so they are copied as they are; only the brackets, separators and
+// indentation are generated, laid out as JSON.stringify(value, p_indent) lays them out.
+bool PreBuiltIndexJSON::_write_json(const Snapshot &p_snapshot, const PathLocation &p_location, const String &p_indent, JsonWriter &r_writer) const {
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	const bool pretty = !p_indent.is_empty();
+	if (p_location.line_idx >= 0 && p_location.jump < 0) {
+		const String &line = lines[p_location.line_idx];
+		int begin = _get_line_key_end(line) + 1;
+		int end = line.length();
+		if (p_location.element >= 0) {
+			_find_packed_element(line, p_location.element, begin, end);
+			r_writer.write(line.ptr() + begin, end - begin);
+		} else {
+			_write_json_value(line, begin, end, 0, p_indent, r_writer);
+		}
+		return true;
 	}
-	int current_line_idx = 0;
-	int search_range_end = _current_open_data.size();
-	bool is_parent_array = _get_line_key_part(_current_open_data[0]).begins_with("[");
-	Dictionary find_result;
-	for (int i = 0; i < path_parts.size(); ++i) {
-		const String &part_to_find = path_parts[i];
-		int expected_depth = i + 1;
-		find_result = _find_part_in_range(part_to_find, expected_depth, current_line_idx, search_range_end, is_parent_array, p_key_path);
-		if (find_result.is_empty()) {
-			if (_last_error->get_error_type() == PreBuiltIndexJSONOutput::OK) {
-				_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Path part '" + part_to_find + "' not found.")));
+
+	struct OpenContainer {
+		int end = 0;
+		bool is_array = false;
+		int count = 0;
+	};
+	std::vector<OpenContainer> open;
+	auto open_container = [&](int p_begin, int p_end) {
+		OpenContainer container;
+		container.end = p_end;
+		container.is_array = p_begin < p_end && _line_has_index_key(lines[p_begin]);
+		r_writer.write(container.is_array ? U'[' : U'{');
+		open.push_back(container);
+	};
+	auto close_container = [&]() {
+		OpenContainer container = open.back();
+		open.pop_back();
+		if (pretty && container.count > 0) {
+			r_writer.write(U'\n');
+			r_writer.write_repeated(p_indent, (int)open.size());
+		}
+		r_writer.write(container.is_array ? U']' : U'}');
+	};
+
+	int begin = p_location.children_begin();
+	int end = p_location.children_end();
+	open_container(begin, end);
+	for (int i = begin; i < end; ++i) {
+		while (i >= open.back().end) {
+			close_container();
+		}
+		const String &line = lines[i];
+		const char32_t *chars = line.ptr();
+		int depth = _get_line_depth(line);
+		int key_end = _get_line_key_end(line);
+		if (key_end < 0 || key_end >= line.length()) {
+			_set_error(PreBuiltIndexJSONOutput::ERR_VALUE_PARSE, "Malformed line " + String::num_int64(i) + ": " + line);
+			return false;
+		}
+		OpenContainer &parent = open.back();
+		if (parent.count++ > 0) {
+			r_writer.write(U',');
+		}
+		if (pretty) {
+			r_writer.write(U'\n');
+			r_writer.write_repeated(p_indent, (int)open.size());
+		}
+		if (!parent.is_array) {
+			r_writer.write(chars + depth, key_end - depth);
+			r_writer.write(U':');
+			if (pretty) r_writer.write(U' ');
+		}
+		if (chars[key_end] == JUMP_MARKER_OPEN) {
+			int jump = _get_line_jump(line);
+			if (i + 1 + jump > parent.end) {
+				_set_error(PreBuiltIndexJSONOutput::ERR_LINE_IN_JUMP_MARKER, "Corrupted jump mark on line " + String::num_int64(i) + ".");
+				return false;
 			}
-			return Dictionary();
+			open_container(i + 1, i + 1 + jump);
+		} else {
+			_write_json_value(line, key_end + 1, line.length(), (int)open.size(), p_indent, r_writer);
 		}
-		current_line_idx = find_result["line_idx"];
-		const String &line_content = _current_open_data[current_line_idx];
-		if (i < path_parts.size() - 1 && !line_content.contains(String::chr(JUMP_MARKER_OPEN))) {
-			_last_error = Ref<PreBuiltIndexJSONOutput>(memnew(PreBuiltIndexJSONOutput(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Path expects a container, but found a value at part '" + part_to_find + "'.")));
-			return Dictionary();
+	}
+	while (!open.empty()) {
+		close_container();
+	}
+	return true;
+}
+
+// Packed arrays are the only values that are not already the JSON text of themselves: the type
+// prefix is dropped, and with an indent the elements are laid out one per line.
+void PreBuiltIndexJSON::_write_json_value(const String &p_line, int p_begin, int p_end, int p_level, const String &p_indent, JsonWriter &r_writer) const {
+	const char32_t *chars = p_line.ptr();
+	ValueDecoder::PackedReader reader;
+	if (!reader.begin(p_line, p_begin, p_end)) {
+		r_writer.write(chars + p_begin, p_end - p_begin);
+		return;
+	}
+	int element_begin = 0;
+	int element_end = 0;
+	if (p_indent.is_empty() || !reader.next(element_begin, element_end)) {
+		int array_begin = p_begin;
+		while (chars[array_begin] != U'[') {
+			array_begin++;
+		}
+		int array_end = p_end;
+		while (chars[array_end - 1] != U']') {
+			array_end--;
+		}
+		r_writer.write(chars + array_begin, array_end - array_begin);
+		return;
+	}
+	r_writer.write(U'[');
+	bool first = true;
+	do {
+		if (!first) r_writer.write(U',');
+		first = false;
+		r_writer.write(U'\n');
+		r_writer.write_repeated(p_indent, p_level + 1);
+		r_writer.write(chars + element_begin, element_end - element_begin);
+	} while (reader.next(element_begin, element_end));
+	r_writer.write(U'\n');
+	r_writer.write_repeated(p_indent, p_level);
+	r_writer.write(U']');
+}
+
+// The value at p_key_path as the loaded lines hold it, ignoring pending changes.
+bool PreBuiltIndexJSON::_read_base_value(const Snapshot &p_snapshot, const String &p_key_path, Variant &r_value) const {
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	PathLocation location;
+	if (!_locate_path(p_snapshot, p_key_path, location, false)) {
+		return false;
+	}
+	if (location.line_idx < 0) {
+		int end = location.children_end();
+		r_value = _materialize(p_snapshot, 0, end, end > 0 && _line_has_index_key(lines[0]), -1, true, nullptr, nullptr, String());
+	} else if (location.element >= 0) {
+		r_value = _get_element_value(lines[location.line_idx], location.element);
+	} else {
+		r_value = _read_line_entry(p_snapshot, location.line_idx);
+	}
+	return true;
+}
+
+// The whole value of the entry on line p_line_idx, rebuilt from the lines below it if it is a container.
+Variant PreBuiltIndexJSON::_read_line_entry(const Snapshot &p_snapshot, int p_line_idx) const {
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	int jump = _get_line_jump(lines[p_line_idx]);
+	if (jump < 0) {
+		return _get_line_value(lines[p_line_idx], p_line_idx);
+	}
+	int begin = p_line_idx + 1;
+	return _materialize(p_snapshot, begin, begin + jump, jump > 0 && _line_has_index_key(lines[begin]), -1, true, nullptr, nullptr, String());
+}
+
+// Returns false when no pending change touches p_key_path, which is then answered from the
+// lines as usual. Otherwise r_value is the merged value: the edits are replayed over the value
+// of the outermost path one of them replaces, rebuilt from the lines unless an edit replaced it.
+bool PreBuiltIndexJSON::_read_overlay(const Snapshot &p_snapshot, const String &p_key_path, Variant &r_value, bool &r_found) const {
+	if (!p_snapshot.overlay) return false;
+	PBIJSON_COUNT_ALLOCATION(); // Paths under pending edits are split into parts and joined again.
+	const WriteOverlay &overlay = *p_snapshot.overlay;
+	PackedStringArray parts = _canonical_parts(p_snapshot, _parse_escaped_path(p_key_path));
+	if (!overlay.touches(parts)) return false;
+	int root_length = overlay.get_root_length(parts);
+	if (root_length < 0) root_length = parts.size();
+	PackedStringArray root = parts.slice(0, root_length);
+	String root_path = _join_path(root);
+	{
+		std::lock_guard<std::mutex> lock(p_snapshot.merged_mutex);
+		auto it = p_snapshot.merged_values.find(root_path);
+		if (it != p_snapshot.merged_values.end()) {
+			r_value = it->second.value;
+			r_found = it->second.found;
+			if (r_found) r_found = WriteOverlay::navigate(r_value, parts, root_length);
+			return true;
 		}
-		if (line_content.contains(String::chr(JUMP_MARKER_OPEN))) {
-			int marker_pos = line_content.find(String::chr(JUMP_MARKER_OPEN));
-			int jump_count = line_content.substr(marker_pos + 1).to_int();
-			if (jump_count > 0 && current_line_idx + 1 < _current_open_data.size()) {
-				is_parent_array = _get_line_key_part(_current_open_data[current_line_idx + 1]).begins_with("[");
+	}
+	int replaced = overlay.find_last_replacement(root);
+	if (replaced < 0) {
+		r_found = _read_base_value(p_snapshot, root_path, r_value);
+	}
+	overlay.apply(root, replaced < 0 ? 0 : replaced, r_value, r_found);
+	{
+		std::lock_guard<std::mutex> lock(p_snapshot.merged_mutex);
+		Snapshot::MergedValue &merged = p_snapshot.merged_values[root_path];
+		merged.root = root;
+		merged.value = r_value;
+		merged.found = r_found;
+	}
+	if (r_found) {
+		r_found = WriteOverlay::navigate(r_value, parts, root_length);
+	}
+	return true;
+}
+
+Variant PreBuiltIndexJSON::_get_element_value(const String &p_line, int p_element) const {
+	int begin = 0;
+	int end = 0;
+	Variant value;
+	_find_packed_element(p_line, p_element, begin, end);
+	if (ValueDecoder::get_packed_type(p_line, _get_line_key_end(p_line) + 1, p_line.length()) == ValueDecoder::PACKED_INT) {
+		int64_t number = 0;
+		ValueDecoder::decode_int(p_line, begin, end, number);
+		value = number;
+	} else {
+		ValueDecoder::decode_value(p_line, begin, end, value);
+	}
+	return value;
+}
+
+int PreBuiltIndexJSON::_count_children(const Snapshot &p_snapshot, const PathLocation &p_location) const {
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	int start_idx = p_location.children_begin();
+	int end_idx = p_location.children_end();
+	int child_depth = p_location.depth + 1;
+	const LineScanIndex &line_scan = p_snapshot.dataset->line_scan;
+	if (line_scan.size() == lines.size()) {
+		return line_scan.count_depth(start_idx, end_idx, child_depth);
+	}
+	int count = 0;
+	for (int i = start_idx; i < end_idx; ++i) {
+		if (_get_line_depth(lines[i]) == child_depth) {
+			count++;
+		}
+	}
+	return count;
+}
+
+// _materialize() for a value that pending changes have already built. Empty containers and
+// packed arrays are values, as they are on the lines.
+Variant PreBuiltIndexJSON::_shape_value(const Variant &p_value, int p_levels, bool p_stubs, const Projection *p_keys, const Projection *p_children, const String &p_path) const {
+	if (p_value.get_type() != Variant::DICTIONARY && p_value.get_type() != Variant::ARRAY) return p_value;
+	bool is_array = p_value.get_type() == Variant::ARRAY;
+	Array keys = _get_child_keys(p_value);
+	Array array;
+	Dictionary dict;
+	for (int64_t i = 0; i < keys.size(); ++i) {
+		String part = keys[i];
+		Variant child;
+		WriteOverlay::get_child(p_value, part, child);
+		bool is_nested = (child.get_type() == Variant::DICTIONARY && !Dictionary(child).is_empty()) || (child.get_type() == Variant::ARRAY && !Array(child).is_empty());
+		const Projection *child_keys = p_children;
+		if (p_keys) {
+			child_keys = p_keys->find(part);
+			if (!child_keys || (!is_nested && !child_keys->all)) continue;
+			if (child_keys->all) child_keys = nullptr;
+		}
+		Variant value = child;
+		if (is_nested) {
+			String escaped = _escape_path_part(part);
+			String child_path = p_path.is_empty() ? escaped : p_path + "/" + escaped;
+			if (p_levels == 1) {
+				if (!p_stubs) continue;
+				value = child_path;
 			} else {
-                is_parent_array = false;
-            }
-			current_line_idx += 1;
-			search_range_end = current_line_idx + jump_count;
+				value = _shape_value(child, p_levels < 0 ? -1 : p_levels - 1, p_stubs, child_keys, nullptr, child_path);
+			}
+		}
+		if (is_array) {
+			array.append(value);
 		} else {
-			search_range_end = current_line_idx + 1;
+			dict[keys[i]] = value;
+		}
+	}
+	return is_array ? Variant(array) : Variant(dict);
+}
+
+void PreBuiltIndexJSON::_set_path_error(const String &p_key_path) const {
+	PBIJSON_COUNT_ALLOCATION(); // The message is concatenated before _set_error() stores it.
+	_set_error(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Path '" + p_key_path + "' not found.");
+}
+
+// Child keys in the order the builder writes them: sorted Strings, or the indices of an array.
+Array PreBuiltIndexJSON::_get_child_keys(const Variant &p_container) {
+	Array keys;
+	if (p_container.get_type() == Variant::DICTIONARY) {
+		keys = Dictionary(p_container).keys();
+		keys.sort();
+	} else if (WriteOverlay::is_array(p_container)) {
+		int64_t size = 0;
+		switch (p_container.get_type()) {
+			case Variant::PACKED_INT64_ARRAY: size = PackedInt64Array(p_container).size(); break;
+			case Variant::PACKED_FLOAT64_ARRAY: size = PackedFloat64Array(p_container).size(); break;
+			case Variant::PACKED_STRING_ARRAY: size = PackedStringArray(p_container).size(); break;
+			default: size = Array(p_container).size(); break;
+		}
+		keys.resize(size);
+		for (int64_t i = 0; i < size; ++i) {
+			keys[i] = i;
 		}
 	}
-	if (find_result.is_empty()) {
-		return Dictionary();
+	return keys;
+}
+
+String PreBuiltIndexJSON::_join_path(const PackedStringArray &p_parts) {
+	String path;
+	for (int i = 0; i < p_parts.size(); ++i) {
+		if (i > 0) path += "/";
+		path += _escape_path_part(p_parts[i]);
 	}
-	const String &final_line_content = _current_open_data[find_result["line_idx"]];
-	if (!final_line_content.contains(String::chr(JUMP_MARKER_OPEN))) return Dictionary();
-	int jump = final_line_content.get_slice(String::chr(JUMP_MARKER_OPEN), 1).to_int();
-	int start_idx = (int)find_result["line_idx"] + 1;
-	int child_depth = path_parts.size() + 1;
-	Dictionary result;
-	result["start_idx"] = start_idx;
-	result["end_idx"] = start_idx + jump;
-	result["child_depth"] = child_depth;
-	return result;
+	return path;
+}
+
+bool PreBuiltIndexJSON::_find_leaf(const Snapshot &p_snapshot, const String &p_key_path, const char *p_expected, int &r_line_idx, int &r_value_begin, int &r_value_end) const {
+	if (!p_snapshot.dataset->is_loaded()) {
+		_set_error(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN);
+		return false;
+	}
+	PathLocation location;
+	if (!_locate_path(p_snapshot, p_key_path, location, true)) {
+		return false;
+	}
+	if (location.jump >= 0) {
+		_set_type_error(p_key_path, p_expected);
+		return false;
+	}
+	const String &line = p_snapshot.dataset->lines[location.line_idx];
+	int key_end = _get_line_key_end(line);
+	if (key_end < 0 || key_end >= line.length() || line[key_end] != VALUE_SEPARATOR) {
+		_set_error(PreBuiltIndexJSONOutput::ERR_VALUE_PARSE, "Malformed value line for path: " + p_key_path);
+		return false;
+	}
+	r_line_idx = location.line_idx;
+	r_value_begin = key_end + 1;
+	r_value_end = line.length();
+	if (location.element >= 0) {
+		_find_packed_element(line, location.element, r_value_begin, r_value_end);
+	}
+	return true;
+}
+
+void PreBuiltIndexJSON::_set_type_error(const String &p_key_path, const char *p_expected) const {
+	PBIJSON_COUNT_ALLOCATION(); // The message is concatenated before _set_error() stores it.
+	_set_error(PreBuiltIndexJSONOutput::ERR_UNSUPPORTED_TYPE, "Value at '" + p_key_path + "' is not " + String(p_expected) + ".");
+}
+
+bool PreBuiltIndexJSON::_find_packed_element(const String &p_line, int p_element, int &r_begin, int &r_end) const {
+	int key_end = _get_line_key_end(p_line);
+	if (key_end < 0 || key_end >= p_line.length() || p_line[key_end] != VALUE_SEPARATOR) return false;
+	return ValueDecoder::find_packed_element(p_line, key_end + 1, p_line.length(), p_element, r_begin, r_end);
+}
+
+bool PreBuiltIndexJSON::_find_container_slice(const Snapshot &p_snapshot, const String &p_key_path, PathLocation &r_location) const {
+
+	_last_error.clear();
+	if (!p_snapshot.dataset->is_loaded()) {
+		_set_error(PreBuiltIndexJSONOutput::ERR_DATA_NOT_OPEN);
+		return false;
+	}
+	return _locate_path(p_snapshot, p_key_path, r_location, true) && r_location.jump >= 0;
+}
+
+// The packed array stored on the line at p_location, as an Array. False if the location is
+// not a whole line or its value is not a packed array.
+bool PreBuiltIndexJSON::_read_packed_line(const Snapshot &p_snapshot, const PathLocation &p_location, Variant &r_value) const {
+	if (p_location.line_idx < 0 || p_location.jump >= 0 || p_location.element >= 0) return false;
+	const String &line = p_snapshot.dataset->lines[p_location.line_idx];
+	Variant packed;
+	if (!ValueDecoder::decode_packed(line, _get_line_key_end(line) + 1, line.length(), packed)) return false;
+	r_value = WriteOverlay::to_array(packed);
+	return true;
+}
+
+bool PreBuiltIndexJSON::_read_packed_path(const Snapshot &p_snapshot, const String &p_key_path, Variant &r_value) const {
+	PathLocation location;
+	return p_snapshot.dataset->is_loaded() && _locate_path(p_snapshot, p_key_path, location, false) && _read_packed_line(p_snapshot, location, r_value);
+}
+
+// Keys of an array with p_size elements, the way _parse_line_key() reads a `[i]` key.
+Array PreBuiltIndexJSON::_get_index_keys(int64_t p_size) {
+	Array keys;
+	keys.resize(p_size);
+	for (int64_t i = 0; i < p_size; ++i) {
+		keys[i] = JSON::parse_string("[" + String::num_int64(i) + "]");
+	}
+	return keys;
+}
+
+bool PreBuiltIndexJSON::_locate_path(const Snapshot &p_snapshot, const String &p_key_path, PathLocation &r_location, bool p_report_errors) const {
+	const PackedStringArray &lines = p_snapshot.dataset->lines;
+	r_location.line_idx = -1;
+	r_location.jump = lines.size();
+	r_location.depth = 0;
+	r_location.element = -1;
+	const PathView path(p_key_path);
+	if (path.is_root()) {
+		return true;
+	}
+	PBIJSON_STATS_ADD(LOOKUPS, 1);
+	const int part_count = path.size();
+	const int last_part = part_count - 1;
+
+	// Locations are cached under the canonical path of every resolved prefix, so "a/b"
+	// resolved once lets "a/b/c" start its search inside "a/b". A canonical path is its own
+	// key; other spellings and the prefix keys are only built after a miss.
+	const bool use_location_cache = is_cache_enabled(LOCATION_CACHE);
+	std::vector<CacheKey> prefix_keys;
+	if (use_location_cache) {
+		CacheKey key = path.is_canonical() ? CacheKey(p_key_path) : CacheKey(path.get_prefix(part_count));
+		Vector3i cached;
+		if (p_snapshot.caches->try_get<Vector3i>(LOCATION_CACHE, key, cached)) {
+			// Elements of packed arrays are cached with their index folded into the jump as -2 - index.
+			r_location.line_idx = cached.x;
+			r_location.jump = cached.y <= -2 ? -1 : cached.y;
+			r_location.element = cached.y <= -2 ? -2 - cached.y : -1;
+			r_location.depth = cached.z;
+			return true;
+		}
+		PBIJSON_COUNT_ALLOCATION();
+		prefix_keys.reserve(part_count);
+		for (int i = 0; i < last_part; ++i) {
+			prefix_keys.emplace_back(path.get_prefix(i + 1));
+		}
+		prefix_keys.push_back(key);
+	}
+
+	if (p_snapshot.dataset->path_hash_index.size() > 0 && part_count <= PathView::INLINE_PARTS) {
+		// A hit is only trusted if the line and each of its ancestors sit at the right depth
+		// under the right key; anything else falls back to the regular search. PHX keeps the
+		// shallowest paths, so the ancestors of an indexed line are indexed too, and each is
+		// found by its own prefix hash instead of by walking up the lines.
+		const PathHashIndex &index_table = p_snapshot.dataset->path_hash_index;
+		uint64_t prefix_hashes[PathView::INLINE_PARTS];
+		uint64_t hash = PathHashIndex::HASH_BEGIN;
+		for (int i = 0; i < part_count; ++i) {
+			hash = path.hash(hash, i);
+			prefix_hashes[i] = PathHashIndex::hash_finish(hash);
+		}
+		int line_idx = index_table.find(prefix_hashes[last_part]);
+		if (line_idx >= 0 && line_idx < lines.size()) {
+			bool matches = true;
+			for (int i = last_part; i >= 0 && matches; --i) {
+				int ancestor_idx = i == last_part ? line_idx : index_table.find(prefix_hashes[i]);
+				if (ancestor_idx < 0 || ancestor_idx > line_idx) {
+					matches = false;
+					break;
+				}
+				const String &line = lines[ancestor_idx];
+				if (i < last_part && line_idx > ancestor_idx + _get_line_jump(line)) {
+					matches = false;
+					break;
+				}
+				bool is_index = _line_has_index_key(line);
+				int64_t index = 0;
+				matches = (!is_index || path.to_index(i, index)) && _line_key_matches(line, i + 1, path, i, is_index, index);
+			}
+			if (matches) {
+				const String &line = lines[line_idx];
+				r_location.line_idx = line_idx;
+				r_location.jump = _get_line_jump(line);
+				r_location.depth = part_count;
+				if (use_location_cache) {
+					p_snapshot.caches->set<Vector3i>(LOCATION_CACHE, prefix_keys.back(), Vector3i(r_location.line_idx, r_location.jump, r_location.depth));
+				}
+				PBIJSON_STATS_ADD(PATH_HASH_HITS, 1);
+				return true;
+			}
+		}
+	}
+
+	int first_part = 0;
+	int current_line_idx = 0;
+	int search_range_end = lines.size();
+	bool is_parent_array = _line_has_index_key(lines[0]);
+	if (use_location_cache) {
+		for (int i = part_count - 2; i >= 0; --i) {
+			Vector3i cached;
+			if (!p_snapshot.caches->try_get<Vector3i>(LOCATION_CACHE, prefix_keys[i], cached)) continue;
+			if (cached.y <= 0) break; // A value or an empty container; let the search report it.
+			first_part = i + 1;
+			current_line_idx = cached.x + 1;
+			search_range_end = current_line_idx + cached.y;
+			is_parent_array = _line_has_index_key(lines[current_line_idx]);
+			break;
+		}
+	}
+	for (int i = first_part; i < part_count; ++i) {
+		int expected_depth = i + 1;
+		int line_idx = _find_part_in_range(p_snapshot, path, i, expected_depth, current_line_idx, search_range_end, is_parent_array, p_report_errors);
+		if (line_idx < 0) {
+			if (p_report_errors && _last_error->get_error_type() == PreBuiltIndexJSONOutput::OK) {
+				_set_error(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Path part '" + path.get_part(i) + "' not found.");
+			}
+			return false;
+		}
+		int jump_count = _get_line_jump(lines[line_idx]);
+		if (use_location_cache) {
+			p_snapshot.caches->set<Vector3i>(LOCATION_CACHE, prefix_keys[i], Vector3i(line_idx, jump_count, expected_depth));
+		}
+		if (i == last_part) {
+			r_location.line_idx = line_idx;
+			r_location.jump = jump_count;
+			r_location.depth = expected_depth;
+			return true;
+		}
+		if (jump_count < 0) {
+			// The last part may index into a packed array, which has no lines of its own.
+			int64_t element = -1;
+			int begin = 0;
+			int end = 0;
+			if (i + 1 == last_part && path.to_index(last_part, element) && element <= INT32_MAX && _find_packed_element(lines[line_idx], (int)element, begin, end)) {
+				r_location.line_idx = line_idx;
+				r_location.jump = -1;
+				r_location.depth = expected_depth + 1;
+				r_location.element = (int)element;
+				if (use_location_cache) {
+					p_snapshot.caches->set<Vector3i>(LOCATION_CACHE, prefix_keys[last_part], Vector3i(line_idx, -2 - (int)element, r_location.depth));
+				}
+				return true;
+			}
+			if (p_report_errors) {
+				_set_error(PreBuiltIndexJSONOutput::ERR_INVALID_PATH, "Path expects a container, but found a value at part '" + path.get_part(i) + "'.");
+			}
+			return false;
+		}
+		is_parent_array = jump_count > 0 && _line_has_index_key(lines[line_idx + 1]);
+		current_line_idx = line_idx + 1;
+		search_range_end = current_line_idx + jump_count;
+	}
+	return false;
+}
+
+// Records an error in the calling thread's output object in place instead of allocating a new one.
+void PreBuiltIndexJSON::_set_error(PreBuiltIndexJSONOutput::ErrorType p_error_type, const String &p_message) const {
+	if (!p_message.is_empty()) {
+		PBIJSON_COUNT_ALLOCATION();
+	}
+	_last_error.set_error(p_error_type, p_message);
 }
 
 Dictionary PreBuiltIndexJSON::_parse_header(const String &p_line) {
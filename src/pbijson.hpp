@@ -25,18 +25,55 @@
 
 #include <godot_cpp/classes/ref_counted.hpp>
 #include <godot_cpp/classes/mutex.hpp>
+#include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
 #include <godot_cpp/variant/packed_string_array.hpp>
-#include <godot_cpp/variant/string_name.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
 #include "pbijson_output.hpp"
+#include "pbijson_path.hpp"
+#include "pbijson_stats.hpp"
+#include "pbijson_trace.hpp"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <thread>
 #include <type_traits> // For std::is_same_v
+#include <unordered_map>
 
 using namespace godot;
 
-// Forward declaration
-class CacheManager;
+class JsonWriter;
+class WriteOverlay;
+
+// Holds the result of the last call an instance made on the current thread, so
+// concurrent readers never share or overwrite each other's error object.
+// It behaves like the Ref<PreBuiltIndexJSONOutput> it replaces.
+class PreBuiltIndexJSONErrorSlot {
+private:
+	// One output per thread that ever called the instance, freed with the instance. Each thread
+	// also remembers the entries it used last by slot id, so steady-state calls take no lock.
+	const uint64_t _id;
+	mutable std::shared_mutex _mutex;
+	mutable std::unordered_map<std::thread::id, Ref<PreBuiltIndexJSONOutput>> _slots;
+	Ref<PreBuiltIndexJSONOutput> &_get() const;
+	Ref<PreBuiltIndexJSONOutput> &_find_or_add() const;
+
+public:
+	PreBuiltIndexJSONErrorSlot();
+	PreBuiltIndexJSONErrorSlot(const PreBuiltIndexJSONErrorSlot &) = delete;
+
+	PreBuiltIndexJSONErrorSlot &operator=(const Ref<PreBuiltIndexJSONOutput> &p_output);
+	// Outputs already returned to a caller are never changed under them: a shared one is replaced.
+	void clear() const;
+	void set_error(PreBuiltIndexJSONOutput::ErrorType p_error_type, const String &p_message) const;
+	PreBuiltIndexJSONOutput *operator->() const { return _get().ptr(); }
+	operator Ref<PreBuiltIndexJSONOutput>() const { return _get(); }
+	bool is_valid() const { return true; }
+};
 
 class PreBuiltIndexJSON : public RefCounted {
 	GDCLASS(PreBuiltIndexJSON, RefCounted)
@@ -51,7 +88,9 @@ public:
 		GET_SIZE_CACHE   = 1 << 2,
 		GET_SUBPATHS_CACHE = 1 << 3,
 		GET_KEYS_CACHE   = 1 << 4,
-		ALL              = (1 << 5) - 1,
+		AGGREGATE_CACHE  = 1 << 5,
+		LOCATION_CACHE   = 1 << 6,
+		ALL              = (1 << 7) - 1,
 	};
 
 protected:
@@ -61,60 +100,246 @@ private:
 	const char32_t DEPTH_MARKER = U':';
 	const char32_t VALUE_SEPARATOR = U'>';
 	const char32_t JUMP_MARKER_OPEN = U'<';
+	const char32_t SECTION_MARKER = U'@';
+
+	struct BuildContext;
+	struct Dataset;
+	struct Snapshot;
+	struct DatasetRegistry;
+	struct Projection;
+
+	struct PathLocation {
+		int line_idx = -1; // -1 is the root container.
+		int jump = -1; // Number of descendant lines, -1 for a value.
+		int depth = 0;
+		int element = -1; // Index into the packed array on line_idx, -1 otherwise.
+
+		int children_begin() const { return line_idx + 1; }
+		int children_end() const { return line_idx + 1 + jump; }
+	};
 	
+	// Serializes writers (loading, building, warm-up bookkeeping). Readers never take it:
+	// they pin the current snapshot, which is immutable apart from its internally locked caches.
 	Ref<Mutex> _mutex;
-	String _current_open_file;
-	PackedStringArray _current_open_data;
-	PackedStringArray _build_buffer;
+	std::shared_ptr<const Snapshot> _snapshot; // Accessed with std::atomic_load/std::atomic_store.
 	
-	CacheFlags cache_flags = ALL;
+	std::atomic<int> cache_flags{ ALL };
 
-	class CacheManager* _cache_manager;
-	mutable Ref<PreBuiltIndexJSONOutput> _last_error;
+	mutable PreBuiltIndexJSONErrorSlot _last_error;
 
-	void _build_flat_index_recursive(const Variant &p_current_value, int p_depth, Dictionary &p_container_lines);
-	void _add_jump_marks_to_buffer(Dictionary &p_container_lines);
+	// Query statistics survive reloads, so they live here rather than in the snapshot.
+	mutable QueryStats _stats;
+	PackedStringArray _monitor_ids; // Performance custom monitors registered by this instance.
+	// Access tracing. The trace is kept after stop_trace(), so it can still be read and dumped.
+	mutable QueryTraceHolder _trace;
+
+	// Background warm-up. The queue is drained one path at a time by a single WorkerThreadPool task,
+	// taking the mutex per path so foreground queries can interleave.
+	PackedStringArray _warmup_paths;
+	PackedStringArray _prefetch_queue;
+	int _prefetch_next = 0;
+	bool _prefetch_running = false;
+	int64_t _prefetch_task_id = -1;
+	std::atomic<bool> _prefetch_cancelled{ false };
+
+	// Background reload (hot_reload). The task takes the mutex only to read its parameters
+	// and to publish; _generation tells it whether something else was loaded meanwhile.
+	uint64_t _generation = 0;
+	String _reload_path;
+	bool _reload_ignore_hash = false;
+	bool _reload_keep_caches = true;
+	uint64_t _reload_generation = 0;
+	bool _reload_running = false;
+	int64_t _reload_task_id = -1;
+	Ref<PreBuiltIndexJSONOutput> _reload_result;
+
+	// The *_async operations. One runs at a time on a WorkerThreadPool task; progress and the
+	// result are delivered through deferred signals so handlers run on the main thread.
+	enum AsyncOperation {
+		ASYNC_BUILD,
+		ASYNC_BUILD_TO,
+		ASYNC_OPEN,
+	};
+	static constexpr int ASYNC_PROGRESS_LINES = 4096; // Lines flattened between progress signals.
+	AsyncOperation _async_operation = ASYNC_BUILD;
+	String _async_source;
+	String _async_target;
+	Dictionary _async_options;
+	bool _async_ignore_hash = false;
+	bool _async_running = false;
+	int64_t _async_task_id = -1;
+	std::atomic<bool> _async_cancelled{ false };
+	Ref<PreBuiltIndexJSONOutput> _async_result;
+
+	void _build_flat_index_recursive(const Variant &p_current_value, int p_depth, Dictionary &p_container_lines, BuildContext &p_context);
+	void _add_jump_marks_to_buffer(Dictionary &p_container_lines, PackedStringArray &r_lines);
 	int _get_line_depth(const String &p_line) const;
 	String _get_line_key_part(const String &p_line) const;
 	Variant _get_line_value(const String &p_line, int p_line_number) const;
+	int _get_line_key_end(const String &p_line) const;
+	int _get_line_jump(const String &p_line) const;
+	String _get_line_raw_value(const String &p_line) const;
+	Variant _get_line_key(const String &p_line) const;
+	// The key as JSON::parse_string() reads it: quoted keys decode to String, `[i]` keys to a one-element Array.
+	Variant _parse_line_key(const String &p_line) const;
 	PackedStringArray _parse_escaped_path(const String &p_path) const;
-	Dictionary _find_part_in_range(const String &p_part, int p_depth, int p_start_line, int p_end_line, bool p_is_parent_array, const String &p_full_path) const;
+	PackedStringArray _canonical_parts(const Snapshot &p_snapshot, const PackedStringArray &p_parts) const;
+	bool _line_has_index_key(const String &p_line) const;
+	bool _line_key_matches(const String &p_line, int p_depth, const PathView &p_path, int p_part, bool p_is_index, int64_t p_index) const;
+	int _find_part_in_range(const Snapshot &p_snapshot, const PathView &p_path, int p_part, int p_depth, int p_start_line, int p_end_line, bool p_is_parent_array, bool p_report_errors) const;
+	int _find_relative_line(const Snapshot &p_snapshot, const PathView &p_path, int p_depth, int p_start_line, int p_end_line) const;
+	static String _escape_path_part(const String &p_part);
+	template <typename T, typename D, typename C>
+	T _get_typed_value(const String &p_key_path, const T &p_default, const char *p_expected, D &&p_decode, C &&p_convert) const;
+	bool _find_leaf(const Snapshot &p_snapshot, const String &p_key_path, const char *p_expected, int &r_line_idx, int &r_value_begin, int &r_value_end) const;
+	bool _find_packed_element(const String &p_line, int p_element, int &r_begin, int &r_end) const;
+	void _set_type_error(const String &p_key_path, const char *p_expected) const;
+	template <typename F>
+	bool _scan_numeric_field(const Snapshot &p_snapshot, const String &p_collection_path, const String &p_field_path, F &&p_callback) const;
 	Variant _rebuild_container_from_slice(const PackedStringArray &p_slice, int p_base_depth, bool p_is_array) const;
-    Dictionary _find_container_slice(const String &p_key_path) const;
+	Variant _materialize(const Snapshot &p_snapshot, int p_begin, int p_end, bool p_is_array, int p_levels, bool p_stubs, const Projection *p_keys, const Projection *p_children, const String &p_path) const;
+	bool _read_base_value(const Snapshot &p_snapshot, const String &p_key_path, Variant &r_value) const;
+	Variant _read_line_entry(const Snapshot &p_snapshot, int p_line_idx) const;
+	bool _read_overlay(const Snapshot &p_snapshot, const String &p_key_path, Variant &r_value, bool &r_found) const;
+	Variant _get_element_value(const String &p_line, int p_element) const;
+	int _count_children(const Snapshot &p_snapshot, const PathLocation &p_location) const;
+	Variant _shape_value(const Variant &p_value, int p_levels, bool p_stubs, const Projection *p_keys, const Projection *p_children, const String &p_path) const;
+	template <typename F>
+	bool _scan_numeric_value(const Variant &p_collection, const String &p_field_path, F &&p_callback) const;
+	void _set_path_error(const String &p_key_path) const;
+	static Array _get_child_keys(const Variant &p_container);
+	static String _join_path(const PackedStringArray &p_parts);
+	bool _write_json(const Snapshot &p_snapshot, const PathLocation &p_location, const String &p_indent, JsonWriter &r_writer) const;
+	void _write_json_value(const String &p_line, int p_begin, int p_end, int p_level, const String &p_indent, JsonWriter &r_writer) const;
+	bool _export_json(const String &p_key_path, const String &p_indent, JsonWriter &r_writer) const;
+	bool _find_container_slice(const Snapshot &p_snapshot, const String &p_key_path, PathLocation &r_location) const;
+	bool _read_packed_line(const Snapshot &p_snapshot, const PathLocation &p_location, Variant &r_value) const;
+	bool _read_packed_path(const Snapshot &p_snapshot, const String &p_key_path, Variant &r_value) const;
+	static Array _get_index_keys(int64_t p_size);
+	bool _locate_path(const Snapshot &p_snapshot, const String &p_key_path, PathLocation &r_location, bool p_report_errors) const;
+	void _set_error(PreBuiltIndexJSONOutput::ErrorType p_error_type, const String &p_message = String()) const;
     void _remove_trailing_empty_line(PackedStringArray &p_array) const;
-	Ref<PreBuiltIndexJSONOutput> _open_data(const PackedStringArray &p_data,const bool &ignore_hash = false);
+	Ref<PreBuiltIndexJSONOutput> _open_data(const PackedStringArray &p_data,const bool &ignore_hash = false, const String &p_file = String());
+	Ref<PreBuiltIndexJSONOutput> _read_dataset(const String &p_path, bool p_ignore_hash, std::shared_ptr<const Dataset> &r_dataset, bool p_async = false);
+	Ref<PreBuiltIndexJSONOutput> _load_dataset(const PackedStringArray &p_data, bool p_ignore_hash, std::shared_ptr<Dataset> &r_dataset, bool p_async = false);
+	std::shared_ptr<const Snapshot> _get_snapshot() const;
+	void _publish(const std::shared_ptr<const Dataset> &p_dataset, const String &p_file, bool p_keep_valid_caches = false);
+	void _commit_dataset(const std::shared_ptr<const Dataset> &p_dataset, const String &p_file, bool p_keep_valid_caches);
 
 	String _generate_file_header(const Dictionary &data);
 	Dictionary _parse_header(const String &p_line);
-	Ref<PreBuiltIndexJSONOutput> _build(const String &p_json_text);
+	Ref<PreBuiltIndexJSONOutput> _parse_sections(Dataset &r_dataset);
+	void _build_line_scan(Dataset &r_dataset) const;
+	Ref<PreBuiltIndexJSONOutput> _build(const String &p_json_text, const Dictionary &p_options = Dictionary(), bool p_async = false);
+	Ref<PreBuiltIndexJSONOutput> _build_from_data(const Variant &p_data, const Dictionary &p_options, bool p_async = false);
+	Ref<PreBuiltIndexJSONOutput> _build_merged(const Dictionary &p_options);
+	Ref<PreBuiltIndexJSONOutput> _edit(const String &p_key_path, const Variant &p_value, bool p_erase);
+	std::shared_ptr<Snapshot> _begin_edits(std::shared_ptr<WriteOverlay> &r_overlay);
+	bool _add_edit(Snapshot &p_working, WriteOverlay &p_overlay, const String &p_key_path, const Variant &p_value, bool p_erase, bool p_insert);
+	void _publish_overlay(const std::shared_ptr<const WriteOverlay> &p_overlay);
+	void _diff_range(const Snapshot &p_old, int p_old_begin, int p_old_end, const PreBuiltIndexJSON &p_other, const Snapshot &p_new, int p_new_begin, int p_new_end, bool p_is_array, const String &p_path, Array &r_ops) const;
+	void _diff_line(const Snapshot &p_old, int p_old_line, const PreBuiltIndexJSON &p_other, const Snapshot &p_new, int p_new_line, const String &p_path, Array &r_ops) const;
+	Ref<PreBuiltIndexJSONOutput> _store_build(const Ref<PreBuiltIndexJSONOutput> &p_output, const String &p_target_path);
+	String _get_path_for_line(const Snapshot &p_snapshot, int p_line_idx) const;
+	static String _index_value_key(const Variant &p_value);
+	void _queue_prefetch(const PackedStringArray &p_paths);
+	void _prefetch_task();
+	void _reload_task();
+	Ref<PreBuiltIndexJSONOutput> _start_async(AsyncOperation p_operation, const String &p_source, const String &p_target, const Dictionary &p_options, bool p_ignore_hash);
+	bool _async_step(const String &p_stage, int64_t p_current, int64_t p_total);
+	static Ref<PreBuiltIndexJSONOutput> _cancelled_output();
+	void _async_task();
 public:
 	PreBuiltIndexJSON();
 	~PreBuiltIndexJSON() override;
 
 	// Build methods
-	Ref<PreBuiltIndexJSONOutput> build_from_string(const String &p_json_text);
-	Ref<PreBuiltIndexJSONOutput> build_from_file(const String &p_json_file);
-	Ref<PreBuiltIndexJSONOutput> build_from_file_to(const String &p_json_file, const String &p_target_path);
+	Ref<PreBuiltIndexJSONOutput> build_from_string(const String &p_json_text, const Dictionary &p_options = Dictionary());
+	Ref<PreBuiltIndexJSONOutput> build_from_file(const String &p_json_file, const Dictionary &p_options = Dictionary());
+	Ref<PreBuiltIndexJSONOutput> build_from_file_to(const String &p_json_file, const String &p_target_path, const Dictionary &p_options = Dictionary());
 
 	// Data loading methods
 	Ref<PreBuiltIndexJSONOutput> open_file(const String &p_path,const bool &ignore_hash = false);
 	Ref<PreBuiltIndexJSONOutput> open_from_string(const String &p_data,const bool &ignore_hash = false);
 	Ref<PreBuiltIndexJSONOutput> open_from_array(const PackedStringArray &p_data,const bool &ignore_hash = false);
 	Ref<PreBuiltIndexJSONOutput> reload_file(const bool &ignore_hash = false);
+	Ref<PreBuiltIndexJSONOutput> hot_reload(bool p_ignore_hash = false, bool p_keep_valid_caches = true);
+	bool is_reloading() const;
+	Ref<PreBuiltIndexJSONOutput> wait_for_reload();
+
+	// Asynchronous variants
+	Ref<PreBuiltIndexJSONOutput> build_from_file_async(const String &p_json_file, const Dictionary &p_options = Dictionary());
+	Ref<PreBuiltIndexJSONOutput> build_from_file_to_async(const String &p_json_file, const String &p_target_path, const Dictionary &p_options = Dictionary());
+	Ref<PreBuiltIndexJSONOutput> open_file_async(const String &p_path, bool p_ignore_hash = false);
+	void cancel_async();
+	bool is_async_running() const;
+	Ref<PreBuiltIndexJSONOutput> wait_for_async();
 
 	// Data query methods
-	Variant get_value(const String &p_key_path, const Variant &p_default = Variant()) const;
+	Variant get_value(const String &p_key_path, const Variant &p_default = Variant(), const Dictionary &p_options = Dictionary()) const;
+	int64_t get_int(const String &p_key_path, int64_t p_default = 0) const;
+	double get_float(const String &p_key_path, double p_default = 0.0) const;
+	bool get_bool(const String &p_key_path, bool p_default = false) const;
+	String get_string(const String &p_key_path, const String &p_default = String()) const;
+	String get_json(const String &p_key_path, const String &p_indent = String()) const;
+	PackedByteArray get_json_buffer(const String &p_key_path, const String &p_indent = String()) const;
+	Error store_json(const Ref<FileAccess> &p_file, const String &p_key_path, const String &p_indent = String()) const;
     bool has_path(const String &p_key_path) const;
     int get_size(const String &p_key_path) const;
     Array get_keys(const String &p_key_path) const;
     PackedStringArray get_sub_paths(const String &p_key_path) const;
+	Array query(const String &p_container_path, const Variant &p_predicate, bool p_return_paths = false) const;
+	Dictionary aggregate(const String &p_collection_path, const String &p_field_path) const;
+	Array top_k(const String &p_collection_path, const String &p_field_path, int p_k, bool p_ascending = false) const;
+	PackedStringArray find_by(const String &p_field_path, const Variant &p_value) const;
+	PackedStringArray get_indexed_fields() const;
+
+	// Pending changes
+	Ref<PreBuiltIndexJSONOutput> set_value(const String &p_key_path, const Variant &p_value);
+	Ref<PreBuiltIndexJSONOutput> erase_path(const String &p_key_path);
+	int get_pending_change_count() const;
+	void discard_changes();
+	Ref<PreBuiltIndexJSONOutput> compact(const Dictionary &p_options = Dictionary());
+	Ref<PreBuiltIndexJSONOutput> save_to(const String &p_target_path, const Dictionary &p_options = Dictionary());
+	Dictionary diff(const Ref<PreBuiltIndexJSON> &p_other) const;
+	Ref<PreBuiltIndexJSONOutput> apply_patch(const Dictionary &p_patch);
 
 	// State and cache management
 	void clear();
 	void close();
 	void clear_caches();
 	void clear_cache(CacheFlags p_flag);
-	bool remove_from_cache(CacheFlags p_flag, const StringName &p_key_path);
+	bool remove_from_cache(CacheFlags p_flag, const String &p_key_path);
+	void set_cache_limit(int p_flags, int64_t p_max_entries, int64_t p_max_bytes = 0);
+	Dictionary get_cache_stats(CacheFlags p_flag) const;
+	void reset_cache_stats(int p_flags = ALL);
+	int64_t get_cache_memory_usage() const;
+
+	// Statistics
+	Dictionary get_stats() const;
+	double get_stat(const String &p_name) const;
+	void reset_stats();
+	void set_stats_enabled(bool p_enabled);
+	bool is_stats_enabled() const;
+	Error add_performance_monitors(const String &p_category = "PBIJSON");
+	void remove_performance_monitors();
+
+	// Tracing
+	Error start_trace(const Dictionary &p_options = Dictionary());
+	void stop_trace();
+	bool is_tracing() const;
+	Array get_trace_events() const;
+	Error dump_trace(const String &p_path) const;
+	Dictionary get_trace_report(int p_top = 20) const;
+	static Dictionary load_trace_report(const String &p_path, int p_top = 20);
+
+	// Warm-up
+	void prefetch(const PackedStringArray &p_paths);
+	bool is_prefetching() const;
+	void wait_for_prefetch();
+	PackedStringArray get_cached_paths(int p_flags = ALL) const;
+	void set_warmup_paths(const PackedStringArray &p_paths);
+	PackedStringArray get_warmup_paths() const;
 	
 	// Getters & Setters for properties
 	Ref<PreBuiltIndexJSONOutput> get_last_error() const;
@@ -125,10 +350,14 @@ public:
 	int get_cache_flags() const;
 	bool is_cache_enabled(CacheFlags p_flag) const;
 	void set_cache_enabled(CacheFlags p_flag, bool p_enabled);
-    bool has_in_cache(CacheFlags p_flag, const StringName &p_key_path) const;
+    bool has_in_cache(CacheFlags p_flag, const String &p_key_path) const;
 
 	
 	static String get_pbijson_format();
+	static int get_shared_dataset_count();
+	static String get_line_scan_kernel();
+	static int64_t get_debug_allocation_count();
+	static void reset_debug_allocation_count();
 };
 
 // Now that the class is defined, we can add the macro.
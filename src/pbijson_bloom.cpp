@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_bloom.hpp"
+#include "pbijson_path_hash.hpp"
+
+#include <godot_cpp/classes/marshalls.hpp>
+
+#include <cmath>
+
+using namespace godot;
+
+uint64_t BloomFilterSet::_hash_key(const String &p_key) {
+	return PathHashIndex::hash_finish(PathHashIndex::hash_part(PathHashIndex::HASH_BEGIN, p_key));
+}
+
+PackedStringArray BloomFilterSet::build_section(const std::map<int, std::vector<String>> &p_container_keys, int p_min_children, int p_bits_per_key) {
+	PackedStringArray lines;
+	if (p_bits_per_key < 1) p_bits_per_key = 1;
+	uint32_t hash_count = (uint32_t)std::lround(p_bits_per_key * 0.6931);
+	if (hash_count < 1) hash_count = 1;
+	for (const std::pair<const int, std::vector<String>> &container : p_container_keys) {
+		const std::vector<String> &keys = container.second;
+		if ((int)keys.size() < p_min_children) continue;
+		uint32_t bit_count = (uint32_t)keys.size() * p_bits_per_key;
+		bit_count = ((bit_count < 64 ? 64 : bit_count) + 7) & ~7u;
+		PackedByteArray bits;
+		bits.resize(bit_count / 8);
+		bits.fill(0);
+		uint8_t *bits_ptr = bits.ptrw();
+		for (const String &key : keys) {
+			uint64_t hash = _hash_key(key);
+			uint32_t h1 = (uint32_t)hash;
+			uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+			for (uint32_t i = 0; i < hash_count; ++i) {
+				uint32_t bit = (h1 + i * h2) % bit_count;
+				bits_ptr[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+			}
+		}
+		lines.append(String::num_int64(container.first) + ">" + String::num_int64(bit_count) + ">" + String::num_int64(hash_count) + ">" + Marshalls::get_singleton()->raw_to_base64(bits));
+	}
+	return lines;
+}
+
+bool BloomFilterSet::load(const PackedStringArray &p_lines, int p_start, int p_count) {
+	clear();
+	for (int i = p_start; i < p_start + p_count; ++i) {
+		PackedStringArray fields = p_lines[i].split(">", true, 3);
+		if (fields.size() != 4 || !fields[0].is_valid_int() || !fields[1].is_valid_int() || !fields[2].is_valid_int()) {
+			clear();
+			return false;
+		}
+		Filter filter;
+		filter.bit_count = (uint32_t)fields[1].to_int();
+		filter.hash_count = (uint32_t)fields[2].to_int();
+		filter.bits = Marshalls::get_singleton()->base64_to_raw(fields[3]);
+		if (filter.bit_count == 0 || filter.hash_count == 0 || (uint32_t)filter.bits.size() * 8 < filter.bit_count) {
+			clear();
+			return false;
+		}
+		_filters[(int)fields[0].to_int()] = filter;
+	}
+	return true;
+}
+
+bool BloomFilterSet::may_contain(int p_container_line, const String &p_key) const {
+	return may_contain(p_container_line, _hash_key(p_key));
+}
+
+bool BloomFilterSet::may_contain(int p_container_line, uint64_t p_key_hash) const {
+	std::unordered_map<int, Filter>::const_iterator it = _filters.find(p_container_line);
+	if (it == _filters.end()) return true;
+	const Filter &filter = it->second;
+	const uint8_t *bits_ptr = filter.bits.ptr();
+	uint64_t hash = p_key_hash;
+	uint32_t h1 = (uint32_t)hash;
+	uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+	for (uint32_t i = 0; i < filter.hash_count; ++i) {
+		uint32_t bit = (h1 + i * h2) % filter.bit_count;
+		if ((bits_ptr[bit >> 3] & (1 << (bit & 7))) == 0) return false;
+	}
+	return true;
+}
@@ -0,0 +1,63 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+using namespace godot;
+
+// Bloom filters over the direct child keys of large containers, loaded from the
+// optional BLM section. A negative answer proves the key is absent, so a missing
+// path part can be rejected without scanning the container.
+class BloomFilterSet {
+	struct Filter {
+		PackedByteArray bits;
+		uint32_t bit_count = 0;
+		uint32_t hash_count = 0;
+	};
+
+	// Keyed by the line index of the container, -1 for the root.
+	std::unordered_map<int, Filter> _filters;
+
+	static uint64_t _hash_key(const String &p_key);
+
+public:
+	// Builds `container_line>bit_count>hash_count>base64_bits` payload lines for every
+	// container with at least p_min_children keys.
+	static PackedStringArray build_section(const std::map<int, std::vector<String>> &p_container_keys, int p_min_children, int p_bits_per_key);
+
+	bool load(const PackedStringArray &p_lines, int p_start, int p_count);
+	void clear() { _filters.clear(); }
+	int size() const { return (int)_filters.size(); }
+	bool may_contain(int p_container_line, const String &p_key) const;
+	// p_key_hash is PathHashIndex::hash_finish() over the key as a single part.
+	bool may_contain(int p_container_line, uint64_t p_key_hash) const;
+};
@@ -0,0 +1,83 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_cache.hpp"
+
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+using namespace godot;
+
+int64_t estimate_variant_size(const Variant &p_value) {
+	const int64_t base = (int64_t)sizeof(Variant);
+	switch (p_value.get_type()) {
+		case Variant::STRING: {
+			String string = p_value;
+			return base + 16 + string.length() * (int64_t)sizeof(char32_t);
+		}
+		case Variant::ARRAY: {
+			Array array = p_value;
+			int64_t size = base + 16;
+			for (int64_t i = 0; i < array.size(); ++i) {
+				size += estimate_variant_size(array[i]);
+			}
+			return size;
+		}
+		case Variant::DICTIONARY: {
+			Dictionary dictionary = p_value;
+			Array keys = dictionary.keys();
+			// Hash map slot and insertion-order links per element.
+			int64_t size = base + 32 + keys.size() * 32;
+			for (int64_t i = 0; i < keys.size(); ++i) {
+				size += estimate_variant_size(keys[i]);
+				size += estimate_variant_size(dictionary[keys[i]]);
+			}
+			return size;
+		}
+		case Variant::PACKED_STRING_ARRAY: {
+			PackedStringArray strings = p_value;
+			int64_t size = base + 16;
+			for (int64_t i = 0; i < strings.size(); ++i) {
+				size += 16 + strings[i].length() * (int64_t)sizeof(char32_t);
+			}
+			return size;
+		}
+		case Variant::PACKED_BYTE_ARRAY: return base + 16 + ((PackedByteArray)p_value).size();
+		case Variant::PACKED_INT32_ARRAY: return base + 16 + ((PackedInt32Array)p_value).size() * 4;
+		case Variant::PACKED_INT64_ARRAY: return base + 16 + ((PackedInt64Array)p_value).size() * 8;
+		case Variant::PACKED_FLOAT32_ARRAY: return base + 16 + ((PackedFloat32Array)p_value).size() * 4;
+		case Variant::PACKED_FLOAT64_ARRAY: return base + 16 + ((PackedFloat64Array)p_value).size() * 8;
+		default:
+			return base;
+	}
+}
+
+uint64_t CacheKey::hash_path(const String &p_path) {
+	uint64_t hash = 14695981039346656037ULL;
+	const char32_t *ptr = p_path.ptr();
+	for (int64_t i = 0; i < p_path.length(); ++i) {
+		hash ^= (uint64_t)ptr[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,532 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include "pbijson.hpp"
+#include "pbijson_debug.hpp"
+
+#include <godot_cpp/variant/variant.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+using namespace godot;
+
+// Approximate heap footprint of a Variant, used for the byte budget of the caches.
+// Containers are walked recursively; the figures are estimates, not exact allocator sizes.
+int64_t estimate_variant_size(const Variant &p_value);
+
+// A cache key carrying a precomputed 64-bit FNV-1a hash of the path and the path itself,
+// which is compared on lookup so a hash collision can never return another path's result.
+// Unlike StringName it does not go through Godot's global interning table.
+struct CacheKey {
+	uint64_t hash = 0;
+	String path;
+
+	CacheKey() {}
+	explicit CacheKey(const String &p_path) :
+			hash(hash_path(p_path)), path(p_path) {}
+
+	static uint64_t hash_path(const String &p_path);
+};
+
+// One shard's part of a least-recently-used cache. It holds no limits of its own: CacheManager
+// bounds the cache as a whole and evicts from whichever shard holds the oldest entry.
+// Not thread-safe; CacheManager locks the shard that owns it.
+template <typename T>
+class TypedCache {
+private:
+	struct Entry {
+		CacheKey key;
+		T value;
+		int64_t bytes = 0;
+		uint64_t last_used = 0;
+	};
+
+	// Front is the most recently used entry.
+	std::list<Entry> _lru;
+	std::unordered_map<uint64_t, typename std::list<Entry>::iterator> _index;
+
+	int64_t _bytes = 0;
+
+	uint64_t _hits = 0;
+	uint64_t _misses = 0;
+	uint64_t _evictions = 0;
+
+	// Per-entry bookkeeping: list node, hash node and the key itself.
+	static constexpr int64_t ENTRY_OVERHEAD = 64;
+
+	typename std::unordered_map<uint64_t, typename std::list<Entry>::iterator>::const_iterator _find(const CacheKey &key) const {
+		auto it = _index.find(key.hash);
+		if (it != _index.end() && it->second->key.path != key.path) return _index.end();
+		return it;
+	}
+
+public:
+	struct Stats {
+		int64_t entries = 0;
+		int64_t bytes = 0;
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+	};
+
+	static int64_t entry_size(const CacheKey &p_key, const T &p_value) {
+		return ENTRY_OVERHEAD + p_key.path.length() * (int64_t)sizeof(char32_t) + estimate_variant_size(Variant(p_value));
+	}
+
+	bool has(const CacheKey &key) const { return _find(key) != _index.end(); }
+
+	T get(const CacheKey &key) const {
+		auto it = _find(key);
+		return it == _index.end() ? T() : it->second->value;
+	}
+
+	// Looks the key up, records a hit or a miss and marks the entry as most recently used.
+	bool try_get(const CacheKey &key, T &r_value, uint64_t p_tick) {
+		auto it = _find(key);
+		if (it == _index.end()) {
+			_misses++;
+			return false;
+		}
+		_lru.splice(_lru.begin(), _lru, it->second);
+		it->second->last_used = p_tick;
+		r_value = it->second->value;
+		_hits++;
+		PBIJSON_COUNT_CACHE_HIT();
+		return true;
+	}
+
+	void set(const CacheKey &key, const T &value, int64_t p_bytes, uint64_t p_tick) {
+		// A colliding entry for another path is replaced.
+		auto it = _index.find(key.hash);
+		if (it != _index.end()) {
+			_bytes += p_bytes - it->second->bytes;
+			it->second->key = key;
+			it->second->value = value;
+			it->second->bytes = p_bytes;
+			it->second->last_used = p_tick;
+			_lru.splice(_lru.begin(), _lru, it->second);
+		} else {
+			PBIJSON_COUNT_ALLOCATION();
+			_lru.push_front(Entry{ key, value, p_bytes, p_tick });
+			_index[key.hash] = _lru.begin();
+			_bytes += p_bytes;
+		}
+	}
+
+	bool erase(const CacheKey &key) {
+		auto it = _find(key);
+		if (it == _index.end()) return false;
+		_bytes -= it->second->bytes;
+		_lru.erase(it->second);
+		_index.erase(it);
+		return true;
+	}
+
+	// When the least recently used entry of this shard was last used; false when empty.
+	bool get_oldest_tick(uint64_t &r_tick) const {
+		if (_lru.empty()) return false;
+		r_tick = _lru.back().last_used;
+		return true;
+	}
+
+	void evict_oldest() {
+		if (_lru.empty()) return;
+		Entry &victim = _lru.back();
+		_bytes -= victim.bytes;
+		_index.erase(victim.key.hash);
+		_lru.pop_back();
+		_evictions++;
+	}
+
+	void clear() {
+		_lru.clear();
+		_index.clear();
+		_bytes = 0;
+	}
+
+	void reset_stats() {
+		_hits = 0;
+		_misses = 0;
+		_evictions = 0;
+	}
+
+	// Takes over the counters of another cache, but none of its entries.
+	void copy_settings(const TypedCache &p_other) {
+		_hits = p_other._hits;
+		_misses = p_other._misses;
+		_evictions = p_other._evictions;
+	}
+
+	// Replaces this cache's entries with copies of another cache's, in the same recency order.
+	void copy_entries(const TypedCache &p_other) {
+		clear();
+		_lru = p_other._lru;
+		for (auto it = _lru.begin(); it != _lru.end(); ++it) {
+			_index[it->key.hash] = it;
+			_bytes += it->bytes;
+		}
+	}
+
+	void add_stats(Stats &r_stats) const {
+		r_stats.entries += (int64_t)_lru.size();
+		r_stats.bytes += _bytes;
+		r_stats.hits += _hits;
+		r_stats.misses += _misses;
+		r_stats.evictions += _evictions;
+	}
+
+	template <typename F>
+	void for_each_entry(F &&p_func) const {
+		for (const Entry &entry : _lru) {
+			p_func(entry.key, entry.value, entry.last_used);
+		}
+	}
+
+	int64_t get_entries() const { return (int64_t)_lru.size(); }
+	int64_t get_bytes() const { return _bytes; }
+};
+
+// One cache of each kind. Not thread-safe on its own.
+class CacheSet {
+private:
+	TypedCache<Variant> _value_cache;
+	TypedCache<bool> _has_path_cache;
+	TypedCache<int> _get_size_cache;
+	TypedCache<PackedStringArray> _get_subpaths_cache;
+	TypedCache<Array> _get_keys_cache;
+	TypedCache<Variant> _aggregate_cache;
+	// Resolved path -> (line index, jump count, depth); shared by every query method.
+	TypedCache<Vector3i> _location_cache;
+
+public:
+	// Calls p_func with the cache selected by a single flag. Returns false for NONE or combined flags.
+	template <typename F>
+	bool visit(PreBuiltIndexJSON::CacheFlags flag, F &&p_func) {
+		switch (flag) {
+			case PreBuiltIndexJSON::VALUE_CACHE: p_func(_value_cache); return true;
+			case PreBuiltIndexJSON::HAS_PATH_CACHE: p_func(_has_path_cache); return true;
+			case PreBuiltIndexJSON::GET_SIZE_CACHE: p_func(_get_size_cache); return true;
+			case PreBuiltIndexJSON::GET_SUBPATHS_CACHE: p_func(_get_subpaths_cache); return true;
+			case PreBuiltIndexJSON::GET_KEYS_CACHE: p_func(_get_keys_cache); return true;
+			case PreBuiltIndexJSON::AGGREGATE_CACHE: p_func(_aggregate_cache); return true;
+			case PreBuiltIndexJSON::LOCATION_CACHE: p_func(_location_cache); return true;
+			default: return false;
+		}
+	}
+
+	// Every bit of a combined flag is visited in turn.
+	template <typename F>
+	void for_each(int flags, F &&p_func) {
+		for (int bit = 1; bit <= PreBuiltIndexJSON::ALL; bit <<= 1) {
+			if (flags & bit) visit(static_cast<PreBuiltIndexJSON::CacheFlags>(bit), p_func);
+		}
+	}
+
+	template <typename T>
+	TypedCache<T> *typed(PreBuiltIndexJSON::CacheFlags flag) {
+		if constexpr (std::is_same_v<T, Variant>) { if (flag == PreBuiltIndexJSON::VALUE_CACHE) return &_value_cache; else if (flag == PreBuiltIndexJSON::AGGREGATE_CACHE) return &_aggregate_cache; }
+		else if constexpr (std::is_same_v<T, bool>) { if (flag == PreBuiltIndexJSON::HAS_PATH_CACHE) return &_has_path_cache; }
+		else if constexpr (std::is_same_v<T, int>) { if (flag == PreBuiltIndexJSON::GET_SIZE_CACHE) return &_get_size_cache; }
+		else if constexpr (std::is_same_v<T, PackedStringArray>) { if (flag == PreBuiltIndexJSON::GET_SUBPATHS_CACHE) return &_get_subpaths_cache; }
+		else if constexpr (std::is_same_v<T, Array>) { if (flag == PreBuiltIndexJSON::GET_KEYS_CACHE) return &_get_keys_cache; }
+		else if constexpr (std::is_same_v<T, Vector3i>) { if (flag == PreBuiltIndexJSON::LOCATION_CACHE) return &_location_cache; }
+		return nullptr;
+	}
+};
+
+// The query caches, split into shards by key hash so that concurrent readers
+// only contend when they touch the same shard. Limits apply to each cache as a whole: the
+// totals are kept in atomics. A write over the limit first evicts within its own shard, down
+// to that shard's share of the limit; only when the total still exceeds the limit by the slack
+// are the entries used longest ago evicted across all shards.
+//
+// Recency is a clock that only writes advance. A hit stamps its entry with the clock's current
+// value, a plain load, so readers never write to memory another shard's readers use.
+class CacheManager {
+public:
+	static constexpr int SHARD_COUNT = 16;
+	static constexpr int CACHE_COUNT = 8; // Indexed by flag bit.
+	// A cache may exceed its limits by 1/8 before writes evict across shards.
+	static constexpr int LIMIT_SLACK_DIVISOR = 8;
+
+private:
+	struct Shard {
+		mutable std::mutex mutex;
+		CacheSet caches;
+	};
+
+	mutable Shard _shards[SHARD_COUNT];
+	// Configured limits and current totals per cache.
+	std::atomic<int64_t> _max_entries[CACHE_COUNT] = {};
+	std::atomic<int64_t> _max_bytes[CACHE_COUNT] = {};
+	mutable std::atomic<int64_t> _entries[CACHE_COUNT] = {};
+	mutable std::atomic<int64_t> _bytes[CACHE_COUNT] = {};
+	mutable std::atomic<uint64_t> _clock{ 0 };
+
+	Shard &_shard(const CacheKey &key) const { return _shards[(key.hash ^ (key.hash >> 32)) % SHARD_COUNT]; }
+	uint64_t _tick() const { return _clock.fetch_add(1, std::memory_order_relaxed) + 1; }
+	uint64_t _now() const { return _clock.load(std::memory_order_relaxed); }
+
+	static int _bit_index(int flag) {
+		int index = 0;
+		while (flag > 1) {
+			flag >>= 1;
+			index++;
+		}
+		return index;
+	}
+
+	// Runs p_func on one shard's cache and adds whatever it changed to the cache's totals.
+	// The shard must be locked.
+	template <typename C, typename F>
+	void _change(int p_index, C &p_cache, F &&p_func) const {
+		int64_t entries = p_cache.get_entries();
+		int64_t bytes = p_cache.get_bytes();
+		p_func(p_cache);
+		_entries[p_index].fetch_add(p_cache.get_entries() - entries, std::memory_order_relaxed);
+		_bytes[p_index].fetch_add(p_cache.get_bytes() - bytes, std::memory_order_relaxed);
+	}
+
+	// Whether the cache holds more than its limits plus 1/p_slack_divisor of them (no slack for 0).
+	bool _over_limit(int p_index, int p_slack_divisor = 0) const {
+		int64_t max_entries = _max_entries[p_index].load(std::memory_order_relaxed);
+		int64_t max_bytes = _max_bytes[p_index].load(std::memory_order_relaxed);
+		if (p_slack_divisor > 0) {
+			max_entries += max_entries / p_slack_divisor + 1;
+			max_bytes += max_bytes / p_slack_divisor + 1;
+		}
+		return (max_entries > 0 && _entries[p_index].load(std::memory_order_relaxed) > max_entries) ||
+				(max_bytes > 0 && _bytes[p_index].load(std::memory_order_relaxed) > max_bytes);
+	}
+
+	// Whether one shard's cache holds more than its even share of the limits.
+	template <typename C>
+	bool _over_share(int p_index, const C &p_cache) const {
+		int64_t max_entries = _max_entries[p_index].load(std::memory_order_relaxed);
+		int64_t max_bytes = _max_bytes[p_index].load(std::memory_order_relaxed);
+		return (max_entries > 0 && p_cache.get_entries() > (max_entries + SHARD_COUNT - 1) / SHARD_COUNT) ||
+				(max_bytes > 0 && p_cache.get_bytes() > (max_bytes + SHARD_COUNT - 1) / SHARD_COUNT);
+	}
+
+	// Evicts globally least recently used entries until the cache is within its limits. Shards are
+	// locked one at a time, so an entry touched meanwhile may survive in favour of a slightly newer one.
+	void _enforce_limits(PreBuiltIndexJSON::CacheFlags p_flag) const {
+		const int index = _bit_index(p_flag);
+		while (_over_limit(index)) {
+			int oldest_shard = -1;
+			uint64_t oldest_tick = 0;
+			for (int i = 0; i < SHARD_COUNT; ++i) {
+				std::lock_guard<std::mutex> lock(_shards[i].mutex);
+				_shards[i].caches.visit(p_flag, [&](const auto &cache) {
+					uint64_t tick = 0;
+					if (cache.get_oldest_tick(tick) && (oldest_shard < 0 || tick < oldest_tick)) {
+						oldest_shard = i;
+						oldest_tick = tick;
+					}
+				});
+			}
+			if (oldest_shard < 0) return;
+			std::lock_guard<std::mutex> lock(_shards[oldest_shard].mutex);
+			_shards[oldest_shard].caches.visit(p_flag, [&](auto &cache) {
+				_change(index, cache, [](auto &c) { c.evict_oldest(); });
+			});
+		}
+	}
+
+	// Calls p_func(cache, bit index) for every selected cache of every shard, one shard locked at a time.
+	template <typename F>
+	void _for_each_shard(int flags, F &&p_func) const {
+		for (Shard &shard : _shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (int bit = 1; bit <= PreBuiltIndexJSON::ALL; bit <<= 1) {
+				if (!(flags & bit)) continue;
+				const int index = _bit_index(bit);
+				shard.caches.visit(static_cast<PreBuiltIndexJSON::CacheFlags>(bit), [&](auto &cache) { p_func(cache, index); });
+			}
+		}
+	}
+
+public:
+	void clear_all() {
+		clear_by_flag(PreBuiltIndexJSON::ALL);
+	}
+	void clear_by_flag(int flags) {
+		_for_each_shard(flags, [this](auto &cache, int index) { _change(index, cache, [](auto &c) { c.clear(); }); });
+	}
+	bool has(PreBuiltIndexJSON::CacheFlags flag, const CacheKey &key) const {
+		Shard &shard = _shard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		bool result = false;
+		shard.caches.visit(flag, [&](const auto &cache) { result = cache.has(key); });
+		return result;
+	}
+	bool erase(PreBuiltIndexJSON::CacheFlags flag, const CacheKey &key) {
+		Shard &shard = _shard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		bool result = false;
+		shard.caches.visit(flag, [&](auto &cache) {
+			_change(_bit_index(flag), cache, [&](auto &c) { result = c.erase(key); });
+		});
+		return result;
+	}
+	template <typename T> void set(PreBuiltIndexJSON::CacheFlags flag, const CacheKey &key, const T &value) const {
+		const int index = _bit_index(flag);
+		const int64_t bytes = TypedCache<T>::entry_size(key, value);
+		const int64_t max_bytes = _max_bytes[index].load(std::memory_order_relaxed);
+		Shard &shard = _shard(key);
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			TypedCache<T> *cache = shard.caches.typed<T>(flag);
+			if (!cache) return;
+			if (max_bytes > 0 && bytes > max_bytes) {
+				// Larger than the whole budget: keeping it would flush every other entry.
+				_change(index, *cache, [&](auto &c) { c.erase(key); });
+				return;
+			}
+			_change(index, *cache, [&](auto &c) { c.set(key, value, bytes, _tick()); });
+			// The entry just set is the most recent one, so it is never the one evicted.
+			while (cache->get_entries() > 1 && _over_limit(index) && _over_share(index, *cache)) {
+				_change(index, *cache, [](auto &c) { c.evict_oldest(); });
+			}
+		}
+		if (_over_limit(index, LIMIT_SLACK_DIVISOR)) {
+			_enforce_limits(flag);
+		}
+	}
+	template <typename T> T get(PreBuiltIndexJSON::CacheFlags flag, const CacheKey &key) const {
+		Shard &shard = _shard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		TypedCache<T> *cache = shard.caches.typed<T>(flag);
+		return cache ? cache->get(key) : T();
+	}
+	template <typename T> bool try_get(PreBuiltIndexJSON::CacheFlags flag, const CacheKey &key, T &r_value) const {
+		Shard &shard = _shard(key);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		TypedCache<T> *cache = shard.caches.typed<T>(flag);
+		return cache && cache->try_get(key, r_value, _now());
+	}
+
+	void set_limits(int flags, int64_t p_max_entries, int64_t p_max_bytes) {
+		for (int bit = 1; bit <= PreBuiltIndexJSON::ALL; bit <<= 1) {
+			if (!(flags & bit)) continue;
+			_max_entries[_bit_index(bit)].store(p_max_entries > 0 ? p_max_entries : 0, std::memory_order_relaxed);
+			_max_bytes[_bit_index(bit)].store(p_max_bytes > 0 ? p_max_bytes : 0, std::memory_order_relaxed);
+			_enforce_limits(static_cast<PreBuiltIndexJSON::CacheFlags>(bit));
+		}
+	}
+	void reset_stats(int flags) {
+		_for_each_shard(flags, [](auto &cache, int) { cache.reset_stats(); });
+	}
+	// Takes over limits and counters, so a freshly loaded dataset keeps the caller's configuration.
+	// With p_entries the cached results are copied too; only do that when they are still valid.
+	void copy_settings(const CacheManager &p_other, bool p_entries = false) {
+		for (int i = 0; i < CACHE_COUNT; ++i) {
+			_max_entries[i].store(p_other._max_entries[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			_max_bytes[i].store(p_other._max_bytes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		if (p_entries) {
+			_clock.store(p_other._clock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		for (int i = 0; i < SHARD_COUNT; ++i) {
+			std::lock_guard<std::mutex> lock(_shards[i].mutex);
+			std::lock_guard<std::mutex> other_lock(p_other._shards[i].mutex);
+			for (int bit = 1; bit <= PreBuiltIndexJSON::ALL; bit <<= 1) {
+				PreBuiltIndexJSON::CacheFlags flag = static_cast<PreBuiltIndexJSON::CacheFlags>(bit);
+				_shards[i].caches.visit(flag, [&](auto &cache) {
+					p_other._shards[i].caches.visit(flag, [&](const auto &other) {
+						if constexpr (std::is_same_v<std::decay_t<decltype(cache)>, std::decay_t<decltype(other)>>) {
+							cache.copy_settings(other);
+							if (p_entries) _change(_bit_index(bit), cache, [&](auto &c) { c.copy_entries(other); });
+						}
+					});
+				});
+			}
+		}
+		if (p_entries) {
+			for (int bit = 1; bit <= PreBuiltIndexJSON::ALL; bit <<= 1) {
+				_enforce_limits(static_cast<PreBuiltIndexJSON::CacheFlags>(bit));
+			}
+		}
+	}
+	Dictionary get_stats(PreBuiltIndexJSON::CacheFlags flag) const {
+		Dictionary stats;
+		if (flag <= PreBuiltIndexJSON::NONE || (flag & (flag - 1)) != 0 || flag > PreBuiltIndexJSON::ALL) return stats;
+		TypedCache<Variant>::Stats totals;
+		_for_each_shard(flag, [&](const auto &cache, int) {
+			typename std::decay_t<decltype(cache)>::Stats shard_stats;
+			cache.add_stats(shard_stats);
+			totals.entries += shard_stats.entries;
+			totals.bytes += shard_stats.bytes;
+			totals.hits += shard_stats.hits;
+			totals.misses += shard_stats.misses;
+			totals.evictions += shard_stats.evictions;
+		});
+		stats["entries"] = totals.entries;
+		stats["bytes"] = totals.bytes;
+		stats["max_entries"] = _max_entries[_bit_index(flag)].load(std::memory_order_relaxed);
+		stats["max_bytes"] = _max_bytes[_bit_index(flag)].load(std::memory_order_relaxed);
+		stats["hits"] = (int64_t)totals.hits;
+		stats["misses"] = (int64_t)totals.misses;
+		stats["evictions"] = (int64_t)totals.evictions;
+		return stats;
+	}
+	// Paths held by the selected caches, most recently used first, without duplicates.
+	// AGGREGATE_CACHE is keyed by query descriptions rather than paths and is skipped.
+	PackedStringArray get_cached_paths(int flags) const {
+		std::vector<std::pair<uint64_t, String>> used;
+		_for_each_shard(flags & ~PreBuiltIndexJSON::AGGREGATE_CACHE, [&](const auto &cache, int) {
+			cache.for_each_entry([&](const CacheKey &key, const auto &value, uint64_t last_used) {
+				used.emplace_back(last_used, key.path);
+			});
+		});
+		std::stable_sort(used.begin(), used.end(), [](const std::pair<uint64_t, String> &a, const std::pair<uint64_t, String> &b) {
+			return a.first > b.first;
+		});
+		PackedStringArray paths;
+		Dictionary seen;
+		for (const std::pair<uint64_t, String> &entry : used) {
+			if (seen.has(entry.second)) continue;
+			seen[entry.second] = true;
+			paths.append(entry.second);
+		}
+		return paths;
+	}
+	int64_t get_total_bytes() const {
+		int64_t total = 0;
+		for (int i = 0; i < CACHE_COUNT; ++i) {
+			total += _bytes[i].load(std::memory_order_relaxed);
+		}
+		return total;
+	}
+};
@@ -0,0 +1,39 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+
+// Debug builds count, per thread, the places where query code reaches the heap, so tests can
+// check that the scalar lookup path (cached or not) stays allocation-free in steady state.
+// Allocating sites on that path are marked with PBIJSON_COUNT_ALLOCATION(); release builds
+// compile the marks away and report -1.
+#ifdef DEBUG_ENABLED
+namespace pbijson_debug {
+inline thread_local int64_t allocation_count = 0;
+}
+#define PBIJSON_COUNT_ALLOCATION() (++pbijson_debug::allocation_count)
+#else
+#define PBIJSON_COUNT_ALLOCATION() ((void)0)
+#endif
@@ -0,0 +1,530 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_decode.hpp"
+
+#include "pbijson_debug.hpp"
+
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_float64_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PBIJSON_DECODE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PBIJSON_DECODE_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace godot;
+
+namespace {
+
+// Largest digit count that always fits in a uint64_t.
+constexpr int MAX_MANTISSA_DIGITS = 19;
+// Mantissas and powers of ten up to these bounds are exact doubles, so one multiply or
+// divide gives the correctly rounded result, the same one String::to_float() produces.
+constexpr uint64_t MAX_EXACT_MANTISSA = 1ULL << 53;
+constexpr int MAX_EXACT_POWER = 22;
+constexpr double POWERS_OF_TEN[MAX_EXACT_POWER + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+enum NumberResult {
+	NUMBER_INVALID,
+	NUMBER_EXACT,
+	NUMBER_NEEDS_ROUNDING,
+};
+
+#ifdef PBIJSON_DECODE_SSE2
+int first_lane(int p_mask) {
+	return (p_mask & 1) ? 0 : (p_mask & 2) ? 1 : (p_mask & 4) ? 2 : 3;
+}
+#endif
+
+int find_quote_or_escape_scalar(const char32_t *p_chars, int p_from, int p_to) {
+	for (; p_from < p_to; ++p_from) {
+		if (p_chars[p_from] == U'"' || p_chars[p_from] == U'\\') return p_from;
+	}
+	return p_to;
+}
+
+int skip_digits_scalar(const char32_t *p_chars, int p_from, int p_to) {
+	for (; p_from < p_to; ++p_from) {
+		if (p_chars[p_from] < U'0' || p_chars[p_from] > U'9') return p_from;
+	}
+	return p_to;
+}
+
+// Value of eight ASCII digits, most significant first.
+uint32_t parse_eight_digits(const char32_t *p_chars) {
+#if defined(PBIJSON_DECODE_SSE2)
+	const __m128i zero = _mm_set1_epi32(U'0');
+	__m128i high = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)p_chars), zero);
+	__m128i low = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(p_chars + 4)), zero);
+	// d0*10+d1, d2*10+d3, ... then pairs of those times 100, leaving two four-digit halves.
+	__m128i pairs = _mm_madd_epi16(_mm_packs_epi32(high, low), _mm_set_epi16(1, 10, 1, 10, 1, 10, 1, 10));
+	__m128i quads = _mm_madd_epi16(_mm_packs_epi32(pairs, pairs), _mm_set_epi16(1, 100, 1, 100, 1, 100, 1, 100));
+	uint32_t upper = (uint32_t)_mm_cvtsi128_si32(quads);
+	uint32_t lower = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(quads, 4));
+	return upper * 10000 + lower;
+#elif defined(PBIJSON_DECODE_NEON)
+	static const uint32_t high_weights[4] = { 10000000, 1000000, 100000, 10000 };
+	static const uint32_t low_weights[4] = { 1000, 100, 10, 1 };
+	const uint32x4_t zero = vdupq_n_u32(U'0');
+	uint32x4_t high = vsubq_u32(vld1q_u32((const uint32_t *)p_chars), zero);
+	uint32x4_t low = vsubq_u32(vld1q_u32((const uint32_t *)(p_chars + 4)), zero);
+	return vaddvq_u32(vmlaq_u32(vmulq_u32(high, vld1q_u32(high_weights)), low, vld1q_u32(low_weights)));
+#else
+	uint32_t value = 0;
+	for (int i = 0; i < 8; ++i) {
+		value = value * 10 + (uint32_t)(p_chars[i] - U'0');
+	}
+	return value;
+#endif
+}
+
+// Appends the digits in [p_from, p_to) to the mantissa. Leading zeros are not significant;
+// once more than MAX_MANTISSA_DIGITS have been seen only the count is kept.
+void accumulate_digits(const char32_t *p_chars, int p_from, int p_to, uint64_t &r_mantissa, int &r_digits) {
+	while (p_from < p_to && r_mantissa == 0 && p_chars[p_from] == U'0') {
+		p_from++;
+	}
+	r_digits += p_to - p_from;
+	if (r_digits > MAX_MANTISSA_DIGITS) return;
+	for (; p_from + 8 <= p_to; p_from += 8) {
+		r_mantissa = r_mantissa * 100000000ULL + parse_eight_digits(p_chars + p_from);
+	}
+	for (; p_from < p_to; ++p_from) {
+		r_mantissa = r_mantissa * 10 + (uint64_t)(p_chars[p_from] - U'0');
+	}
+}
+
+// Parses -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)? spanning exactly [p_begin, p_end).
+NumberResult decode_number(const char32_t *p_chars, int p_begin, int p_end, double &r_value) {
+	int pos = p_begin;
+	bool negative = p_chars[pos] == U'-';
+	if (negative) pos++;
+	int integer_end = ValueDecoder::skip_digits(p_chars, pos, p_end);
+	if (integer_end == pos || (p_chars[pos] == U'0' && integer_end - pos > 1)) return NUMBER_INVALID;
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	accumulate_digits(p_chars, pos, integer_end, mantissa, digits);
+	pos = integer_end;
+	if (pos < p_end && p_chars[pos] == U'.') {
+		int fraction_end = ValueDecoder::skip_digits(p_chars, pos + 1, p_end);
+		if (fraction_end == pos + 1) return NUMBER_INVALID;
+		accumulate_digits(p_chars, pos + 1, fraction_end, mantissa, digits);
+		exponent -= fraction_end - (pos + 1);
+		pos = fraction_end;
+	}
+	if (pos < p_end && (p_chars[pos] == U'e' || p_chars[pos] == U'E')) {
+		pos++;
+		bool negative_exponent = false;
+		if (pos < p_end && (p_chars[pos] == U'+' || p_chars[pos] == U'-')) {
+			negative_exponent = p_chars[pos] == U'-';
+			pos++;
+		}
+		int exponent_end = ValueDecoder::skip_digits(p_chars, pos, p_end);
+		if (exponent_end == pos) return NUMBER_INVALID;
+		int value = 0;
+		for (; pos < exponent_end; ++pos) {
+			if (value < 100000) value = value * 10 + (int)(p_chars[pos] - U'0');
+		}
+		exponent += negative_exponent ? -value : value;
+	}
+	if (pos != p_end) return NUMBER_INVALID;
+
+	if (mantissa == 0 && digits == 0) {
+		r_value = negative ? -0.0 : 0.0;
+		return NUMBER_EXACT;
+	}
+	if (digits > MAX_MANTISSA_DIGITS || mantissa > MAX_EXACT_MANTISSA || exponent < -MAX_EXACT_POWER || exponent > MAX_EXACT_POWER) {
+		return NUMBER_NEEDS_ROUNDING;
+	}
+	double value = exponent < 0 ? (double)mantissa / POWERS_OF_TEN[-exponent] : (double)mantissa * POWERS_OF_TEN[exponent];
+	r_value = negative ? -value : value;
+	return NUMBER_EXACT;
+}
+
+bool read_hex4(const char32_t *p_chars, int p_pos, int p_end, uint32_t &r_code) {
+	if (p_pos + 4 > p_end) return false;
+	r_code = 0;
+	for (int i = p_pos; i < p_pos + 4; ++i) {
+		char32_t c = p_chars[i];
+		uint32_t digit;
+		if (c >= U'0' && c <= U'9') digit = c - U'0';
+		else if (c >= U'a' && c <= U'f') digit = c - U'a' + 10;
+		else if (c >= U'A' && c <= U'F') digit = c - U'A' + 10;
+		else return false;
+		r_code = (r_code << 4) | digit;
+	}
+	return true;
+}
+
+void trim(const char32_t *p_chars, int &r_begin, int &r_end) {
+	while (r_begin < r_end && p_chars[r_begin] <= U' ') {
+		r_begin++;
+	}
+	while (r_end > r_begin && p_chars[r_end - 1] <= U' ') {
+		r_end--;
+	}
+}
+
+bool matches_literal(const char32_t *p_chars, int p_begin, int p_end, const char *p_literal) {
+	int pos = p_begin;
+	for (; *p_literal; ++p_literal, ++pos) {
+		if (pos >= p_end || p_chars[pos] != (char32_t)*p_literal) return false;
+	}
+	return pos == p_end;
+}
+
+} // namespace
+
+bool ValueDecoder::PackedReader::begin(const String &p_text, int p_begin, int p_end) {
+	_chars = p_text.ptr();
+	trim(_chars, p_begin, p_end);
+	if (p_end - p_begin < 4 || _chars[p_begin] != PACKED_MARKER || _chars[p_begin + 2] != U'[' || _chars[p_end - 1] != U']') {
+		return false;
+	}
+	_type = _chars[p_begin + 1];
+	if (_type != PACKED_INT && _type != PACKED_FLOAT && _type != PACKED_STRING) return false;
+	_pos = p_begin + 3;
+	_end = p_end - 1;
+	return true;
+}
+
+bool ValueDecoder::PackedReader::next(int &r_begin, int &r_end) {
+	if (_pos >= _end) return false;
+	r_begin = _pos;
+	if (_type == PACKED_STRING) {
+		if (_chars[_pos] != U'"') return false;
+		int stop = find_quote_or_escape(_chars, _pos + 1, _end);
+		while (stop < _end && _chars[stop] == U'\\') {
+			stop = find_quote_or_escape(_chars, stop + 2, _end);
+		}
+		if (stop >= _end) return false;
+		r_end = stop + 1;
+	} else {
+		r_end = _pos;
+		while (r_end < _end && _chars[r_end] != U',') {
+			r_end++;
+		}
+	}
+	if (r_end < _end && _chars[r_end] != U',') return false;
+	_pos = r_end + 1;
+	return r_end > r_begin;
+}
+
+int ValueDecoder::find_quote_or_escape(const char32_t *p_chars, int p_from, int p_to) {
+#if defined(PBIJSON_DECODE_SSE2)
+	const __m128i quote = _mm_set1_epi32(U'"');
+	const __m128i escape = _mm_set1_epi32(U'\\');
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *)(p_chars + p_from));
+		__m128i hits = _mm_or_si128(_mm_cmpeq_epi32(chunk, quote), _mm_cmpeq_epi32(chunk, escape));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(hits));
+		if (mask != 0) return p_from + first_lane(mask);
+	}
+#elif defined(PBIJSON_DECODE_NEON)
+	const uint32x4_t quote = vdupq_n_u32(U'"');
+	const uint32x4_t escape = vdupq_n_u32(U'\\');
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		uint32x4_t chunk = vld1q_u32((const uint32_t *)(p_chars + p_from));
+		if (vmaxvq_u32(vorrq_u32(vceqq_u32(chunk, quote), vceqq_u32(chunk, escape))) != 0) break;
+	}
+#endif
+	return find_quote_or_escape_scalar(p_chars, p_from, p_to);
+}
+
+int ValueDecoder::skip_digits(const char32_t *p_chars, int p_from, int p_to) {
+#if defined(PBIJSON_DECODE_SSE2)
+	const __m128i zero = _mm_set1_epi32(U'0');
+	const __m128i nine = _mm_set1_epi32(9);
+	const __m128i none = _mm_setzero_si128();
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		__m128i offset = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(p_chars + p_from)), zero);
+		__m128i other = _mm_or_si128(_mm_cmplt_epi32(offset, none), _mm_cmpgt_epi32(offset, nine));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(other));
+		if (mask != 0) return p_from + first_lane(mask);
+	}
+#elif defined(PBIJSON_DECODE_NEON)
+	const uint32x4_t zero = vdupq_n_u32(U'0');
+	const uint32x4_t nine = vdupq_n_u32(9);
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		uint32x4_t offset = vsubq_u32(vld1q_u32((const uint32_t *)(p_chars + p_from)), zero);
+		if (vmaxvq_u32(vcgtq_u32(offset, nine)) != 0) break;
+	}
+#endif
+	return skip_digits_scalar(p_chars, p_from, p_to);
+}
+
+#ifdef PBIJSON_BENCHMARK
+bool ValueDecoder::check_kernels(const char32_t *p_chars, int p_from, int p_to) {
+	if (find_quote_or_escape(p_chars, p_from, p_to) != find_quote_or_escape_scalar(p_chars, p_from, p_to)) return false;
+	if (skip_digits(p_chars, p_from, p_to) != skip_digits_scalar(p_chars, p_from, p_to)) return false;
+	// The eight-digit parser is only ever given digits.
+	if (p_to - p_from < 8 || skip_digits_scalar(p_chars, p_from, p_from + 8) != p_from + 8) return true;
+	uint32_t value = 0;
+	for (int i = p_from; i < p_from + 8; ++i) {
+		value = value * 10 + (uint32_t)(p_chars[i] - U'0');
+	}
+	return parse_eight_digits(p_chars + p_from) == value;
+}
+#endif
+
+bool ValueDecoder::decode_string(const String &p_text, int p_begin, int p_end, String &r_value) {
+	const char32_t *chars = p_text.ptr();
+	trim(chars, p_begin, p_end);
+	if (p_end - p_begin < 2 || chars[p_begin] != U'"' || chars[p_end - 1] != U'"') return false;
+	int from = p_begin + 1;
+	int to = p_end - 1;
+	int stop = find_quote_or_escape(chars, from, to);
+	PBIJSON_COUNT_ALLOCATION();
+	if (stop == to) {
+		r_value = p_text.substr(from, to - from);
+		return true;
+	}
+
+	// Escapes only ever shrink the text, so the raw length bounds the decoded one.
+	String decoded;
+	decoded.resize(to - from + 1);
+	char32_t *out = decoded.ptrw();
+	int length = 0;
+	while (true) {
+		for (int i = from; i < stop; ++i) {
+			out[length++] = chars[i];
+		}
+		if (stop == to) break;
+		if (chars[stop] == U'"' || stop + 1 >= to) return false;
+		char32_t c = chars[stop + 1];
+		int next = stop + 2;
+		switch (c) {
+			case U'"':
+			case U'\\':
+			case U'/': break;
+			case U'b': c = U'\b'; break;
+			case U'f': c = U'\f'; break;
+			case U'n': c = U'\n'; break;
+			case U'r': c = U'\r'; break;
+			case U't': c = U'\t'; break;
+			case U'v': c = U'\v'; break;
+			case U'u': {
+				uint32_t code;
+				if (!read_hex4(chars, next, to, code)) return false;
+				next += 4;
+				if (code >= 0xDC00 && code <= 0xDFFF) return false;
+				if (code >= 0xD800 && code <= 0xDBFF) {
+					uint32_t low;
+					if (next + 6 > to || chars[next] != U'\\' || chars[next + 1] != U'u' || !read_hex4(chars, next + 2, to, low) || low < 0xDC00 || low > 0xDFFF) {
+						return false;
+					}
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					next += 6;
+				}
+				c = (char32_t)code;
+			} break;
+			default:
+				return false;
+		}
+		out[length++] = c;
+		from = next;
+		stop = find_quote_or_escape(chars, from, to);
+	}
+	out[length] = 0;
+	decoded.resize(length + 1);
+	r_value = decoded;
+	return true;
+}
+
+bool ValueDecoder::decode_value(const String &p_text, int p_begin, int p_end, Variant &r_value) {
+	const char32_t *chars = p_text.ptr();
+	trim(chars, p_begin, p_end);
+	if (p_begin >= p_end) return false;
+	switch (chars[p_begin]) {
+		case U'"': {
+			String value;
+			if (!decode_string(p_text, p_begin, p_end, value)) return false;
+			r_value = value;
+			return true;
+		}
+		case U't':
+			if (!matches_literal(chars, p_begin, p_end, "true")) return false;
+			r_value = true;
+			return true;
+		case U'f':
+			if (!matches_literal(chars, p_begin, p_end, "false")) return false;
+			r_value = false;
+			return true;
+		case U'n':
+			if (!matches_literal(chars, p_begin, p_end, "null")) return false;
+			r_value = Variant();
+			return true;
+		case U'[':
+			if (!matches_literal(chars, p_begin, p_end, "[]")) return false;
+			PBIJSON_COUNT_ALLOCATION();
+			r_value = Array();
+			return true;
+		case U'{':
+			if (!matches_literal(chars, p_begin, p_end, "{}")) return false;
+			PBIJSON_COUNT_ALLOCATION();
+			r_value = Dictionary();
+			return true;
+		case PACKED_MARKER:
+			return decode_packed(p_text, p_begin, p_end, r_value);
+		default: {
+			double value = 0.0;
+			if (!decode_float(p_text, p_begin, p_end, value)) return false;
+			r_value = value;
+			return true;
+		}
+	}
+}
+
+bool ValueDecoder::decode_int(const String &p_text, int p_begin, int p_end, int64_t &r_value) {
+	const char32_t *chars = p_text.ptr();
+	trim(chars, p_begin, p_end);
+	int pos = p_begin < p_end && chars[p_begin] == U'-' ? p_begin + 1 : p_begin;
+	int digits_end = skip_digits(chars, pos, p_end);
+	// Plain integers of up to 19 digits fit a uint64_t, so those in int64_t's range skip the
+	// double entirely and keep every digit.
+	if (digits_end == p_end && digits_end > pos && digits_end - pos <= MAX_MANTISSA_DIGITS && (chars[pos] != U'0' || digits_end - pos == 1)) {
+		uint64_t magnitude = 0;
+		int digits = 0;
+		accumulate_digits(chars, pos, digits_end, magnitude, digits);
+		const bool negative = pos > p_begin;
+		if (magnitude <= (uint64_t)INT64_MAX || (negative && magnitude == (uint64_t)INT64_MAX + 1)) {
+			r_value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+			return true;
+		}
+	}
+	double value = 0.0;
+	if (!decode_float(p_text, p_begin, p_end, value) || !(value > -9223372036854775808.0 && value < 9223372036854775808.0)) {
+		return false;
+	}
+	r_value = (int64_t)value;
+	return true;
+}
+
+bool ValueDecoder::decode_float(const String &p_text, int p_begin, int p_end, double &r_value) {
+	const char32_t *chars = p_text.ptr();
+	trim(chars, p_begin, p_end);
+	if (p_begin >= p_end) return false;
+	switch (decode_number(chars, p_begin, p_end, r_value)) {
+		case NUMBER_EXACT:
+			return true;
+		case NUMBER_NEEDS_ROUNDING:
+			PBIJSON_COUNT_ALLOCATION();
+			r_value = p_text.substr(p_begin, p_end - p_begin).to_float();
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool ValueDecoder::decode_bool(const String &p_text, int p_begin, int p_end, bool &r_value) {
+	const char32_t *chars = p_text.ptr();
+	trim(chars, p_begin, p_end);
+	if (matches_literal(chars, p_begin, p_end, "true")) {
+		r_value = true;
+		return true;
+	}
+	if (matches_literal(chars, p_begin, p_end, "false")) {
+		r_value = false;
+		return true;
+	}
+	return false;
+}
+
+char32_t ValueDecoder::get_packed_type(const String &p_text, int p_begin, int p_end) {
+	const char32_t *chars = p_text.ptr();
+	trim(chars, p_begin, p_end);
+	if (p_end - p_begin < 4 || chars[p_begin] != PACKED_MARKER) return 0;
+	char32_t type = chars[p_begin + 1];
+	return type == PACKED_INT || type == PACKED_FLOAT || type == PACKED_STRING ? type : 0;
+}
+
+int64_t ValueDecoder::get_packed_size(const String &p_text, int p_begin, int p_end) {
+	PackedReader reader;
+	if (!reader.begin(p_text, p_begin, p_end)) return -1;
+	int64_t size = 0;
+	int element_begin;
+	int element_end;
+	while (reader.next(element_begin, element_end)) {
+		size++;
+	}
+	return size;
+}
+
+bool ValueDecoder::find_packed_element(const String &p_text, int p_begin, int p_end, int64_t p_index, int &r_begin, int &r_end) {
+	PackedReader reader;
+	if (p_index < 0 || !reader.begin(p_text, p_begin, p_end)) return false;
+	for (int64_t i = 0; reader.next(r_begin, r_end); ++i) {
+		if (i == p_index) return true;
+	}
+	return false;
+}
+
+bool ValueDecoder::decode_packed(const String &p_text, int p_begin, int p_end, Variant &r_value) {
+	int64_t size = get_packed_size(p_text, p_begin, p_end);
+	if (size < 0) return false;
+	PackedReader reader;
+	reader.begin(p_text, p_begin, p_end);
+	int element_begin;
+	int element_end;
+	PBIJSON_COUNT_ALLOCATION();
+	if (reader.get_type() == PACKED_INT) {
+		PackedInt64Array values;
+		values.resize(size);
+		int64_t *values_ptr = values.ptrw();
+		for (int64_t i = 0; i < size && reader.next(element_begin, element_end); ++i) {
+			if (!decode_int(p_text, element_begin, element_end, values_ptr[i])) return false;
+		}
+		r_value = values;
+	} else if (reader.get_type() == PACKED_FLOAT) {
+		PackedFloat64Array values;
+		values.resize(size);
+		double *values_ptr = values.ptrw();
+		for (int64_t i = 0; i < size && reader.next(element_begin, element_end); ++i) {
+			if (!decode_float(p_text, element_begin, element_end, values_ptr[i])) return false;
+		}
+		r_value = values;
+	} else {
+		PackedStringArray values;
+		values.resize(size);
+		String *values_ptr = values.ptrw();
+		for (int64_t i = 0; i < size && reader.next(element_begin, element_end); ++i) {
+			if (!decode_string(p_text, element_begin, element_end, values_ptr[i])) return false;
+		}
+		r_value = values;
+	}
+	return true;
+}
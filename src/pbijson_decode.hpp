@@ -0,0 +1,92 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/variant.hpp>
+
+using namespace godot;
+
+// Decodes the subset of JSON the builder writes for keys and scalar values (quoted strings,
+// numbers, true/false/null and empty containers) straight from a line, without a JSON parser.
+// Lines are UTF-32, so the quote/escape and digit scans run four code points per 128-bit vector:
+// SSE2 on x86-64, NEON on ARM64, chosen at compile time, with a scalar loop everywhere else.
+// Anything outside the subset makes the decoder return false so the caller can fall back to JSON.
+class ValueDecoder {
+public:
+	// Decodes the quoted string spanning [p_begin, p_end), quotes included.
+	static bool decode_string(const String &p_text, int p_begin, int p_end, String &r_value);
+	// Decodes the value spanning [p_begin, p_end). Numbers decode to float, as JSON::parse_string() does.
+	static bool decode_value(const String &p_text, int p_begin, int p_end, Variant &r_value);
+
+	// Typed decoders for the same ranges; each fails on a value of another type.
+	// decode_int() reads integers exactly and truncates other numbers toward zero, like int().
+	static bool decode_int(const String &p_text, int p_begin, int p_end, int64_t &r_value);
+	static bool decode_float(const String &p_text, int p_begin, int p_end, double &r_value);
+	static bool decode_bool(const String &p_text, int p_begin, int p_end, bool &r_value);
+
+	// Homogeneous arrays written by the `packed_arrays` build option are one value on their
+	// parent's line: PACKED_MARKER, a type letter and a JSON array, e.g. `#I[1,2]`, `#F[0.5,2.0]`
+	// or `#S["a","b"]` for int64, float64 and string elements.
+	static constexpr char32_t PACKED_MARKER = U'#';
+	static constexpr char32_t PACKED_INT = U'I';
+	static constexpr char32_t PACKED_FLOAT = U'F';
+	static constexpr char32_t PACKED_STRING = U'S';
+
+	// Walks the elements of a packed array. Positions index the whole text, so the ranges it
+	// yields can be handed straight to the scalar decoders.
+	class PackedReader {
+		const char32_t *_chars = nullptr;
+		char32_t _type = 0;
+		int _pos = 0;
+		int _end = 0;
+
+	public:
+		// Positions the reader on the first element; fails unless the range is `#T[...]`.
+		bool begin(const String &p_text, int p_begin, int p_end);
+		// Yields the next element's range; false once the array is exhausted or malformed.
+		bool next(int &r_begin, int &r_end);
+		char32_t get_type() const { return _type; }
+	};
+
+	// Type letter of the packed array spanning [p_begin, p_end), or 0 if the range is not one.
+	static char32_t get_packed_type(const String &p_text, int p_begin, int p_end);
+	// Decodes a packed array into a PackedInt64Array, PackedFloat64Array or PackedStringArray.
+	static bool decode_packed(const String &p_text, int p_begin, int p_end, Variant &r_value);
+	// Text range of element p_index of a packed array, found by walking the elements before it.
+	static bool find_packed_element(const String &p_text, int p_begin, int p_end, int64_t p_index, int &r_begin, int &r_end);
+	// Number of elements of a packed array, or -1 if the range is not one.
+	static int64_t get_packed_size(const String &p_text, int p_begin, int p_end);
+
+	// Index of the first `"` or `\` in [p_from, p_to), or p_to.
+	static int find_quote_or_escape(const char32_t *p_chars, int p_from, int p_to);
+	// Index of the first code point in [p_from, p_to) that is not an ASCII digit, or p_to.
+	static int skip_digits(const char32_t *p_chars, int p_from, int p_to);
+
+#ifdef PBIJSON_BENCHMARK
+	// Returns false if the vector code of find_quote_or_escape(), skip_digits() or the
+	// eight-digit parser gives another result than the scalar loops on [p_from, p_to).
+	static bool check_kernels(const char32_t *p_chars, int p_from, int p_to);
+#endif
+};
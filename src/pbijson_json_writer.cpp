@@ -0,0 +1,108 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_json_writer.hpp"
+
+#include <cstring>
+
+using namespace godot;
+
+JsonWriter::JsonWriter(bool p_utf8) :
+		_utf8(p_utf8) {
+}
+
+JsonWriter::JsonWriter(const Ref<FileAccess> &p_file) :
+		_utf8(true), _file(p_file) {
+	_bytes.reserve(FLUSH_BYTES + 4);
+}
+
+void JsonWriter::write(const char32_t *p_chars, int p_length) {
+	if (!_utf8) {
+		_text.append(p_chars, p_length);
+		return;
+	}
+	for (int i = 0; i < p_length; ++i) {
+		char32_t c = p_chars[i];
+		if (c < 0x80) {
+			_bytes.push_back((uint8_t)c);
+		} else if (c < 0x800) {
+			_bytes.push_back((uint8_t)(0xC0 | (c >> 6)));
+			_bytes.push_back((uint8_t)(0x80 | (c & 0x3F)));
+		} else if (c < 0x10000) {
+			_bytes.push_back((uint8_t)(0xE0 | (c >> 12)));
+			_bytes.push_back((uint8_t)(0x80 | ((c >> 6) & 0x3F)));
+			_bytes.push_back((uint8_t)(0x80 | (c & 0x3F)));
+		} else {
+			_bytes.push_back((uint8_t)(0xF0 | (c >> 18)));
+			_bytes.push_back((uint8_t)(0x80 | ((c >> 12) & 0x3F)));
+			_bytes.push_back((uint8_t)(0x80 | ((c >> 6) & 0x3F)));
+			_bytes.push_back((uint8_t)(0x80 | (c & 0x3F)));
+		}
+		if (_file.is_valid() && _bytes.size() >= FLUSH_BYTES) {
+			_flush();
+		}
+	}
+}
+
+void JsonWriter::write(char32_t p_char) {
+	write(&p_char, 1);
+}
+
+void JsonWriter::write_repeated(const String &p_text, int p_count) {
+	for (int i = 0; i < p_count; ++i) {
+		write(p_text.ptr(), p_text.length());
+	}
+}
+
+void JsonWriter::_flush() {
+	if (_bytes.empty()) return;
+	PackedByteArray chunk;
+	chunk.resize(_bytes.size());
+	memcpy(chunk.ptrw(), _bytes.data(), _bytes.size());
+	_file->store_buffer(chunk);
+	_bytes.clear();
+}
+
+String JsonWriter::get_string() const {
+	String text;
+	text.resize(_text.size() + 1);
+	char32_t *chars = text.ptrw();
+	memcpy(chars, _text.data(), _text.size() * sizeof(char32_t));
+	chars[_text.size()] = 0;
+	return text;
+}
+
+PackedByteArray JsonWriter::get_bytes() const {
+	PackedByteArray bytes;
+	bytes.resize(_bytes.size());
+	if (!_bytes.empty()) {
+		memcpy(bytes.ptrw(), _bytes.data(), _bytes.size());
+	}
+	return bytes;
+}
+
+Error JsonWriter::finish() {
+	if (_file.is_null()) return OK;
+	_flush();
+	return _file->get_error();
+}
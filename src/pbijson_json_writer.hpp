@@ -0,0 +1,66 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace godot;
+
+// Collects the JSON text that PreBuiltIndexJSON::get_json() and its byte and file variants write.
+// Text arrives as slices of the UTF-32 lines. It is kept as UTF-32 for a String result, or
+// encoded to UTF-8 as it arrives for the other two; a file writer hands its bytes to the file
+// every FLUSH_BYTES, so the whole document is never held in memory.
+class JsonWriter {
+public:
+	static constexpr size_t FLUSH_BYTES = 64 * 1024;
+
+private:
+	bool _utf8 = false;
+	std::u32string _text;
+	std::vector<uint8_t> _bytes;
+	Ref<FileAccess> _file;
+
+	void _flush();
+
+public:
+	// A writer producing UTF-32 text for get_string(), or UTF-8 bytes for get_bytes().
+	explicit JsonWriter(bool p_utf8);
+	// A writer streaming UTF-8 bytes into p_file.
+	explicit JsonWriter(const Ref<FileAccess> &p_file);
+
+	void write(const char32_t *p_chars, int p_length);
+	void write(char32_t p_char);
+	void write_repeated(const String &p_text, int p_count);
+
+	String get_string() const;
+	PackedByteArray get_bytes() const;
+	// Hands any bytes still buffered to the file and reports the file's error state.
+	Error finish();
+};
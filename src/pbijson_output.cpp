@@ -41,6 +41,8 @@ void PreBuiltIndexJSONOutput::_bind_methods() {
 	ClassDB::bind_integer_constant(get_class_static(), "ErrorType", "ERR_LINE_IN_JUMP_MARKER", ERR_LINE_IN_JUMP_MARKER);
 	ClassDB::bind_integer_constant(get_class_static(), "ErrorType", "ERR_FILE_HEADER", ERR_FILE_HEADER);
 	ClassDB::bind_integer_constant(get_class_static(), "ErrorType", "ERR_FORMAT", ERR_FORMAT);
+	ClassDB::bind_integer_constant(get_class_static(), "ErrorType", "ERR_QUERY_PARSE", ERR_QUERY_PARSE);
+	ClassDB::bind_integer_constant(get_class_static(), "ErrorType", "ERR_CANCELLED", ERR_CANCELLED);
     
 
     ClassDB::bind_method(D_METHOD("get_message"), &PreBuiltIndexJSONOutput::get_message);
@@ -70,6 +72,13 @@ PreBuiltIndexJSONOutput::PreBuiltIndexJSONOutput(Error p_error) {
 	_godot_error = p_error;
 }
 
+PreBuiltIndexJSONOutput::PreBuiltIndexJSONOutput(Error p_error, const String &p_message) {
+	clear();
+	_error_type = ERR_BUILT_IN_METHOD;
+	_godot_error = p_error;
+	_message = p_message;
+}
+
 PreBuiltIndexJSONOutput::PreBuiltIndexJSONOutput(ErrorType p_error_type, const String &p_message) {
 	clear();
 	_error_type = p_error_type;
@@ -123,7 +132,8 @@ int PreBuiltIndexJSONOutput::get_line() const {
 
 bool PreBuiltIndexJSONOutput::has_message() const {
 	switch (_error_type) {
-		case ERR_BUILT_IN_METHOD:return false;
+		// Engine errors only carry a message when one code stands for several causes, such as ERR_BUSY.
+		case ERR_BUILT_IN_METHOD:return !_message.is_empty();
 		case ERR_JSON_PARSE:return true;
 		case ERR_UNSUPPORTED_TYPE:return true;
         case ERR_FILE_NOT_OPEN:return false;
@@ -134,6 +144,8 @@ bool PreBuiltIndexJSONOutput::has_message() const {
 		case ERR_FILE_HEADER:return true;
 		case ERR_HASH:return true;
 		case ERR_FORMAT:return true;
+		case ERR_QUERY_PARSE:return true;
+		case ERR_CANCELLED:return true;
 		default:
 			return false;
 	}
@@ -152,6 +164,8 @@ bool PreBuiltIndexJSONOutput::has_line() const {
 		case ERR_FILE_HEADER:return false;
 		case ERR_HASH:return false;
 		case ERR_FORMAT:return false;
+		case ERR_QUERY_PARSE:return false;
+		case ERR_CANCELLED:return false;
 		default:
 			return false;
 	}
@@ -185,8 +199,9 @@ void PreBuiltIndexJSONOutput::set_line(int p_line) {
 void PreBuiltIndexJSONOutput::clear() {
 	_error_type = OK;
 	_godot_error = Error::OK;
-	_data = "";
-	_message = "";
+	// Called at the start of every query; skip the String work when there is nothing to reset.
+	if (!_data.is_empty()) _data = String();
+	if (!_message.is_empty()) _message = String();
 	_line = -1;
 }
 
@@ -46,6 +46,8 @@ public:
 		ERR_FILE_HEADER,
 		ERR_HASH,
 		ERR_FORMAT,
+		ERR_QUERY_PARSE,
+		ERR_CANCELLED,
 	};
 
 protected:
@@ -65,6 +67,7 @@ public:
 	// Constructors
 	PreBuiltIndexJSONOutput(ErrorType p_error_type);
 	PreBuiltIndexJSONOutput(Error p_error);
+	PreBuiltIndexJSONOutput(Error p_error, const String &p_message);
 	PreBuiltIndexJSONOutput(ErrorType p_error_type, const String &p_message);
 	PreBuiltIndexJSONOutput(ErrorType p_error_type, const String &p_message, int p_line);
 	PreBuiltIndexJSONOutput(const String &p_data);
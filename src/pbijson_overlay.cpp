@@ -0,0 +1,220 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_overlay.hpp"
+
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+
+using namespace godot;
+
+// Packed arrays cannot be changed in place through a Variant, so the edits turn them into Arrays.
+static Array _to_array(const Variant &p_value) {
+	switch (p_value.get_type()) {
+		case Variant::PACKED_INT64_ARRAY: return Array(PackedInt64Array(p_value));
+		case Variant::PACKED_FLOAT64_ARRAY: return Array(PackedFloat64Array(p_value));
+		case Variant::PACKED_STRING_ARRAY: return Array(PackedStringArray(p_value));
+		default: return p_value;
+	}
+}
+
+static bool _to_index(const String &p_part, int64_t p_size, int64_t &r_index) {
+	if (!p_part.is_valid_int()) return false;
+	r_index = p_part.to_int();
+	return r_index >= 0 && r_index < p_size;
+}
+
+bool WriteOverlay::_has_prefix(const PackedStringArray &p_parts, const PackedStringArray &p_prefix, int p_prefix_length) {
+	if (p_prefix_length > p_parts.size()) return false;
+	for (int i = 0; i < p_prefix_length; ++i) {
+		if (p_parts[i] != p_prefix[i]) return false;
+	}
+	return true;
+}
+
+bool WriteOverlay::touches(const PackedStringArray &p_parts) const {
+	for (const Edit &edit : edits) {
+		if (_has_prefix(p_parts, edit.parts, edit.scope) || _has_prefix(edit.parts, p_parts, p_parts.size())) return true;
+	}
+	return false;
+}
+
+int WriteOverlay::get_root_length(const PackedStringArray &p_parts) const {
+	int length = -1;
+	for (const Edit &edit : edits) {
+		if ((length < 0 || edit.scope < length) && _has_prefix(p_parts, edit.parts, edit.scope)) {
+			length = edit.scope;
+		}
+	}
+	return length;
+}
+
+int WriteOverlay::find_last_replacement(const PackedStringArray &p_root) const {
+	for (int i = (int)edits.size() - 1; i >= 0; --i) {
+		if (_has_prefix(p_root, edits[i].parts, edits[i].parts.size())) return i;
+	}
+	return -1;
+}
+
+void WriteOverlay::apply(const PackedStringArray &p_root, int p_first, Variant &r_value, bool &r_found) const {
+	int root_length = p_root.size();
+	for (int i = p_first; i < (int)edits.size(); ++i) {
+		const Edit &edit = edits[i];
+		int length = edit.parts.size();
+		if (length <= root_length && _has_prefix(p_root, edit.parts, length)) {
+			// The edit replaces the root or one of its ancestors.
+			if (edit.erase) {
+				r_value = Variant();
+				r_found = false;
+			} else {
+				r_value = edit.value.duplicate(true);
+				r_found = navigate(r_value, p_root, length);
+			}
+		} else if (r_found && _has_prefix(edit.parts, p_root, root_length)) {
+			_apply_inside(r_value, edit, root_length);
+		}
+	}
+	if (!r_found) r_value = Variant();
+}
+
+void WriteOverlay::_apply_inside(Variant &r_value, const Edit &p_edit, int p_from) {
+	if (!is_container(r_value)) return;
+	if (r_value.get_type() != Variant::DICTIONARY) r_value = _to_array(r_value);
+	Variant container = r_value;
+	int last = p_edit.parts.size() - 1;
+	for (int i = p_from; i < last; ++i) {
+		Variant child;
+		if (!get_child(container, p_edit.parts[i], child) || !is_container(child)) return;
+		if (child.get_type() != Variant::DICTIONARY && child.get_type() != Variant::ARRAY) {
+			child = _to_array(child);
+			if (container.get_type() == Variant::DICTIONARY) {
+				Dictionary parent = container;
+				parent[p_edit.parts[i]] = child;
+			} else {
+				Array parent = container;
+				parent[p_edit.parts[i].to_int()] = child;
+			}
+		}
+		container = child;
+	}
+	const String &key = p_edit.parts[last];
+	if (container.get_type() == Variant::DICTIONARY) {
+		Dictionary dict = container;
+		if (p_edit.erase) {
+			dict.erase(key);
+		} else {
+			dict[key] = p_edit.value.duplicate(true);
+		}
+		return;
+	}
+	Array array = container;
+	int64_t index = 0;
+	if (p_edit.insert) {
+		if (_to_index(key, array.size(), index)) array.insert(index, p_edit.value.duplicate(true));
+	} else if (p_edit.erase) {
+		if (_to_index(key, array.size(), index)) array.remove_at(index);
+	} else if (key.is_valid_int() && key.to_int() == array.size()) {
+		array.append(p_edit.value.duplicate(true));
+	} else if (_to_index(key, array.size(), index)) {
+		array[index] = p_edit.value.duplicate(true);
+	}
+}
+
+bool WriteOverlay::navigate(Variant &r_value, const PackedStringArray &p_parts, int p_from) {
+	for (int i = p_from; i < p_parts.size(); ++i) {
+		Variant child;
+		if (!get_child(r_value, p_parts[i], child)) {
+			r_value = Variant();
+			return false;
+		}
+		r_value = child;
+	}
+	return true;
+}
+
+bool WriteOverlay::get_child(const Variant &p_container, const String &p_part, Variant &r_child) {
+	if (p_container.get_type() == Variant::DICTIONARY) {
+		Dictionary dict = p_container;
+		if (!dict.has(p_part)) return false;
+		r_child = dict[p_part];
+		return true;
+	}
+	if (!is_array(p_container)) return false;
+	Array array = _to_array(p_container);
+	int64_t index = 0;
+	if (!_to_index(p_part, array.size(), index)) return false;
+	r_child = array[index];
+	return true;
+}
+
+Variant WriteOverlay::to_array(const Variant &p_value) {
+	if (p_value.get_type() == Variant::DICTIONARY || p_value.get_type() == Variant::ARRAY || !is_array(p_value)) return p_value;
+	return _to_array(p_value);
+}
+
+bool WriteOverlay::is_container(const Variant &p_value) {
+	return p_value.get_type() == Variant::DICTIONARY || is_array(p_value);
+}
+
+bool WriteOverlay::is_array(const Variant &p_value) {
+	switch (p_value.get_type()) {
+		case Variant::ARRAY:
+		case Variant::PACKED_INT64_ARRAY:
+		case Variant::PACKED_FLOAT64_ARRAY:
+		case Variant::PACKED_STRING_ARRAY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool WriteOverlay::is_json_value(const Variant &p_value) {
+	switch (p_value.get_type()) {
+		case Variant::NIL:
+		case Variant::BOOL:
+		case Variant::INT:
+		case Variant::FLOAT:
+		case Variant::STRING:
+		case Variant::PACKED_INT64_ARRAY:
+		case Variant::PACKED_FLOAT64_ARRAY:
+		case Variant::PACKED_STRING_ARRAY:
+			return true;
+		case Variant::ARRAY: {
+			Array array = p_value;
+			for (int64_t i = 0; i < array.size(); ++i) {
+				if (!is_json_value(array[i])) return false;
+			}
+			return true;
+		}
+		case Variant::DICTIONARY: {
+			Dictionary dict = p_value;
+			Array keys = dict.keys();
+			for (int64_t i = 0; i < keys.size(); ++i) {
+				if (keys[i].get_type() != Variant::STRING || !is_json_value(dict[keys[i]])) return false;
+			}
+			return true;
+		}
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,82 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/variant/packed_string_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/variant.hpp>
+
+#include <vector>
+
+using namespace godot;
+
+// The changes made with set_value() and erase_path() since the data was loaded, in the order
+// they were made. Queries on a path the overlay touches replay the edits over the value the
+// loaded lines hold; every other path is answered from the lines alone. A published overlay is
+// never modified: each change copies it, which stays cheap for the few dozen edits of a patch.
+class WriteOverlay {
+public:
+	struct Edit {
+		PackedStringArray parts;
+		// Number of leading parts naming the value the edit replaces as a whole. That is the
+		// edited path itself, or its parent for an array element, since adding or removing an
+		// element renumbers its siblings.
+		int scope = 0;
+		Variant value;
+		bool erase = false;
+		// For an array element: the value goes in before the element at the index, which
+		// moves up, instead of replacing it.
+		bool insert = false;
+	};
+
+	std::vector<Edit> edits;
+
+	bool is_empty() const { return edits.empty(); }
+	// Whether some edit changes the value at p_parts or a value inside it.
+	bool touches(const PackedStringArray &p_parts) const;
+	// Length of the shortest edit scope that contains p_parts, or -1 if no edit replaces an
+	// ancestor of p_parts (or p_parts itself) as a whole.
+	int get_root_length(const PackedStringArray &p_parts) const;
+	// Index of the last edit that replaces or erases p_root or one of its ancestors, or -1.
+	// The value at p_root before that edit does not matter.
+	int find_last_replacement(const PackedStringArray &p_root) const;
+	// Replays the edits from p_first on over r_value, the value at p_root, which r_found tells exists.
+	void apply(const PackedStringArray &p_root, int p_first, Variant &r_value, bool &r_found) const;
+
+	// Replaces r_value with its descendant at p_parts[p_from...].
+	static bool navigate(Variant &r_value, const PackedStringArray &p_parts, int p_from);
+	static bool get_child(const Variant &p_container, const String &p_part, Variant &r_child);
+	static bool is_container(const Variant &p_value);
+	static bool is_array(const Variant &p_value);
+	// p_value as an Array if it is a packed array, so its elements can be read one by one
+	// without converting it again for each of them; any other value is returned as it is.
+	static Variant to_array(const Variant &p_value);
+	// Whether p_value can be stored: null, bools, numbers, strings, the packed arrays get_value()
+	// returns, and Arrays and Dictionaries with String keys made of those.
+	static bool is_json_value(const Variant &p_value);
+
+private:
+	static bool _has_prefix(const PackedStringArray &p_parts, const PackedStringArray &p_prefix, int p_prefix_length);
+	static void _apply_inside(Variant &r_value, const Edit &p_edit, int p_from);
+};
@@ -0,0 +1,119 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_path.hpp"
+#include "pbijson_debug.hpp"
+#include "pbijson_path_hash.hpp"
+
+using namespace godot;
+
+PathView::PathView(const String &p_path) :
+		_path(p_path) {
+	const char32_t *chars = _path.ptr();
+	int length = _path.length();
+	while (length > 0 && chars[length - 1] == U'/') {
+		length--;
+		_canonical = false;
+	}
+	if (length == 0) return;
+	int begin = 0;
+	for (int i = 0; i < length; ++i) {
+		if (chars[i] == U'\\') {
+			if (i + 1 >= length || (chars[i + 1] != U'\\' && chars[i + 1] != U'/')) {
+				_canonical = false;
+			}
+			i++;
+		} else if (chars[i] == U'/') {
+			_add(begin, i);
+			begin = i + 1;
+		}
+	}
+	_add(begin, length);
+}
+
+void PathView::_add(int p_begin, int p_end) {
+	if (_count < INLINE_PARTS) {
+		_ranges[_count][0] = p_begin;
+		_ranges[_count][1] = p_end;
+	} else {
+		PBIJSON_COUNT_ALLOCATION();
+		_overflow.emplace_back(p_begin, p_end);
+	}
+	_count++;
+}
+
+bool PathView::to_index(int p_part, int64_t &r_index) const {
+	PartReader reader = read(p_part);
+	char32_t c;
+	if (!reader.next(c)) return false;
+	bool negative = false;
+	int length = _end(p_part) - _begin(p_part);
+	if (length > 1 && (c == U'+' || c == U'-')) {
+		negative = c == U'-';
+		reader.next(c);
+	}
+	int64_t value = 0;
+	do {
+		if (c < U'0' || c > U'9' || value > (INT64_MAX - 9) / 10) return false;
+		value = value * 10 + (c - U'0');
+	} while (reader.next(c));
+	r_index = negative ? -value : value;
+	return true;
+}
+
+uint64_t PathView::hash(uint64_t p_hash, int p_part) const {
+	PartReader reader = read(p_part);
+	char32_t c;
+	while (reader.next(c)) {
+		p_hash = PathHashIndex::hash_char(p_hash, c);
+	}
+	return PathHashIndex::hash_end_part(p_hash);
+}
+
+String PathView::get_part(int p_part) const {
+	PBIJSON_COUNT_ALLOCATION();
+	String part;
+	PartReader reader = read(p_part);
+	char32_t c;
+	while (reader.next(c)) {
+		part += c;
+	}
+	return part;
+}
+
+String PathView::get_prefix(int p_count) const {
+	PBIJSON_COUNT_ALLOCATION();
+	if (p_count <= 0) return String();
+	if (_canonical) return _path.substr(0, _end(p_count - 1));
+	String prefix;
+	for (int i = 0; i < p_count; ++i) {
+		if (i > 0) prefix += U'/';
+		PartReader reader = read(i);
+		char32_t c;
+		while (reader.next(c)) {
+			if (c == U'\\' || c == U'/') prefix += U'\\';
+			prefix += c;
+		}
+	}
+	return prefix;
+}
@@ -0,0 +1,92 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/variant/string.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace godot;
+
+// A `/`-separated key path split into parts without copying them. Parts are ranges of the
+// path's characters that still contain their `\` escapes; paths up to INLINE_PARTS deep are
+// split without touching the heap. Splitting follows the same rules as the original parser:
+// trailing `/` are ignored, `\` escapes the next character and a final lone `\` is literal.
+class PathView {
+public:
+	static constexpr int INLINE_PARTS = 32;
+
+	// Reads the unescaped code points of one part.
+	class PartReader {
+		const char32_t *_chars;
+		int _pos;
+		int _end;
+
+	public:
+		PartReader(const char32_t *p_chars, int p_begin, int p_end) :
+				_chars(p_chars), _pos(p_begin), _end(p_end) {}
+
+		bool next(char32_t &r_char) {
+			if (_pos >= _end) return false;
+			if (_chars[_pos] == U'\\' && _pos + 1 < _end) _pos++;
+			r_char = _chars[_pos++];
+			return true;
+		}
+	};
+
+private:
+	String _path;
+	int _count = 0;
+	int _ranges[INLINE_PARTS][2];
+	std::vector<std::pair<int, int>> _overflow;
+	bool _canonical = true;
+
+	void _add(int p_begin, int p_end);
+	int _begin(int p_part) const { return p_part < INLINE_PARTS ? _ranges[p_part][0] : _overflow[p_part - INLINE_PARTS].first; }
+	int _end(int p_part) const { return p_part < INLINE_PARTS ? _ranges[p_part][1] : _overflow[p_part - INLINE_PARTS].second; }
+
+public:
+	explicit PathView(const String &p_path);
+
+	int size() const { return _count; }
+	// True for the paths that name the root container, such as "" and "/".
+	bool is_root() const { return _count == 0 || (_count == 1 && _begin(0) == _end(0)); }
+	// True when the path is spelled the way paths are reported (parts joined with `/`, only `\`
+	// and `/` escaped), so it can be used as a cache key as is.
+	bool is_canonical() const { return _canonical; }
+	const String &get_path() const { return _path; }
+
+	PartReader read(int p_part) const { return PartReader(_path.ptr(), _begin(p_part), _end(p_part)); }
+	// Parses the part like String::is_valid_int() and String::to_int(). A number too large for
+	// int64_t is no index at all, since no array could hold that many elements.
+	bool to_index(int p_part, int64_t &r_index) const;
+	// PathHashIndex::hash_part() over the unescaped part.
+	uint64_t hash(uint64_t p_hash, int p_part) const;
+
+	// These build new Strings and are meant for error messages and cache misses.
+	String get_part(int p_part) const;
+	String get_prefix(int p_count) const;
+};
@@ -0,0 +1,140 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_path_hash.hpp"
+
+#include <algorithm>
+
+using namespace godot;
+
+uint64_t PathHashIndex::hash_part(uint64_t p_hash, const String &p_part) {
+	const char32_t *chars = p_part.ptr();
+	int64_t length = p_part.length();
+	for (int64_t i = 0; i < length; ++i) {
+		p_hash = hash_char(p_hash, chars[i]);
+	}
+	return hash_end_part(p_hash);
+}
+
+uint64_t PathHashIndex::hash_parts(const PackedStringArray &p_parts) {
+	uint64_t hash = HASH_BEGIN;
+	for (int i = 0; i < p_parts.size(); ++i) {
+		hash = hash_part(hash, p_parts[i]);
+	}
+	return hash_finish(hash);
+}
+
+PackedStringArray PathHashIndex::build_section(std::vector<Entry> &p_entries, int64_t p_max_bytes) {
+	std::sort(p_entries.begin(), p_entries.end(), [](const Entry &a, const Entry &b) {
+		return a.hash < b.hash;
+	});
+	// Two paths sharing a hash cannot be told apart by the table, so neither is stored.
+	std::vector<Entry> unique;
+	unique.reserve(p_entries.size());
+	for (size_t i = 0; i < p_entries.size(); ) {
+		size_t j = i + 1;
+		while (j < p_entries.size() && p_entries[j].hash == p_entries[i].hash) {
+			j++;
+		}
+		if (j == i + 1) {
+			unique.push_back(p_entries[i]);
+		}
+		i = j;
+	}
+	if (p_max_bytes > 0 && (int64_t)unique.size() * BYTES_PER_ENTRY > p_max_bytes) {
+		std::stable_sort(unique.begin(), unique.end(), [](const Entry &a, const Entry &b) {
+			return a.depth != b.depth ? a.depth < b.depth : a.line < b.line;
+		});
+		unique.resize(p_max_bytes / BYTES_PER_ENTRY);
+	}
+	std::sort(unique.begin(), unique.end(), [](const Entry &a, const Entry &b) {
+		return a.line < b.line;
+	});
+	PackedStringArray lines;
+	lines.resize(unique.size());
+	String *lines_ptr = lines.ptrw();
+	for (size_t i = 0; i < unique.size(); ++i) {
+		lines_ptr[i] = String::num_uint64(unique[i].hash, 16) + ">" + String::num_int64(unique[i].line);
+	}
+	return lines;
+}
+
+bool PathHashIndex::load(const PackedStringArray &p_lines, int p_start, int p_count) {
+	clear();
+	uint64_t capacity = 16;
+	while (capacity < (uint64_t)p_count * 2) {
+		capacity <<= 1;
+	}
+	_keys.assign(capacity, 0);
+	_lines.assign(capacity, -1);
+	_mask = capacity - 1;
+	for (int i = p_start; i < p_start + p_count; ++i) {
+		const String &entry = p_lines[i];
+		const char32_t *chars = entry.ptr();
+		int64_t length = entry.length();
+		uint64_t hash = 0;
+		int64_t pos = 0;
+		for (; pos < length && chars[pos] != U'>'; ++pos) {
+			char32_t c = chars[pos];
+			uint64_t digit;
+			if (c >= U'0' && c <= U'9') digit = c - U'0';
+			else if (c >= U'a' && c <= U'f') digit = c - U'a' + 10;
+			else if (c >= U'A' && c <= U'F') digit = c - U'A' + 10;
+			else {
+				clear();
+				return false;
+			}
+			hash = (hash << 4) | digit;
+		}
+		if (pos >= length || hash == 0) {
+			clear();
+			return false;
+		}
+		int line = entry.substr(pos + 1).to_int();
+		uint64_t slot = hash & _mask;
+		while (_keys[slot] != 0) {
+			slot = (slot + 1) & _mask;
+		}
+		_keys[slot] = hash;
+		_lines[slot] = line;
+		_count++;
+	}
+	return true;
+}
+
+void PathHashIndex::clear() {
+	_keys.clear();
+	_lines.clear();
+	_mask = 0;
+	_count = 0;
+}
+
+int PathHashIndex::find(uint64_t p_hash) const {
+	if (_count == 0) return -1;
+	uint64_t slot = p_hash & _mask;
+	while (_keys[slot] != 0) {
+		if (_keys[slot] == p_hash) return _lines[slot];
+		slot = (slot + 1) & _mask;
+	}
+	return -1;
+}
@@ -0,0 +1,75 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace godot;
+
+// Open-addressing table from a 64-bit hash of an unescaped path to its line index,
+// loaded from the optional PHX section of a .pbijson file.
+class PathHashIndex {
+public:
+	struct Entry {
+		uint64_t hash = 0;
+		int line = -1;
+		int depth = 0;
+	};
+
+	// Approximate resident size of one entry at the table's load factor (<= 0.5).
+	static constexpr int BYTES_PER_ENTRY = 24;
+
+private:
+	std::vector<uint64_t> _keys; // 0 marks an empty slot.
+	std::vector<int> _lines;
+	uint64_t _mask = 0;
+	int _count = 0;
+
+public:
+	static constexpr uint64_t HASH_BEGIN = 14695981039346656037ULL;
+	static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+	static constexpr uint32_t PART_SEPARATOR = 0x110000;
+
+	// FNV-1a over the code points of one path part, followed by a separator that
+	// cannot appear in a String, so ["a/b"] and ["a", "b"] hash differently.
+	static uint64_t hash_part(uint64_t p_hash, const String &p_part);
+	// The same hash fed one code point at a time, for callers that have no String for the part.
+	static uint64_t hash_char(uint64_t p_hash, char32_t p_char) { return (p_hash ^ (uint64_t)p_char) * FNV_PRIME; }
+	static uint64_t hash_end_part(uint64_t p_hash) { return (p_hash ^ PART_SEPARATOR) * FNV_PRIME; }
+	static uint64_t hash_finish(uint64_t p_hash) { return p_hash == 0 ? 1 : p_hash; }
+	static uint64_t hash_parts(const PackedStringArray &p_parts);
+
+	// Removes colliding hashes and, when p_max_bytes > 0, keeps the shallowest paths that fit.
+	// Returns the section payload lines (`hash>line`).
+	static PackedStringArray build_section(std::vector<Entry> &p_entries, int64_t p_max_bytes);
+
+	bool load(const PackedStringArray &p_lines, int p_start, int p_count);
+	void clear();
+	int find(uint64_t p_hash) const;
+	int size() const { return _count; }
+};
@@ -0,0 +1,486 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_query.hpp"
+#include "pbijson_decode.hpp"
+
+#include <godot_cpp/classes/json.hpp>
+
+using namespace godot;
+
+static bool _is_field_char(char32_t c) {
+	switch (c) {
+		case U' ': case U'\t': case U'\r': case U'\n':
+		case U'(': case U')': case U'=': case U'!': case U'<': case U'>':
+		case U'"': case U'\'': case U'`': case U'[': case U']': case U',':
+			return false;
+		default:
+			return true;
+	}
+}
+
+int QueryPredicate::_add_node(NodeType p_type) {
+	Node node;
+	node.type = p_type;
+	_nodes.push_back(node);
+	return (int)_nodes.size() - 1;
+}
+
+int QueryPredicate::_add_field(const String &p_field_path) {
+	for (int i = 0; i < (int)_fields.size(); ++i) {
+		if (_fields[i] == p_field_path) return i;
+	}
+	_fields.push_back(p_field_path);
+	return (int)_fields.size() - 1;
+}
+
+bool QueryPredicate::_op_from_string(const String &p_op, CompareOp &r_op) {
+	if (p_op == "==" || p_op == "=") r_op = OP_EQ;
+	else if (p_op == "!=") r_op = OP_NE;
+	else if (p_op == "<") r_op = OP_LT;
+	else if (p_op == "<=") r_op = OP_LE;
+	else if (p_op == ">") r_op = OP_GT;
+	else if (p_op == ">=") r_op = OP_GE;
+	else if (p_op == "in") r_op = OP_IN;
+	else return false;
+	return true;
+}
+
+bool QueryPredicate::compile(const Variant &p_predicate) {
+	_nodes.clear();
+	_fields.clear();
+	_error = "";
+	_root = -1;
+	Variant::Type type = p_predicate.get_type();
+	if (type == Variant::STRING || type == Variant::STRING_NAME) {
+		_expr = p_predicate;
+		_pos = 0;
+		_root = _parse_or();
+		if (_root >= 0) {
+			_skip_spaces();
+			if (_pos < _expr.length()) {
+				_error = "Unexpected input at position " + String::num_int64(_pos) + ": '" + _expr.substr(_pos) + "'.";
+				_root = -1;
+			}
+		}
+		_expr = "";
+	} else if (type == Variant::DICTIONARY || type == Variant::ARRAY) {
+		_root = _compile_variant(p_predicate);
+	} else {
+		_error = "Predicate must be an expression String or a Dictionary.";
+	}
+	return _root >= 0;
+}
+
+int QueryPredicate::_compile_variant(const Variant &p_predicate) {
+	if (p_predicate.get_type() == Variant::ARRAY) {
+		// An array of predicates is an implicit AND.
+		Array list = p_predicate;
+		int node = _add_node(NODE_AND);
+		for (int i = 0; i < list.size(); ++i) {
+			int child = _compile_variant(list[i]);
+			if (child < 0) return -1;
+			_nodes[node].children.push_back(child);
+		}
+		return node;
+	}
+	if (p_predicate.get_type() != Variant::DICTIONARY) {
+		_error = "Expected a Dictionary or an Array in structured predicate.";
+		return -1;
+	}
+	Dictionary dict = p_predicate;
+	if (dict.has("op")) {
+		return _compile_compare(dict.get("field", ""), dict["op"], dict.get("value", Variant()));
+	}
+	if (dict.size() == 1 && (dict.has("and") || dict.has("or"))) {
+		bool is_and = dict.has("and");
+		Variant list = is_and ? dict["and"] : dict["or"];
+		if (list.get_type() != Variant::ARRAY) {
+			_error = String(is_and ? "'and'" : "'or'") + " expects an Array of predicates.";
+			return -1;
+		}
+		Array children = list;
+		int node = _add_node(is_and ? NODE_AND : NODE_OR);
+		for (int i = 0; i < children.size(); ++i) {
+			int child = _compile_variant(children[i]);
+			if (child < 0) return -1;
+			_nodes[node].children.push_back(child);
+		}
+		return node;
+	}
+	if (dict.size() == 1 && dict.has("not")) {
+		int child = _compile_variant(dict["not"]);
+		if (child < 0) return -1;
+		int node = _add_node(NODE_NOT);
+		_nodes[node].children.push_back(child);
+		return node;
+	}
+	// Shorthand form: {"class": "mage", "level": {">": 50}}
+	Array keys = dict.keys();
+	int node = _add_node(NODE_AND);
+	for (int i = 0; i < keys.size(); ++i) {
+		int child = _compile_field_condition(keys[i], dict[keys[i]]);
+		if (child < 0) return -1;
+		_nodes[node].children.push_back(child);
+	}
+	return node;
+}
+
+int QueryPredicate::_compile_field_condition(const String &p_field_path, const Variant &p_condition) {
+	if (p_condition.get_type() != Variant::DICTIONARY) {
+		return _compile_compare(p_field_path, "==", p_condition);
+	}
+	Dictionary conditions = p_condition;
+	Array ops = conditions.keys();
+	int node = _add_node(NODE_AND);
+	for (int i = 0; i < ops.size(); ++i) {
+		int child = _compile_compare(p_field_path, ops[i], conditions[ops[i]]);
+		if (child < 0) return -1;
+		_nodes[node].children.push_back(child);
+	}
+	return node;
+}
+
+int QueryPredicate::_compile_compare(const String &p_field_path, const String &p_op, const Variant &p_value) {
+	if (p_op == "exists") {
+		int node = _add_node(NODE_EXISTS);
+		_nodes[node].field = _add_field(p_field_path);
+		if (p_value.get_type() == Variant::BOOL && !bool(p_value)) {
+			int not_node = _add_node(NODE_NOT);
+			_nodes[not_node].children.push_back(node);
+			return not_node;
+		}
+		return node;
+	}
+	CompareOp op;
+	if (!_op_from_string(p_op, op)) {
+		_error = "Unknown comparison operator '" + p_op + "'.";
+		return -1;
+	}
+	if (op == OP_IN && p_value.get_type() != Variant::ARRAY) {
+		_error = "Operator 'in' expects an Array value.";
+		return -1;
+	}
+	int node = _add_node(NODE_COMPARE);
+	_nodes[node].op = op;
+	_nodes[node].field = _add_field(p_field_path);
+	_nodes[node].literal = p_value;
+	return node;
+}
+
+void QueryPredicate::_skip_spaces() {
+	while (_pos < _expr.length()) {
+		char32_t c = _expr[_pos];
+		if (c != U' ' && c != U'\t' && c != U'\r' && c != U'\n') break;
+		_pos++;
+	}
+}
+
+bool QueryPredicate::_match_keyword(const char *p_keyword) {
+	_skip_spaces();
+	int len = 0;
+	while (p_keyword[len] != 0) {
+		if (_pos + len >= _expr.length() || _expr[_pos + len] != (char32_t)p_keyword[len]) return false;
+		len++;
+	}
+	if (_pos + len < _expr.length() && _is_field_char(_expr[_pos + len])) return false;
+	_pos += len;
+	return true;
+}
+
+bool QueryPredicate::_match_symbol(const char *p_symbol) {
+	_skip_spaces();
+	int len = 0;
+	while (p_symbol[len] != 0) {
+		if (_pos + len >= _expr.length() || _expr[_pos + len] != (char32_t)p_symbol[len]) return false;
+		len++;
+	}
+	_pos += len;
+	return true;
+}
+
+int QueryPredicate::_parse_or() {
+	int left = _parse_and();
+	if (left < 0) return -1;
+	int node = -1;
+	while (_match_keyword("or") || _match_symbol("||")) {
+		int right = _parse_and();
+		if (right < 0) return -1;
+		if (node < 0) {
+			node = _add_node(NODE_OR);
+			_nodes[node].children.push_back(left);
+		}
+		_nodes[node].children.push_back(right);
+	}
+	return node < 0 ? left : node;
+}
+
+int QueryPredicate::_parse_and() {
+	int left = _parse_unary();
+	if (left < 0) return -1;
+	int node = -1;
+	while (_match_keyword("and") || _match_symbol("&&")) {
+		int right = _parse_unary();
+		if (right < 0) return -1;
+		if (node < 0) {
+			node = _add_node(NODE_AND);
+			_nodes[node].children.push_back(left);
+		}
+		_nodes[node].children.push_back(right);
+	}
+	return node < 0 ? left : node;
+}
+
+int QueryPredicate::_parse_unary() {
+	_skip_spaces();
+	bool is_not = _match_keyword("not");
+	if (!is_not && _pos + 1 < _expr.length() && _expr[_pos] == U'!' && _expr[_pos + 1] != U'=') {
+		_pos++;
+		is_not = true;
+	}
+	if (is_not) {
+		int child = _parse_unary();
+		if (child < 0) return -1;
+		int node = _add_node(NODE_NOT);
+		_nodes[node].children.push_back(child);
+		return node;
+	}
+	if (_match_symbol("(")) {
+		int inner = _parse_or();
+		if (inner < 0) return -1;
+		if (!_match_symbol(")")) {
+			_error = "Expected ')' at position " + String::num_int64(_pos) + ".";
+			return -1;
+		}
+		return inner;
+	}
+	return _parse_comparison();
+}
+
+int QueryPredicate::_parse_comparison() {
+	String field;
+	if (!_parse_field(field)) return -1;
+	static const char *symbols[] = { "==", "!=", "<=", ">=", "<", ">", "=" };
+	String op;
+	for (const char *symbol : symbols) {
+		if (_match_symbol(symbol)) {
+			op = symbol;
+			break;
+		}
+	}
+	if (op.is_empty() && _match_keyword("in")) {
+		op = "in";
+	}
+	if (op.is_empty()) {
+		// A bare field tests for existence.
+		return _compile_compare(field, "exists", true);
+	}
+	Variant literal;
+	if (!_parse_literal(literal)) return -1;
+	return _compile_compare(field, op, literal);
+}
+
+bool QueryPredicate::_parse_field(String &r_field) {
+	_skip_spaces();
+	if (_pos < _expr.length() && _expr[_pos] == U'`') {
+		int end = _expr.find("`", _pos + 1);
+		if (end == -1) {
+			_error = "Unterminated quoted field at position " + String::num_int64(_pos) + ".";
+			return false;
+		}
+		r_field = _expr.substr(_pos + 1, end - _pos - 1);
+		_pos = end + 1;
+		return true;
+	}
+	int start = _pos;
+	while (_pos < _expr.length()) {
+		char32_t c = _expr[_pos];
+		if (c == U'\\' && _pos + 1 < _expr.length()) {
+			_pos += 2;
+			continue;
+		}
+		if (!_is_field_char(c)) break;
+		_pos++;
+	}
+	if (_pos == start) {
+		_error = "Expected a field path at position " + String::num_int64(start) + ".";
+		return false;
+	}
+	r_field = _expr.substr(start, _pos - start);
+	if (r_field == ".") {
+		r_field = "";
+	}
+	return true;
+}
+
+bool QueryPredicate::_parse_literal(Variant &r_literal) {
+	_skip_spaces();
+	if (_pos >= _expr.length()) {
+		_error = "Expected a value at the end of the expression.";
+		return false;
+	}
+	char32_t c = _expr[_pos];
+	if (c == U'"' || c == U'\'') {
+		char32_t quote = c;
+		String value;
+		_pos++;
+		while (_pos < _expr.length() && _expr[_pos] != quote) {
+			char32_t ch = _expr[_pos];
+			if (ch == U'\\' && _pos + 1 < _expr.length()) {
+				_pos++;
+				ch = _expr[_pos];
+				if (ch == U'n') ch = U'\n';
+				else if (ch == U't') ch = U'\t';
+				else if (ch == U'r') ch = U'\r';
+			}
+			value += ch;
+			_pos++;
+		}
+		if (_pos >= _expr.length()) {
+			_error = "Unterminated string literal.";
+			return false;
+		}
+		_pos++;
+		r_literal = value;
+		return true;
+	}
+	if (c == U'[') {
+		Array list;
+		_pos++;
+		if (!_match_symbol("]")) {
+			while (true) {
+				Variant element;
+				if (!_parse_literal(element)) return false;
+				list.append(element);
+				if (_match_symbol(",")) continue;
+				if (_match_symbol("]")) break;
+				_error = "Expected ',' or ']' at position " + String::num_int64(_pos) + ".";
+				return false;
+			}
+		}
+		r_literal = list;
+		return true;
+	}
+	if (_match_keyword("true")) {
+		r_literal = true;
+		return true;
+	}
+	if (_match_keyword("false")) {
+		r_literal = false;
+		return true;
+	}
+	if (_match_keyword("null")) {
+		r_literal = Variant();
+		return true;
+	}
+	int start = _pos;
+	while (_pos < _expr.length() && _is_field_char(_expr[_pos])) {
+		_pos++;
+	}
+	String number = _expr.substr(start, _pos - start);
+	if (number.is_valid_int()) {
+		r_literal = number.to_int();
+		return true;
+	}
+	if (number.is_valid_float()) {
+		r_literal = number.to_float();
+		return true;
+	}
+	_error = "Invalid value '" + number + "' at position " + String::num_int64(start) + ".";
+	return false;
+}
+
+String QueryPredicate::decode_raw_string(const String &p_raw) {
+	String value;
+	if (ValueDecoder::decode_string(p_raw, 0, p_raw.length(), value)) {
+		return value;
+	}
+	return JSON::parse_string(p_raw);
+}
+
+bool QueryPredicate::_compare_raw(const String &p_raw, bool p_is_container, CompareOp p_op, const Variant &p_literal) {
+	if (p_op == OP_IN) {
+		Array list = p_literal;
+		for (int i = 0; i < list.size(); ++i) {
+			if (_compare_raw(p_raw, p_is_container, OP_EQ, list[i])) return true;
+		}
+		return false;
+	}
+	if (p_is_container || p_raw.is_empty()) {
+		return p_op == OP_NE;
+	}
+	char32_t first = p_raw[0];
+	int cmp = 0;
+	bool comparable = false;
+	switch (p_literal.get_type()) {
+		case Variant::NIL:
+			if (p_op != OP_EQ && p_op != OP_NE) return false;
+			return (p_raw == "null") == (p_op == OP_EQ);
+		case Variant::BOOL: {
+			if (p_op != OP_EQ && p_op != OP_NE) return false;
+			bool literal = p_literal;
+			bool equal = p_raw == (literal ? "true" : "false");
+			return equal == (p_op == OP_EQ);
+		}
+		case Variant::INT:
+		case Variant::FLOAT: {
+			if (first == U'-' || (first >= U'0' && first <= U'9')) {
+				// Integers are compared exactly: as doubles, neighbours above 2^53 would be equal.
+				int64_t integer = 0;
+				bool integral = ValueDecoder::skip_digits(p_raw.ptr(), first == U'-' ? 1 : 0, p_raw.length()) == p_raw.length();
+				if (p_literal.get_type() == Variant::INT && integral && ValueDecoder::decode_int(p_raw, 0, p_raw.length(), integer)) {
+					int64_t literal = p_literal;
+					cmp = integer < literal ? -1 : (integer > literal ? 1 : 0);
+				} else {
+					double value = p_raw.to_float();
+					double literal = p_literal;
+					cmp = value < literal ? -1 : (value > literal ? 1 : 0);
+				}
+				comparable = true;
+			}
+		} break;
+		case Variant::STRING:
+		case Variant::STRING_NAME: {
+			if (first == U'"') {
+				String value = decode_raw_string(p_raw);
+				String literal = p_literal;
+				cmp = value < literal ? -1 : (value == literal ? 0 : 1);
+				comparable = true;
+			}
+		} break;
+		default:
+			break;
+	}
+	if (!comparable) {
+		return p_op == OP_NE;
+	}
+	switch (p_op) {
+		case OP_EQ: return cmp == 0;
+		case OP_NE: return cmp != 0;
+		case OP_LT: return cmp < 0;
+		case OP_LE: return cmp <= 0;
+		case OP_GT: return cmp > 0;
+		case OP_GE: return cmp >= 0;
+		default: return false;
+	}
+}
@@ -0,0 +1,145 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/variant/variant.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/array.hpp>
+
+#include <vector>
+
+using namespace godot;
+
+// A compiled filter used by PreBuiltIndexJSON::query().
+// Comparisons are evaluated against the raw JSON text stored after the value
+// separator of a flat-index line, so a record never has to be rebuilt into a Dictionary.
+class QueryPredicate {
+public:
+	enum NodeType {
+		NODE_AND,
+		NODE_OR,
+		NODE_NOT,
+		NODE_COMPARE,
+		NODE_EXISTS,
+	};
+
+	enum CompareOp {
+		OP_EQ,
+		OP_NE,
+		OP_LT,
+		OP_LE,
+		OP_GT,
+		OP_GE,
+		OP_IN,
+	};
+
+private:
+	struct Node {
+		NodeType type = NODE_AND;
+		CompareOp op = OP_EQ;
+		int field = -1;
+		Variant literal;
+		std::vector<int> children;
+	};
+
+	std::vector<Node> _nodes;
+	std::vector<String> _fields;
+	int _root = -1;
+	String _error;
+
+	int _add_node(NodeType p_type);
+	int _add_field(const String &p_field_path);
+	int _compile_variant(const Variant &p_predicate);
+	int _compile_field_condition(const String &p_field_path, const Variant &p_condition);
+	int _compile_compare(const String &p_field_path, const String &p_op, const Variant &p_value);
+
+	// Expression parsing.
+	String _expr;
+	int _pos = 0;
+	void _skip_spaces();
+	bool _match_keyword(const char *p_keyword);
+	bool _match_symbol(const char *p_symbol);
+	int _parse_or();
+	int _parse_and();
+	int _parse_unary();
+	int _parse_comparison();
+	bool _parse_field(String &r_field);
+	bool _parse_literal(Variant &r_literal);
+
+	static bool _op_from_string(const String &p_op, CompareOp &r_op);
+	static bool _compare_raw(const String &p_raw, bool p_is_container, CompareOp p_op, const Variant &p_literal);
+
+	template <typename R>
+	bool _evaluate_node(int p_node, R &p_resolver) const {
+		const Node &node = _nodes[p_node];
+		switch (node.type) {
+			case NODE_AND:
+				for (int child : node.children) {
+					if (!_evaluate_node(child, p_resolver)) return false;
+				}
+				return true;
+			case NODE_OR:
+				for (int child : node.children) {
+					if (_evaluate_node(child, p_resolver)) return true;
+				}
+				return false;
+			case NODE_NOT:
+				return !_evaluate_node(node.children[0], p_resolver);
+			case NODE_EXISTS: {
+				String raw;
+				bool is_container = false;
+				return p_resolver.resolve(node.field, raw, is_container);
+			}
+			case NODE_COMPARE: {
+				String raw;
+				bool is_container = false;
+				if (!p_resolver.resolve(node.field, raw, is_container)) {
+					return node.op == OP_NE;
+				}
+				return _compare_raw(raw, is_container, node.op, node.literal);
+			}
+		}
+		return false;
+	}
+
+public:
+	// Accepts either an expression String such as `class == "mage" and level > 50`
+	// or a structured Dictionary. Returns false and sets the error message on failure.
+	bool compile(const Variant &p_predicate);
+	String get_error() const { return _error; }
+
+	int get_field_count() const { return (int)_fields.size(); }
+	const String &get_field(int p_index) const { return _fields[p_index]; }
+
+	// The resolver must provide `bool resolve(int field, String &r_raw, bool &r_is_container)`,
+	// returning false when the field does not exist in the current record.
+	template <typename R>
+	bool evaluate(R &p_resolver) const {
+		if (_root < 0) return false;
+		return _evaluate_node(_root, p_resolver);
+	}
+
+	static String decode_raw_string(const String &p_raw);
+};
@@ -0,0 +1,280 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_scan.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PBIJSON_SCAN_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define PBIJSON_TARGET_AVX2
+#else
+#define PBIJSON_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PBIJSON_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+struct ScanKernel {
+	const char *name;
+	int (*find_key)(const uint32_t *p_depths, const uint32_t *p_keys, int p_from, int p_to, uint32_t p_depth, uint32_t p_key);
+	int (*find_depth)(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth);
+	int (*count_depth)(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth);
+};
+
+int find_key_scalar(const uint32_t *p_depths, const uint32_t *p_keys, int p_from, int p_to, uint32_t p_depth, uint32_t p_key) {
+	for (; p_from < p_to; ++p_from) {
+		if (p_depths[p_from] == p_depth && p_keys[p_from] == p_key) return p_from;
+	}
+	return p_to;
+}
+
+int find_depth_scalar(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth) {
+	for (; p_from < p_to; ++p_from) {
+		if (p_depths[p_from] == p_depth) return p_from;
+	}
+	return p_to;
+}
+
+int count_depth_scalar(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth) {
+	int count = 0;
+	for (; p_from < p_to; ++p_from) {
+		count += p_depths[p_from] == p_depth;
+	}
+	return count;
+}
+
+#ifdef PBIJSON_SCAN_X86
+int first_set_bit(unsigned int p_mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long index;
+	_BitScanForward(&index, p_mask);
+	return (int)index;
+#else
+	return __builtin_ctz(p_mask);
+#endif
+}
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	// AVX needs both CPU support and the OS saving the YMM registers.
+	bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+	if (!os_saves_ymm) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+int find_key_sse2(const uint32_t *p_depths, const uint32_t *p_keys, int p_from, int p_to, uint32_t p_depth, uint32_t p_key) {
+	const __m128i depth = _mm_set1_epi32((int)p_depth);
+	const __m128i key = _mm_set1_epi32((int)p_key);
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		__m128i depths = _mm_loadu_si128((const __m128i *)(p_depths + p_from));
+		__m128i keys = _mm_loadu_si128((const __m128i *)(p_keys + p_from));
+		__m128i hits = _mm_and_si128(_mm_cmpeq_epi32(depths, depth), _mm_cmpeq_epi32(keys, key));
+		unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(hits));
+		if (mask != 0) return p_from + first_set_bit(mask);
+	}
+	return find_key_scalar(p_depths, p_keys, p_from, p_to, p_depth, p_key);
+}
+
+int find_depth_sse2(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth) {
+	const __m128i depth = _mm_set1_epi32((int)p_depth);
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		__m128i hits = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(p_depths + p_from)), depth);
+		unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(hits));
+		if (mask != 0) return p_from + first_set_bit(mask);
+	}
+	return find_depth_scalar(p_depths, p_from, p_to, p_depth);
+}
+
+int count_depth_sse2(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth) {
+	const __m128i depth = _mm_set1_epi32((int)p_depth);
+	// Matching lanes compare to -1, so subtracting the comparison counts them.
+	__m128i counts = _mm_setzero_si128();
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		counts = _mm_sub_epi32(counts, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(p_depths + p_from)), depth));
+	}
+	alignas(16) uint32_t lanes[4];
+	_mm_store_si128((__m128i *)lanes, counts);
+	return (int)(lanes[0] + lanes[1] + lanes[2] + lanes[3]) + count_depth_scalar(p_depths, p_from, p_to, p_depth);
+}
+
+PBIJSON_TARGET_AVX2 int find_key_avx2(const uint32_t *p_depths, const uint32_t *p_keys, int p_from, int p_to, uint32_t p_depth, uint32_t p_key) {
+	const __m256i depth = _mm256_set1_epi32((int)p_depth);
+	const __m256i key = _mm256_set1_epi32((int)p_key);
+	for (; p_from + 8 <= p_to; p_from += 8) {
+		__m256i depths = _mm256_loadu_si256((const __m256i *)(p_depths + p_from));
+		__m256i keys = _mm256_loadu_si256((const __m256i *)(p_keys + p_from));
+		__m256i hits = _mm256_and_si256(_mm256_cmpeq_epi32(depths, depth), _mm256_cmpeq_epi32(keys, key));
+		unsigned int mask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(hits));
+		if (mask != 0) return p_from + first_set_bit(mask);
+	}
+	return find_key_scalar(p_depths, p_keys, p_from, p_to, p_depth, p_key);
+}
+
+PBIJSON_TARGET_AVX2 int find_depth_avx2(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth) {
+	const __m256i depth = _mm256_set1_epi32((int)p_depth);
+	for (; p_from + 8 <= p_to; p_from += 8) {
+		__m256i hits = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(p_depths + p_from)), depth);
+		unsigned int mask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(hits));
+		if (mask != 0) return p_from + first_set_bit(mask);
+	}
+	return find_depth_scalar(p_depths, p_from, p_to, p_depth);
+}
+
+PBIJSON_TARGET_AVX2 int count_depth_avx2(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth) {
+	const __m256i depth = _mm256_set1_epi32((int)p_depth);
+	__m256i counts = _mm256_setzero_si256();
+	for (; p_from + 8 <= p_to; p_from += 8) {
+		counts = _mm256_sub_epi32(counts, _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(p_depths + p_from)), depth));
+	}
+	alignas(32) uint32_t lanes[8];
+	_mm256_store_si256((__m256i *)lanes, counts);
+	uint32_t total = 0;
+	for (int i = 0; i < 8; ++i) {
+		total += lanes[i];
+	}
+	return (int)total + count_depth_scalar(p_depths, p_from, p_to, p_depth);
+}
+#endif
+
+#ifdef PBIJSON_SCAN_NEON
+int find_key_neon(const uint32_t *p_depths, const uint32_t *p_keys, int p_from, int p_to, uint32_t p_depth, uint32_t p_key) {
+	const uint32x4_t depth = vdupq_n_u32(p_depth);
+	const uint32x4_t key = vdupq_n_u32(p_key);
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		uint32x4_t hits = vandq_u32(vceqq_u32(vld1q_u32(p_depths + p_from), depth), vceqq_u32(vld1q_u32(p_keys + p_from), key));
+		if (vmaxvq_u32(hits) != 0) break;
+	}
+	return find_key_scalar(p_depths, p_keys, p_from, p_to, p_depth, p_key);
+}
+
+int find_depth_neon(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth) {
+	const uint32x4_t depth = vdupq_n_u32(p_depth);
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		if (vmaxvq_u32(vceqq_u32(vld1q_u32(p_depths + p_from), depth)) != 0) break;
+	}
+	return find_depth_scalar(p_depths, p_from, p_to, p_depth);
+}
+
+int count_depth_neon(const uint32_t *p_depths, int p_from, int p_to, uint32_t p_depth) {
+	const uint32x4_t depth = vdupq_n_u32(p_depth);
+	uint32x4_t counts = vdupq_n_u32(0);
+	for (; p_from + 4 <= p_to; p_from += 4) {
+		counts = vsubq_u32(counts, vceqq_u32(vld1q_u32(p_depths + p_from), depth));
+	}
+	return (int)vaddvq_u32(counts) + count_depth_scalar(p_depths, p_from, p_to, p_depth);
+}
+#endif
+
+ScanKernel select_kernel() {
+#if defined(PBIJSON_SCAN_X86)
+	if (cpu_has_avx2()) {
+		return { "avx2", find_key_avx2, find_depth_avx2, count_depth_avx2 };
+	}
+	return { "sse2", find_key_sse2, find_depth_sse2, count_depth_sse2 };
+#elif defined(PBIJSON_SCAN_NEON)
+	return { "neon", find_key_neon, find_depth_neon, count_depth_neon };
+#else
+	return { "scalar", find_key_scalar, find_depth_scalar, count_depth_scalar };
+#endif
+}
+
+const ScanKernel &kernel() {
+	static const ScanKernel selected = select_kernel();
+	return selected;
+}
+
+} // namespace
+
+void LineScanIndex::reserve(int p_lines) {
+	_depths.reserve(p_lines);
+	_keys.reserve(p_lines);
+}
+
+void LineScanIndex::append(uint32_t p_depth, uint32_t p_key) {
+	_depths.push_back(p_depth);
+	_keys.push_back(p_key);
+}
+
+void LineScanIndex::clear() {
+	_depths.clear();
+	_keys.clear();
+}
+
+int LineScanIndex::find_key(int p_from, int p_to, uint32_t p_depth, uint32_t p_key) const {
+	if (p_from >= p_to) return p_to;
+	return kernel().find_key(_depths.data(), _keys.data(), p_from, p_to, p_depth, p_key);
+}
+
+int LineScanIndex::find_depth(int p_from, int p_to, uint32_t p_depth) const {
+	if (p_from >= p_to) return p_to;
+	return kernel().find_depth(_depths.data(), p_from, p_to, p_depth);
+}
+
+int LineScanIndex::count_depth(int p_from, int p_to, uint32_t p_depth) const {
+	if (p_from >= p_to) return 0;
+	return kernel().count_depth(_depths.data(), p_from, p_to, p_depth);
+}
+
+const char *LineScanIndex::get_kernel_name() {
+	return kernel().name;
+}
+
+#ifdef PBIJSON_BENCHMARK
+bool LineScanIndex::check_kernels(const uint32_t *p_depths, const uint32_t *p_keys, int p_from, int p_to, uint32_t p_depth, uint32_t p_key) {
+	ScanKernel kernels[2] = {};
+	int count = 0;
+#if defined(PBIJSON_SCAN_X86)
+	kernels[count++] = { "sse2", find_key_sse2, find_depth_sse2, count_depth_sse2 };
+	if (cpu_has_avx2()) {
+		kernels[count++] = { "avx2", find_key_avx2, find_depth_avx2, count_depth_avx2 };
+	}
+#elif defined(PBIJSON_SCAN_NEON)
+	kernels[count++] = { "neon", find_key_neon, find_depth_neon, count_depth_neon };
+#endif
+	const int key = find_key_scalar(p_depths, p_keys, p_from, p_to, p_depth, p_key);
+	const int depth = find_depth_scalar(p_depths, p_from, p_to, p_depth);
+	const int depth_count = count_depth_scalar(p_depths, p_from, p_to, p_depth);
+	for (int i = 0; i < count; ++i) {
+		if (kernels[i].find_key(p_depths, p_keys, p_from, p_to, p_depth, p_key) != key ||
+				kernels[i].find_depth(p_depths, p_from, p_to, p_depth) != depth ||
+				kernels[i].count_depth(p_depths, p_from, p_to, p_depth) != depth_count) {
+			return false;
+		}
+	}
+	return true;
+}
+#endif
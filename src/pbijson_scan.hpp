@@ -0,0 +1,61 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Per-line depth and key fingerprint of a loaded file, stored as two contiguous arrays so
+// sibling searches can test many lines per instruction instead of walking each line's String.
+// The kernel is picked once per process: AVX2 when the CPU has it, else SSE2 on x86-64,
+// NEON on ARM64 and a scalar loop elsewhere.
+class LineScanIndex {
+	std::vector<uint32_t> _depths;
+	std::vector<uint32_t> _keys;
+
+public:
+	void reserve(int p_lines);
+	void append(uint32_t p_depth, uint32_t p_key);
+	void clear();
+	int size() const { return (int)_depths.size(); }
+	bool is_empty() const { return _depths.empty(); }
+
+	// First line in [p_from, p_to) at p_depth whose key fingerprint is p_key, or p_to.
+	// A hit is a candidate only; fingerprints of different keys can be equal.
+	int find_key(int p_from, int p_to, uint32_t p_depth, uint32_t p_key) const;
+	// First line in [p_from, p_to) at p_depth, or p_to.
+	int find_depth(int p_from, int p_to, uint32_t p_depth) const;
+	// Number of lines in [p_from, p_to) at p_depth.
+	int count_depth(int p_from, int p_to, uint32_t p_depth) const;
+
+	// Name of the kernel in use: "avx2", "sse2", "neon" or "scalar".
+	static const char *get_kernel_name();
+
+#ifdef PBIJSON_BENCHMARK
+	// Runs all three searches with every kernel the CPU supports over the given lines and
+	// returns false if any result differs from the scalar loops'. The benchmark suite feeds it
+	// random ranges, most of them shorter than a vector.
+	static bool check_kernels(const uint32_t *p_depths, const uint32_t *p_keys, int p_from, int p_to, uint32_t p_depth, uint32_t p_key);
+#endif
+};
@@ -0,0 +1,91 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include "pbijson.hpp"
+#include "pbijson_bloom.hpp"
+#include "pbijson_cache.hpp"
+#include "pbijson_overlay.hpp"
+#include "pbijson_path_hash.hpp"
+#include "pbijson_scan.hpp"
+
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace godot;
+
+// A verified, loaded .pbijson file. Never modified after it has been published.
+struct PreBuiltIndexJSON::Dataset {
+	PackedStringArray lines;
+	// Sections that are read line by line at query time (currently IDX).
+	PackedStringArray section_data;
+	// Indexed field pattern -> Vector2i(first entry, entry count) in section_data.
+	Dictionary field_indexes;
+	PathHashIndex path_hash_index;
+	BloomFilterSet bloom_filters;
+	// Depth and key hash of every line in `lines`, for the vectorized sibling scans.
+	LineScanIndex line_scan;
+	// Verified hash of everything after the header, empty when the hash check was skipped.
+	String content_hash;
+
+	bool is_loaded() const { return !lines.is_empty(); }
+};
+
+// Process-wide table of the datasets loaded from files, keyed by path and verified content hash.
+// It holds weak references, so a dataset lives exactly as long as some instance uses it.
+struct PreBuiltIndexJSON::DatasetRegistry {
+	static std::shared_ptr<const Dataset> find(const String &p_key);
+	static void add(const String &p_key, const std::shared_ptr<const Dataset> &p_dataset);
+	static int size();
+
+private:
+	static std::mutex _mutex;
+	static std::map<String, std::weak_ptr<const Dataset>> _datasets;
+};
+
+// What a reader pins for the duration of one call: the dataset, the file it came from, the
+// changes pending on it and the caches filled from it. Replacing the dataset therefore also retires its caches,
+// so a reader still working on old data can never publish results into the new caches. Snapshots that
+// only differ in their pending changes share the caches, which describe nothing but the loaded lines.
+struct PreBuiltIndexJSON::Snapshot {
+	struct MergedValue {
+		PackedStringArray root;
+		Variant value;
+		bool found = false;
+	};
+
+	String file;
+	std::shared_ptr<const Dataset> dataset;
+	// Changes not yet merged into the dataset; null when there are none.
+	std::shared_ptr<const WriteOverlay> overlay;
+	std::shared_ptr<CacheManager> caches = std::make_shared<CacheManager>();
+	// The overlay never changes under a snapshot, so each merged value it rebuilds is kept,
+	// keyed by the joined path of the value the edits were replayed over.
+	mutable std::mutex merged_mutex;
+	mutable std::map<String, MergedValue> merged_values;
+};
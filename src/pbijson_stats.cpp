@@ -0,0 +1,166 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_stats.hpp"
+
+#include <godot_cpp/variant/packed_int64_array.hpp>
+
+
+namespace {
+
+constexpr std::memory_order RELAXED = std::memory_order_relaxed;
+
+const char *const METHOD_NAMES[QueryStats::METHOD_MAX] = {
+	"get_value",
+	"get_typed",
+	"has_path",
+	"get_size",
+	"get_keys",
+	"get_sub_paths",
+	"query",
+	"aggregate",
+	"top_k",
+	"find_by",
+	"get_json",
+	"build",
+	"load",
+	"hash_verification",
+};
+
+const char *const COUNTER_NAMES[QueryStats::COUNTER_MAX] = {
+	"lookups",
+	"lines_scanned",
+	"path_hash_hits",
+	"bloom_rejections",
+};
+
+int _get_bucket(uint64_t p_nsec) {
+	uint64_t usec = p_nsec / 1000;
+	int bucket = 0;
+	while (usec > 0 && bucket < QueryStats::HISTOGRAM_BUCKETS - 1) {
+		usec >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+} // namespace
+
+const char *QueryStats::get_method_name(Method p_method) {
+	return METHOD_NAMES[p_method];
+}
+
+const char *QueryStats::get_counter_name(Counter p_counter) {
+	return COUNTER_NAMES[p_counter];
+}
+
+void QueryStats::record(Method p_method, uint64_t p_nsec) {
+	MethodStats &method = _methods[p_method];
+	method.calls.fetch_add(1, RELAXED);
+	method.total_nsec.fetch_add(p_nsec, RELAXED);
+	method.histogram[_get_bucket(p_nsec)].fetch_add(1, RELAXED);
+}
+
+// Not atomic as a whole: a call recorded concurrently may keep part of its numbers.
+void QueryStats::reset() {
+	for (MethodStats &method : _methods) {
+		method.calls.store(0, RELAXED);
+		method.total_nsec.store(0, RELAXED);
+		for (std::atomic<uint64_t> &bucket : method.histogram) {
+			bucket.store(0, RELAXED);
+		}
+	}
+	for (std::atomic<uint64_t> &counter : _counters) {
+		counter.store(0, RELAXED);
+	}
+}
+
+Dictionary QueryStats::to_dictionary() const {
+	Dictionary methods;
+	for (int i = 0; i < METHOD_MAX; i++) {
+		const MethodStats &method = _methods[i];
+		uint64_t calls = method.calls.load(RELAXED);
+		uint64_t total_nsec = method.total_nsec.load(RELAXED);
+		PackedInt64Array histogram;
+		histogram.resize(HISTOGRAM_BUCKETS);
+		for (int j = 0; j < HISTOGRAM_BUCKETS; j++) {
+			histogram.set(j, (int64_t)method.histogram[j].load(RELAXED));
+		}
+		Dictionary entry;
+		entry["calls"] = (int64_t)calls;
+		entry["total_usec"] = total_nsec / 1000.0;
+		entry["mean_usec"] = calls > 0 ? total_nsec / 1000.0 / calls : 0.0;
+		entry["histogram"] = histogram;
+		methods[METHOD_NAMES[i]] = entry;
+	}
+	Dictionary counters;
+	for (int i = 0; i < COUNTER_MAX; i++) {
+		counters[COUNTER_NAMES[i]] = (int64_t)_counters[i].load(RELAXED);
+	}
+	PackedInt64Array bounds;
+	bounds.resize(HISTOGRAM_BUCKETS - 1);
+	for (int j = 0; j < HISTOGRAM_BUCKETS - 1; j++) {
+		bounds.set(j, (int64_t)1 << j);
+	}
+
+	Dictionary result;
+	result["enabled"] = is_enabled();
+	result["methods"] = methods;
+	result["counters"] = counters;
+	result["lines_per_lookup"] = get("lines_per_lookup");
+	result["histogram_bounds_usec"] = bounds;
+	return result;
+}
+
+double QueryStats::get(const String &p_name) const {
+	for (int i = 0; i < COUNTER_MAX; i++) {
+		if (p_name == COUNTER_NAMES[i]) {
+			return (double)_counters[i].load(RELAXED);
+		}
+	}
+	if (p_name == "lines_per_lookup") {
+		uint64_t lookups = _counters[LOOKUPS].load(RELAXED);
+		return lookups > 0 ? (double)_counters[LINES_SCANNED].load(RELAXED) / lookups : 0.0;
+	}
+	int slash = p_name.find("/");
+	if (slash < 0) {
+		return 0.0;
+	}
+	String method_name = p_name.substr(0, slash);
+	String field = p_name.substr(slash + 1);
+	for (int i = 0; i < METHOD_MAX; i++) {
+		if (method_name != METHOD_NAMES[i]) {
+			continue;
+		}
+		uint64_t calls = _methods[i].calls.load(RELAXED);
+		double total_usec = _methods[i].total_nsec.load(RELAXED) / 1000.0;
+		if (field == "calls") {
+			return (double)calls;
+		} else if (field == "total_usec") {
+			return total_usec;
+		} else if (field == "mean_usec") {
+			return calls > 0 ? total_usec / calls : 0.0;
+		}
+	}
+	return 0.0;
+}
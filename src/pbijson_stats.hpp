@@ -0,0 +1,135 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace godot;
+
+// Counters and latency histograms of one PreBuiltIndexJSON instance. Updates are relaxed
+// atomic adds, so readers on any thread can record without locking; the numbers are for
+// monitoring and no ordering between two of them is promised. While switched off at runtime
+// a record costs one relaxed load, and builds with PBIJSON_NO_STATS drop the records entirely.
+class QueryStats {
+public:
+	enum Method {
+		GET_VALUE,
+		GET_TYPED, // get_int, get_float, get_bool and get_string.
+		HAS_PATH,
+		GET_SIZE,
+		GET_KEYS,
+		GET_SUB_PATHS,
+		QUERY,
+		AGGREGATE,
+		TOP_K,
+		FIND_BY,
+		GET_JSON, // get_json, get_json_buffer and store_json.
+		BUILD,
+		LOAD, // Every open and reload, including the hash check.
+		HASH_VERIFICATION,
+		METHOD_MAX,
+	};
+	enum Counter {
+		LOOKUPS, // Paths resolved against the lines.
+		LINES_SCANNED, // Lines the sibling searches of those lookups stepped over.
+		PATH_HASH_HITS, // Lookups answered by the path hash index without a scan.
+		BLOOM_REJECTIONS, // Sibling searches skipped because a bloom filter ruled the key out.
+		COUNTER_MAX,
+	};
+	// Bucket 0 counts calls under 1 usec, bucket i those under 2^i usec; the last one takes the rest.
+	static constexpr int HISTOGRAM_BUCKETS = 24;
+
+	QueryStats() { reset(); }
+	QueryStats(const QueryStats &) = delete;
+
+	bool is_enabled() const { return _enabled.load(std::memory_order_relaxed); }
+	void set_enabled(bool p_enabled) { _enabled.store(p_enabled, std::memory_order_relaxed); }
+
+	void add(Counter p_counter, uint64_t p_value) { _counters[p_counter].fetch_add(p_value, std::memory_order_relaxed); }
+	void record(Method p_method, uint64_t p_nsec);
+	void reset();
+
+	// {"methods": {name: {calls, total_usec, mean_usec, histogram}}, "counters": {...}, ...}.
+	Dictionary to_dictionary() const;
+	// One number by name: a counter, "lines_per_lookup", or "<method>/calls", "<method>/mean_usec"
+	// and "<method>/total_usec". Unknown names read as 0.
+	double get(const String &p_name) const;
+
+	static const char *get_method_name(Method p_method);
+	static const char *get_counter_name(Counter p_counter);
+
+private:
+	// Each method on its own cache line, so threads busy with different methods don't contend.
+	struct alignas(64) MethodStats {
+		std::atomic<uint64_t> calls;
+		std::atomic<uint64_t> total_nsec;
+		std::atomic<uint64_t> histogram[HISTOGRAM_BUCKETS];
+	};
+
+	std::atomic<bool> _enabled{ false };
+	MethodStats _methods[METHOD_MAX];
+	alignas(64) std::atomic<uint64_t> _counters[COUNTER_MAX];
+};
+
+// Records the time until the end of the enclosing scope under one method, if statistics
+// were enabled when the scope was entered.
+class QueryStatsScope {
+	using Clock = std::chrono::steady_clock;
+
+	QueryStats *_stats;
+	QueryStats::Method _method;
+	Clock::time_point _start;
+
+public:
+	QueryStatsScope(QueryStats &p_stats, QueryStats::Method p_method) :
+			_stats(p_stats.is_enabled() ? &p_stats : nullptr), _method(p_method) {
+		if (_stats) {
+			_start = Clock::now();
+		}
+	}
+	~QueryStatsScope() {
+		if (_stats) {
+			_stats->record(_method, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _start).count());
+		}
+	}
+	QueryStatsScope(const QueryStatsScope &) = delete;
+};
+
+// Both expect the instance's QueryStats as `_stats` in scope.
+#ifdef PBIJSON_NO_STATS
+#define PBIJSON_STATS_SCOPE(m_method) ((void)0)
+#define PBIJSON_STATS_ADD(m_counter, m_value) ((void)0)
+#else
+#define PBIJSON_STATS_SCOPE(m_method) QueryStatsScope _stats_scope(_stats, QueryStats::m_method)
+#define PBIJSON_STATS_ADD(m_counter, m_value)                   \
+	do {                                                        \
+		if (_stats.is_enabled()) {                              \
+			_stats.add(QueryStats::m_counter, (uint64_t)(m_value)); \
+		}                                                       \
+	} while (0)
+#endif
@@ -0,0 +1,399 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#include "pbijson_trace.hpp"
+#include "pbijson_cache.hpp"
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+constexpr std::memory_order RELAXED = std::memory_order_relaxed;
+constexpr uint32_t TRACE_MAGIC = 0x54494250; // "PBIT" in little endian.
+constexpr uint32_t TRACE_VERSION = 1;
+
+// Encodes as much of the path as fits, never splitting a character.
+int _encode_path(const String &p_path, uint8_t *r_bytes, int p_capacity, bool &r_truncated) {
+	const char32_t *chars = p_path.ptr();
+	int length = 0;
+	r_truncated = false;
+	for (int64_t i = 0; i < p_path.length(); i++) {
+		uint32_t c = (uint32_t)chars[i];
+		uint8_t encoded[4];
+		int size = 0;
+		if (c < 0x80) {
+			encoded[size++] = (uint8_t)c;
+		} else if (c < 0x800) {
+			encoded[size++] = (uint8_t)(0xC0 | (c >> 6));
+			encoded[size++] = (uint8_t)(0x80 | (c & 0x3F));
+		} else if (c < 0x10000) {
+			encoded[size++] = (uint8_t)(0xE0 | (c >> 12));
+			encoded[size++] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+			encoded[size++] = (uint8_t)(0x80 | (c & 0x3F));
+		} else {
+			encoded[size++] = (uint8_t)(0xF0 | (c >> 18));
+			encoded[size++] = (uint8_t)(0x80 | ((c >> 12) & 0x3F));
+			encoded[size++] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+			encoded[size++] = (uint8_t)(0x80 | (c & 0x3F));
+		}
+		if (length + size > p_capacity) {
+			r_truncated = true;
+			break;
+		}
+		memcpy(r_bytes + length, encoded, size);
+		length += size;
+	}
+	return length;
+}
+
+// Little-endian writer and reader for the dump format.
+struct ByteWriter {
+	std::string bytes;
+
+	void put(uint64_t p_value, int p_size) {
+		for (int i = 0; i < p_size; i++) {
+			bytes += (char)((p_value >> (8 * i)) & 0xFF);
+		}
+	}
+};
+
+struct ByteReader {
+	const uint8_t *data;
+	int64_t size;
+	int64_t position = 0;
+	bool failed = false;
+
+	uint64_t get(int p_size) {
+		if (position + p_size > size) {
+			failed = true;
+			return 0;
+		}
+		uint64_t value = 0;
+		for (int i = 0; i < p_size; i++) {
+			value |= (uint64_t)data[position + i] << (8 * i);
+		}
+		position += p_size;
+		return value;
+	}
+};
+
+struct PathGroup {
+	const TraceEvent *first = nullptr;
+	uint64_t calls = 0;
+	uint64_t total_nsec = 0;
+	uint64_t max_nsec = 0;
+	uint64_t lines_scanned = 0;
+	// Calls with at least one cache hit, so that cache_hit_rate stays a share of calls.
+	uint64_t cached_calls = 0;
+	uint64_t methods[QueryStats::METHOD_MAX] = {};
+};
+
+Dictionary _group_to_dictionary(const PathGroup &p_group) {
+	Dictionary methods;
+	for (int i = 0; i < QueryStats::METHOD_MAX; i++) {
+		if (p_group.methods[i] > 0) {
+			methods[QueryStats::get_method_name(static_cast<QueryStats::Method>(i))] = (int64_t)p_group.methods[i];
+		}
+	}
+	Dictionary entry;
+	entry["path"] = String::utf8(p_group.first->path.data(), (int)p_group.first->path.size());
+	entry["truncated"] = p_group.first->truncated;
+	entry["calls"] = (int64_t)p_group.calls;
+	entry["total_usec"] = p_group.total_nsec / 1000.0;
+	entry["mean_usec"] = p_group.total_nsec / 1000.0 / p_group.calls;
+	entry["max_usec"] = p_group.max_nsec / 1000.0;
+	entry["mean_lines_scanned"] = (double)p_group.lines_scanned / p_group.calls;
+	entry["cache_hit_rate"] = (double)p_group.cached_calls / p_group.calls;
+	entry["methods"] = methods;
+	return entry;
+}
+
+} // namespace
+
+QueryTrace::QueryTrace(int p_capacity, int p_sample_every) :
+		_capacity([p_capacity]() {
+			// A power of two, so a slot is picked with a mask.
+			int capacity = 1;
+			while (capacity < p_capacity && capacity < (1 << 24)) {
+				capacity <<= 1;
+			}
+			return capacity;
+		}()),
+		_sample_every(std::max(p_sample_every, 1)),
+		_started(std::chrono::steady_clock::now()),
+		_slots(new Slot[_capacity]) {
+}
+
+bool QueryTrace::sample(int p_sample_every) {
+	if (p_sample_every <= 1) {
+		return true;
+	}
+	static thread_local uint32_t tick = 0;
+	return ++tick % (uint32_t)p_sample_every == 0;
+}
+
+void QueryTraceHolder::Pin::acquire(QueryTraceHolder &p_holder) {
+	uint64_t generation = p_holder._generation.load(std::memory_order_seq_cst);
+	if (generation == 0) {
+		return;
+	}
+	int slot = (int)(generation & 1);
+	p_holder._pins[slot].fetch_add(1, std::memory_order_seq_cst);
+	if (p_holder._generation.load(std::memory_order_seq_cst) != generation) {
+		// A newer trace was started meanwhile; this call simply goes untraced.
+		p_holder._pins[slot].fetch_sub(1, std::memory_order_release);
+		return;
+	}
+	_holder = &p_holder;
+	_slot = slot;
+	_trace = p_holder._traces[slot].get();
+}
+
+void QueryTraceHolder::start(int p_capacity, int p_sample_every) {
+	uint64_t generation = _generation.load(std::memory_order_relaxed) + 1;
+	int slot = (int)(generation & 1);
+	while (_pins[slot].load(std::memory_order_seq_cst) != 0) {
+		std::this_thread::yield();
+	}
+	_traces[slot] = std::make_unique<QueryTrace>(p_capacity, p_sample_every);
+	_sample_every.store(std::max(p_sample_every, 1), std::memory_order_relaxed);
+	_generation.store(generation, std::memory_order_seq_cst);
+	_tracing.store(true, std::memory_order_relaxed);
+}
+
+void QueryTrace::record(QueryStats::Method p_method, const String &p_path, uint64_t p_nsec, uint64_t p_lines_scanned, uint32_t p_cache_hits, std::chrono::steady_clock::time_point p_start) {
+	uint64_t path_words[PATH_WORDS] = {};
+	bool truncated = false;
+	uint64_t length = (uint64_t)_encode_path(p_path, reinterpret_cast<uint8_t *>(path_words), PATH_BYTES, truncated);
+	uint64_t header = (uint64_t)p_method | ((uint64_t)std::min<uint32_t>(p_cache_hits, 0xFFFF) << 8) | (length << 24) | ((uint64_t)truncated << 32);
+	uint64_t time_usec = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(p_start - _started).count();
+
+	uint64_t index = _head.fetch_add(1, RELAXED);
+	Slot &slot = _slots[index & (uint64_t)(_capacity - 1)];
+	slot.sequence.store(2 * index + 1, RELAXED);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.words[WORD_HEADER].store(header, RELAXED);
+	slot.words[WORD_NSEC].store(p_nsec, RELAXED);
+	slot.words[WORD_LINES].store(p_lines_scanned, RELAXED);
+	slot.words[WORD_TIME].store(time_usec, RELAXED);
+	slot.words[WORD_HASH].store(CacheKey::hash_path(p_path), RELAXED);
+	for (int i = 0; i < PATH_WORDS; i++) {
+		slot.words[WORD_PATH + i].store(path_words[i], RELAXED);
+	}
+	slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+std::vector<TraceEvent> QueryTrace::get_events() const {
+	std::vector<TraceEvent> events;
+	uint64_t head = _head.load(std::memory_order_acquire);
+	uint64_t first = head > (uint64_t)_capacity ? head - _capacity : 0;
+	events.reserve(head - first);
+	for (uint64_t index = first; index < head; index++) {
+		const Slot &slot = _slots[index & (uint64_t)(_capacity - 1)];
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence != 2 * index + 2) {
+			continue; // Still being written, or already overwritten by a newer event.
+		}
+		uint64_t words[WORD_COUNT];
+		for (int i = 0; i < WORD_COUNT; i++) {
+			words[i] = slot.words[i].load(RELAXED);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(RELAXED) != sequence) {
+			continue;
+		}
+		TraceEvent event;
+		event.method = static_cast<QueryStats::Method>(std::min<uint64_t>(words[WORD_HEADER] & 0xFF, QueryStats::METHOD_MAX - 1));
+		event.cache_hits = (uint32_t)((words[WORD_HEADER] >> 8) & 0xFFFF);
+		event.truncated = ((words[WORD_HEADER] >> 32) & 1) != 0;
+		event.nsec = words[WORD_NSEC];
+		event.lines_scanned = words[WORD_LINES];
+		event.time_usec = words[WORD_TIME];
+		event.path_hash = words[WORD_HASH];
+		size_t length = std::min<size_t>((words[WORD_HEADER] >> 24) & 0xFF, PATH_BYTES);
+		event.path.assign(reinterpret_cast<const char *>(words + WORD_PATH), length);
+		events.push_back(std::move(event));
+	}
+	return events;
+}
+
+uint64_t QueryTrace::get_dropped() const {
+	uint64_t head = _head.load(RELAXED);
+	return head > (uint64_t)_capacity ? head - _capacity : 0;
+}
+
+// Header: magic, version, sample_every, dropped, event count. Each event: method, flags
+// (bit 0: truncated), cache hits (16 bit), lines scanned and nsec (32 bit, saturated),
+// time and path hash (64 bit), then the UTF-8 path behind a one-byte length.
+Error QueryTrace::save(const String &p_path, const std::vector<TraceEvent> &p_events, int p_sample_every, uint64_t p_dropped) {
+	ByteWriter writer;
+	writer.bytes.reserve(32 + p_events.size() * 40);
+	writer.put(TRACE_MAGIC, 4);
+	writer.put(TRACE_VERSION, 4);
+	writer.put((uint64_t)p_sample_every, 4);
+	writer.put(p_dropped, 8);
+	writer.put(p_events.size(), 8);
+	for (const TraceEvent &event : p_events) {
+		writer.put(event.method, 1);
+		writer.put(event.truncated ? 1 : 0, 1);
+		writer.put(std::min<uint32_t>(event.cache_hits, 0xFFFF), 2);
+		writer.put(std::min<uint64_t>(event.lines_scanned, UINT32_MAX), 4);
+		writer.put(std::min<uint64_t>(event.nsec, UINT32_MAX), 4);
+		writer.put(event.time_usec, 8);
+		writer.put(event.path_hash, 8);
+		size_t length = std::min<size_t>(event.path.size(), PATH_BYTES);
+		writer.put(length, 1);
+		writer.bytes.append(event.path, 0, length);
+	}
+
+	Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::WRITE);
+	if (file.is_null()) {
+		return FileAccess::get_open_error();
+	}
+	PackedByteArray buffer;
+	buffer.resize((int64_t)writer.bytes.size());
+	memcpy(buffer.ptrw(), writer.bytes.data(), writer.bytes.size());
+	file->store_buffer(buffer);
+	return file->get_error();
+}
+
+Error QueryTrace::load(const String &p_path, std::vector<TraceEvent> &r_events, int &r_sample_every, uint64_t &r_dropped) {
+	if (!FileAccess::file_exists(p_path)) {
+		return ERR_FILE_NOT_FOUND;
+	}
+	PackedByteArray buffer = FileAccess::get_file_as_bytes(p_path);
+	ByteReader reader{ buffer.ptr(), buffer.size() };
+	if (reader.get(4) != TRACE_MAGIC || reader.get(4) != TRACE_VERSION) {
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	r_sample_every = (int)reader.get(4);
+	r_dropped = reader.get(8);
+	uint64_t count = reader.get(8);
+	r_events.clear();
+	for (uint64_t i = 0; i < count && !reader.failed; i++) {
+		TraceEvent event;
+		event.method = static_cast<QueryStats::Method>(std::min<uint64_t>(reader.get(1), QueryStats::METHOD_MAX - 1));
+		event.truncated = (reader.get(1) & 1) != 0;
+		event.cache_hits = (uint32_t)reader.get(2);
+		event.lines_scanned = reader.get(4);
+		event.nsec = reader.get(4);
+		event.time_usec = reader.get(8);
+		event.path_hash = reader.get(8);
+		int64_t length = (int64_t)reader.get(1);
+		if (reader.failed || reader.position + length > reader.size) {
+			return ERR_FILE_CORRUPT;
+		}
+		event.path.assign(reinterpret_cast<const char *>(reader.data + reader.position), length);
+		reader.position += length;
+		r_events.push_back(std::move(event));
+	}
+	return reader.failed ? ERR_FILE_CORRUPT : OK;
+}
+
+Dictionary QueryTrace::summarize(const std::vector<TraceEvent> &p_events, int p_top, int p_sample_every, uint64_t p_dropped) {
+	std::unordered_map<uint64_t, PathGroup> groups;
+	PathGroup by_method[QueryStats::METHOD_MAX];
+	uint64_t first_usec = UINT64_MAX;
+	uint64_t last_usec = 0;
+	for (const TraceEvent &event : p_events) {
+		PathGroup &group = groups[event.path_hash];
+		if (group.first == nullptr) {
+			group.first = &event;
+		}
+		for (PathGroup *target : { &group, &by_method[event.method] }) {
+			target->calls++;
+			target->total_nsec += event.nsec;
+			target->max_nsec = std::max(target->max_nsec, event.nsec);
+			target->lines_scanned += event.lines_scanned;
+			target->cached_calls += event.cache_hits > 0 ? 1 : 0;
+		}
+		group.methods[event.method]++;
+		first_usec = std::min(first_usec, event.time_usec);
+		last_usec = std::max(last_usec, event.time_usec);
+	}
+
+	std::vector<const PathGroup *> sorted;
+	sorted.reserve(groups.size());
+	for (const std::pair<const uint64_t, PathGroup> &entry : groups) {
+		sorted.push_back(&entry.second);
+	}
+	const size_t top = std::min(sorted.size(), (size_t)std::max(p_top, 0));
+	Array hottest;
+	std::partial_sort(sorted.begin(), sorted.begin() + top, sorted.end(), [](const PathGroup *a, const PathGroup *b) {
+		return a->calls != b->calls ? a->calls > b->calls : a->total_nsec > b->total_nsec;
+	});
+	for (size_t i = 0; i < top; i++) {
+		hottest.push_back(_group_to_dictionary(*sorted[i]));
+	}
+	Array most_expensive;
+	std::partial_sort(sorted.begin(), sorted.begin() + top, sorted.end(), [](const PathGroup *a, const PathGroup *b) {
+		return a->total_nsec > b->total_nsec;
+	});
+	for (size_t i = 0; i < top; i++) {
+		most_expensive.push_back(_group_to_dictionary(*sorted[i]));
+	}
+	Dictionary methods;
+	for (int i = 0; i < QueryStats::METHOD_MAX; i++) {
+		const PathGroup &group = by_method[i];
+		if (group.calls == 0) {
+			continue;
+		}
+		Dictionary entry;
+		entry["calls"] = (int64_t)group.calls;
+		entry["total_usec"] = group.total_nsec / 1000.0;
+		entry["mean_usec"] = group.total_nsec / 1000.0 / group.calls;
+		entry["max_usec"] = group.max_nsec / 1000.0;
+		entry["mean_lines_scanned"] = (double)group.lines_scanned / group.calls;
+		entry["cache_hit_rate"] = (double)group.cached_calls / group.calls;
+		methods[QueryStats::get_method_name(static_cast<QueryStats::Method>(i))] = entry;
+	}
+
+	Dictionary report;
+	report["events"] = (int64_t)p_events.size();
+	report["dropped"] = (int64_t)p_dropped;
+	report["sample_every"] = p_sample_every;
+	report["span_usec"] = p_events.empty() ? (int64_t)0 : (int64_t)(last_usec - first_usec);
+	report["distinct_paths"] = (int64_t)groups.size();
+	report["methods"] = methods;
+	report["hottest"] = hottest;
+	report["most_expensive"] = most_expensive;
+	return report;
+}
+
+Dictionary QueryTrace::to_dictionary(const TraceEvent &p_event) {
+	Dictionary event;
+	event["method"] = QueryStats::get_method_name(p_event.method);
+	event["path"] = String::utf8(p_event.path.data(), (int)p_event.path.size());
+	event["truncated"] = p_event.truncated;
+	event["usec"] = p_event.nsec / 1000.0;
+	event["lines_scanned"] = (int64_t)p_event.lines_scanned;
+	event["cache_hits"] = (int64_t)p_event.cache_hits;
+	event["time_usec"] = (int64_t)p_event.time_usec;
+	return event;
+}
@@ -0,0 +1,200 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 AdvanceControl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+#pragma once
+
+#include "pbijson_stats.hpp"
+
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace godot;
+
+// Work done by the calling thread, counted unconditionally at the few sites that do it, so a
+// trace scope can attribute it to one call by taking the difference. Plain thread locals:
+// a counter that is never read costs a single increment.
+namespace pbijson_trace {
+inline thread_local uint64_t lines_scanned = 0;
+inline thread_local uint32_t cache_hits = 0;
+}
+
+// One traced call as read back from the ring or from a dump.
+struct TraceEvent {
+	QueryStats::Method method = QueryStats::GET_VALUE;
+	uint32_t cache_hits = 0;
+	uint64_t lines_scanned = 0;
+	uint64_t nsec = 0;
+	uint64_t time_usec = 0; // Since the trace started.
+	uint64_t path_hash = 0; // Of the whole path, so truncated paths still group correctly.
+	bool truncated = false;
+	std::string path; // UTF-8, cut after PATH_BYTES.
+};
+
+// Fixed-size ring of traced calls. Writers claim a slot with one fetch_add and publish it
+// through the slot's sequence number, seqlock style, so recording never blocks and a reader
+// skips any slot that changed while it was copied. Every field is an atomic word, so even a
+// torn read is well defined. Once full, the oldest events are overwritten.
+class QueryTrace {
+public:
+	static constexpr int PATH_WORDS = 12;
+	static constexpr int PATH_BYTES = PATH_WORDS * 8;
+
+	QueryTrace(int p_capacity, int p_sample_every);
+	QueryTrace(const QueryTrace &) = delete;
+
+	// Whether the calling thread should record its current call, for 1 in p_sample_every calls.
+	static bool sample(int p_sample_every);
+	void record(QueryStats::Method p_method, const String &p_path, uint64_t p_nsec, uint64_t p_lines_scanned, uint32_t p_cache_hits, std::chrono::steady_clock::time_point p_start);
+
+	// The events still in the ring, oldest first.
+	std::vector<TraceEvent> get_events() const;
+	int get_capacity() const { return _capacity; }
+	int get_sample_every() const { return _sample_every; }
+	// Events that were overwritten before anyone read them.
+	uint64_t get_dropped() const;
+
+	// The compact file format: a header, then one variable-length record per event.
+	static Error save(const String &p_path, const std::vector<TraceEvent> &p_events, int p_sample_every, uint64_t p_dropped);
+	static Error load(const String &p_path, std::vector<TraceEvent> &r_events, int &r_sample_every, uint64_t &r_dropped);
+	// Groups events by path: the ones called most often and the ones costing the most time in total.
+	static Dictionary summarize(const std::vector<TraceEvent> &p_events, int p_top, int p_sample_every, uint64_t p_dropped);
+	static Dictionary to_dictionary(const TraceEvent &p_event);
+
+private:
+	// Layout of Slot::words.
+	enum {
+		WORD_HEADER, // Method, cache hits, path length and the truncated bit.
+		WORD_NSEC,
+		WORD_LINES,
+		WORD_TIME,
+		WORD_HASH,
+		WORD_PATH,
+		WORD_COUNT = WORD_PATH + PATH_WORDS,
+	};
+	struct alignas(64) Slot {
+		// 2 * event index + 1 while being written, + 2 once complete; 0 never written.
+		std::atomic<uint64_t> sequence{ 0 };
+		std::atomic<uint64_t> words[WORD_COUNT];
+	};
+
+	const int _capacity;
+	const int _sample_every;
+	const std::chrono::steady_clock::time_point _started;
+	std::unique_ptr<Slot[]> _slots;
+	std::atomic<uint64_t> _head{ 0 };
+};
+
+// An instance's current trace, pinned by readers without a lock. Traces alternate between two
+// slots and the generation counter names the current one: a reader counts itself on a slot,
+// then checks the generation is unchanged before using it. start() only replaces the slot that
+// is not current, once every reader counted on it has left, so the ring it frees is unused.
+class QueryTraceHolder {
+	std::atomic<bool> _tracing{ false };
+	std::atomic<int> _sample_every{ 1 };
+	std::atomic<uint64_t> _generation{ 0 }; // 0 until the first start().
+	std::atomic<uint32_t> _pins[2] = {};
+	std::unique_ptr<QueryTrace> _traces[2];
+
+public:
+	// Keeps the current trace alive while it is in scope; get() is null when there is none.
+	class Pin {
+		QueryTraceHolder *_holder = nullptr;
+		QueryTrace *_trace = nullptr;
+		int _slot = 0;
+
+	public:
+		Pin() = default;
+		explicit Pin(QueryTraceHolder &p_holder) { acquire(p_holder); }
+		~Pin() {
+			if (_trace) _holder->_pins[_slot].fetch_sub(1, std::memory_order_release);
+		}
+		Pin(const Pin &) = delete;
+
+		void acquire(QueryTraceHolder &p_holder);
+		QueryTrace *get() const { return _trace; }
+	};
+
+	// Called with the owner's mutex held. Waits for readers still on the trace before the current one.
+	void start(int p_capacity, int p_sample_every);
+	void stop() { _tracing.store(false, std::memory_order_relaxed); }
+	bool is_tracing() const { return _tracing.load(std::memory_order_relaxed); }
+	int get_sample_every() const { return _sample_every.load(std::memory_order_relaxed); }
+};
+
+// Records the enclosing call into the instance's trace when tracing is on and the call is
+// sampled. Sampling comes first, so calls that are skipped never touch the shared counters.
+class QueryTraceScope {
+	using Clock = std::chrono::steady_clock;
+
+	QueryTraceHolder::Pin _pin;
+	QueryStats::Method _method;
+	const String &_path;
+	Clock::time_point _start;
+	uint64_t _lines_scanned = 0;
+	uint32_t _cache_hits = 0;
+
+public:
+	QueryTraceScope(QueryTraceHolder &p_holder, QueryStats::Method p_method, const String &p_path) :
+			_method(p_method), _path(p_path) {
+		if (!p_holder.is_tracing() || !QueryTrace::sample(p_holder.get_sample_every())) {
+			return;
+		}
+		_pin.acquire(p_holder);
+		if (!_pin.get()) {
+			return;
+		}
+		_lines_scanned = pbijson_trace::lines_scanned;
+		_cache_hits = pbijson_trace::cache_hits;
+		_start = Clock::now();
+	}
+	~QueryTraceScope() {
+		if (_pin.get()) {
+			uint64_t nsec = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _start).count();
+			_pin.get()->record(_method, _path, nsec, pbijson_trace::lines_scanned - _lines_scanned, pbijson_trace::cache_hits - _cache_hits, _start);
+		}
+	}
+	QueryTraceScope(const QueryTraceScope &) = delete;
+};
+
+// PBIJSON_TRACE_SCOPE expects the instance's QueryTraceHolder `_trace` in scope.
+#ifdef PBIJSON_NO_STATS
+#define PBIJSON_TRACE_SCOPE(m_method, m_path) ((void)0)
+#define PBIJSON_COUNT_LINES_SCANNED(m_lines) ((void)0)
+#define PBIJSON_COUNT_CACHE_HIT() ((void)0)
+#else
+#define PBIJSON_TRACE_SCOPE(m_method, m_path) QueryTraceScope _trace_scope(_trace, QueryStats::m_method, m_path)
+#define PBIJSON_COUNT_LINES_SCANNED(m_lines)                       \
+	do {                                                           \
+		pbijson_trace::lines_scanned += (uint64_t)(m_lines);        \
+		PBIJSON_STATS_ADD(LINES_SCANNED, m_lines);                 \
+	} while (0)
+#define PBIJSON_COUNT_CACHE_HIT() (++pbijson_trace::cache_hits)
+#endif
@@ -31,6 +31,10 @@
 #include "pbijson.hpp"
 #include "pbijson_output.hpp"
 
+#ifdef PBIJSON_BENCHMARK
+#include "benchmark/pbijson_benchmark.hpp"
+#endif
+
 using namespace godot;
 
 void initialize_gdextension_types(ModuleInitializationLevel p_level)
@@ -40,6 +44,9 @@ void initialize_gdextension_types(ModuleInitializationLevel p_level)
 	}
 	GDREGISTER_CLASS(PreBuiltIndexJSON);
 	GDREGISTER_CLASS(PreBuiltIndexJSONOutput)
+#ifdef PBIJSON_BENCHMARK
+	GDREGISTER_CLASS(PreBuiltIndexJSONBenchmark);
+#endif
 }
 
 void uninitialize_gdextension_types(ModuleInitializationLevel p_level) {